@@ -0,0 +1,478 @@
+/*
+ *  aes.c: AES in counter mode as a keystream generator for dwipe.
+ *
+ *  Copyright Paolo Iannelli <info@paoloiannelli.com>.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc., 675 Mass
+ *  Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include <string.h>
+#include "aes.h"
+#include "cpu.h"
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <wmmintrin.h>
+#define AES_HAVE_NI
+#endif
+
+
+
+/*
+ * The software cipher evaluates the S-box as the Boyar-Peralta boolean circuit on bit planes,
+ * so it has no lookup tables and no secret-dependent branches, and its timing does not depend
+ * on the key. It is only a fallback for machines without AES-NI.
+ *
+ */
+
+#define AES_SOFT_BLOCKS   4    /* Blocks whose 64 bytes fill the 64-bit bit planes. */
+
+static void aes_sbox_planes( uint64_t* q )
+{
+/**
+ * Substitutes 64 bytes at once. Plane q[k] holds bit k of every byte.
+ *
+ */
+
+	uint64_t x0, x1, x2, x3, x4, x5, x6, x7;
+	uint64_t y1, y2, y3, y4, y5, y6, y7, y8, y9, y10, y11, y12, y13, y14, y15, y16, y17, y18, y19, y20, y21;
+	uint64_t z0, z1, z2, z3, z4, z5, z6, z7, z8, z9, z10, z11, z12, z13, z14, z15, z16, z17;
+	uint64_t t0, t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11, t12, t13, t14, t15, t16, t17, t18, t19;
+	uint64_t t20, t21, t22, t23, t24, t25, t26, t27, t28, t29, t30, t31, t32, t33, t34, t35, t36, t37, t38, t39;
+	uint64_t t40, t41, t42, t43, t44, t45, t46, t47, t48, t49, t50, t51, t52, t53, t54, t55, t56, t57, t58, t59;
+	uint64_t t60, t61, t62, t63, t64, t65, t66, t67;
+	uint64_t s0, s1, s2, s3, s4, s5, s6, s7;
+
+	x0 = q[7]; x1 = q[6]; x2 = q[5]; x3 = q[4];
+	x4 = q[3]; x5 = q[2]; x6 = q[1]; x7 = q[0];
+
+	/* Top linear transformation. */
+	y14 = x3 ^ x5;   y13 = x0 ^ x6;   y9  = x0 ^ x3;   y8  = x0 ^ x5;
+	t0  = x1 ^ x2;   y1  = t0 ^ x7;   y4  = y1 ^ x3;   y12 = y13 ^ y14;
+	y2  = y1 ^ x0;   y5  = y1 ^ x6;   y3  = y5 ^ y8;   t1  = x4 ^ y12;
+	y15 = t1 ^ x5;   y20 = t1 ^ x1;   y6  = y15 ^ x7;  y10 = y15 ^ t0;
+	y11 = y20 ^ y9;  y7  = x7 ^ y11;  y17 = y10 ^ y11; y19 = y10 ^ y8;
+	y16 = t0 ^ y11;  y21 = y13 ^ y16; y18 = x0 ^ y16;
+
+	/* Non-linear section, which is the inversion in GF(2^8). */
+	t2  = y12 & y15; t3  = y3 & y6;   t4  = t3 ^ t2;   t5  = y4 & x7;
+	t6  = t5 ^ t2;   t7  = y13 & y16; t8  = y5 & y1;   t9  = t8 ^ t7;
+	t10 = y2 & y7;   t11 = t10 ^ t7;  t12 = y9 & y11;  t13 = y14 & y17;
+	t14 = t13 ^ t12; t15 = y8 & y10;  t16 = t15 ^ t12; t17 = t4 ^ t14;
+	t18 = t6 ^ t16;  t19 = t9 ^ t14;  t20 = t11 ^ t16; t21 = t17 ^ y20;
+	t22 = t18 ^ y19; t23 = t19 ^ y21; t24 = t20 ^ y18;
+
+	t25 = t21 ^ t22; t26 = t21 & t23; t27 = t24 ^ t26; t28 = t25 & t27;
+	t29 = t28 ^ t22; t30 = t23 ^ t24; t31 = t22 ^ t26; t32 = t31 & t30;
+	t33 = t32 ^ t24; t34 = t23 ^ t33; t35 = t27 ^ t33; t36 = t24 & t35;
+	t37 = t36 ^ t34; t38 = t27 ^ t36; t39 = t29 & t38; t40 = t25 ^ t39;
+
+	t41 = t40 ^ t37; t42 = t29 ^ t33; t43 = t29 ^ t40; t44 = t33 ^ t37;
+	t45 = t42 ^ t41;
+	z0  = t44 & y15; z1  = t37 & y6;  z2  = t33 & x7;  z3  = t43 & y16;
+	z4  = t40 & y1;  z5  = t29 & y7;  z6  = t42 & y11; z7  = t45 & y17;
+	z8  = t41 & y10; z9  = t44 & y12; z10 = t37 & y3;  z11 = t33 & y4;
+	z12 = t43 & y13; z13 = t40 & y5;  z14 = t29 & y2;  z15 = t42 & y9;
+	z16 = t45 & y14; z17 = t41 & y8;
+
+	/* Bottom linear transformation, which includes the affine map. */
+	t46 = z15 ^ z16; t47 = z10 ^ z11; t48 = z5 ^ z13;  t49 = z9 ^ z10;
+	t50 = z2 ^ z12;  t51 = z2 ^ z5;   t52 = z7 ^ z8;   t53 = z0 ^ z3;
+	t54 = z6 ^ z7;   t55 = z16 ^ z17; t56 = z12 ^ t48; t57 = t50 ^ t53;
+	t58 = z4 ^ t46;  t59 = z3 ^ t54;  t60 = t46 ^ t57; t61 = z14 ^ t57;
+	t62 = t52 ^ t58; t63 = t49 ^ t58; t64 = z4 ^ t59;  t65 = t61 ^ t62;
+	t66 = z1 ^ t63;
+	s0  = t59 ^ t63;  s6 = t56 ^ ~t62; s7 = t48 ^ ~t60; t67 = t64 ^ t65;
+	s3  = t53 ^ t66;  s4 = t51 ^ t66;  s5 = t47 ^ t65;  s1  = t64 ^ ~s3;
+	s2  = t55 ^ ~t67;
+
+	q[7] = s0; q[6] = s1; q[5] = s2; q[4] = s3;
+	q[3] = s4; q[2] = s5; q[1] = s6; q[0] = s7;
+
+} /* aes_sbox_planes */
+
+static inline uint64_t aes_transpose8( uint64_t x )
+{
+	/* Transpose the 8x8 bit matrix whose rows are the bytes of x. */
+	uint64_t t;
+
+	t = ( x ^ ( x >> 7  ) ) & 0x00aa00aa00aa00aaULL;  x ^= t ^ ( t << 7  );
+	t = ( x ^ ( x >> 14 ) ) & 0x0000cccc0000ccccULL;  x ^= t ^ ( t << 14 );
+	t = ( x ^ ( x >> 28 ) ) & 0x00000000f0f0f0f0ULL;  x ^= t ^ ( t << 28 );
+
+	return x;
+
+} /* aes_transpose8 */
+
+static void aes_sub_bytes( uint8_t* b, int n )
+{
+/**
+ * Substitutes up to 64 bytes by moving them into bit planes and back.
+ *
+ */
+
+	uint8_t  v [64] = { 0 };
+	uint64_t w [8];
+	uint64_t q [8] = { 0 };
+	int i;
+	int k;
+
+	memcpy( v, b, n );
+
+	for( i = 0 ; i < 8 ; i++ )
+	{
+		/* Byte k of w[i] holds bit k of the bytes v[8i..8i+7]. */
+		w[i] = aes_transpose8( (uint64_t)v[8 * i]           | (uint64_t)v[8 * i + 1] << 8  \
+		  | (uint64_t)v[8 * i + 2] << 16 | (uint64_t)v[8 * i + 3] << 24 | (uint64_t)v[8 * i + 4] << 32 \
+		  | (uint64_t)v[8 * i + 5] << 40 | (uint64_t)v[8 * i + 6] << 48 | (uint64_t)v[8 * i + 7] << 56 );
+
+		for( k = 0 ; k < 8 ; k++ )
+		{
+			q[k] |= ( ( w[i] >> ( 8 * k ) ) & 0xff ) << ( 8 * i );
+		}
+	}
+
+	aes_sbox_planes( q );
+
+	for( i = 0 ; i < 8 ; i++ )
+	{
+		w[i] = 0;
+
+		for( k = 0 ; k < 8 ; k++ )
+		{
+			w[i] |= ( ( q[k] >> ( 8 * i ) ) & 0xff ) << ( 8 * k );
+		}
+
+		w[i] = aes_transpose8( w[i] );
+
+		for( k = 0 ; k < 8 ; k++ )
+		{
+			v[8 * i + k] = (uint8_t)( w[i] >> ( 8 * k ) );
+		}
+	}
+
+	memcpy( b, v, n );
+
+} /* aes_sub_bytes */
+
+static inline uint8_t aes_xtime( uint8_t a )
+{
+	return (uint8_t)( ( a << 1 ) ^ ( 0x1b & -( a >> 7 ) ) );
+
+} /* aes_xtime */
+
+static void aes_encrypt_soft( const aes_ctr_state_t* aes, uint8_t* s )
+{
+/**
+ * Encrypts AES_SOFT_BLOCKS blocks in place. The state of each block is column major.
+ *
+ */
+
+	uint8_t t [AES_SOFT_BLOCKS * AES_BLOCK_SIZE];
+	int round;
+	int i;
+	int j;
+
+	for( i = 0 ; i < AES_SOFT_BLOCKS * AES_BLOCK_SIZE ; i++ )
+	{
+		s[i] ^= aes->round_key[i % AES_BLOCK_SIZE];
+	}
+
+	for( round = 1 ; round <= aes->rounds ; round++ )
+	{
+		aes_sub_bytes( s, AES_SOFT_BLOCKS * AES_BLOCK_SIZE );
+
+		/* ShiftRows. */
+		for( i = 0 ; i < AES_SOFT_BLOCKS * AES_BLOCK_SIZE ; i++ )
+		{
+			j = i % AES_BLOCK_SIZE;
+			t[i] = s[i - j + j % 4 + 4 * ( ( j / 4 + j % 4 ) % 4 )];
+		}
+
+		if( round < aes->rounds )
+		{
+			/* MixColumns. */
+			for( j = 0 ; j < AES_SOFT_BLOCKS * 4 ; j++ )
+			{
+				uint8_t* c = &t[4 * j];
+				uint8_t a = c[0] ^ c[1] ^ c[2] ^ c[3];
+				uint8_t c0 = c[0];
+
+				c[0] ^= a ^ aes_xtime( c[0] ^ c[1] );
+				c[1] ^= a ^ aes_xtime( c[1] ^ c[2] );
+				c[2] ^= a ^ aes_xtime( c[2] ^ c[3] );
+				c[3] ^= a ^ aes_xtime( c[3] ^ c0   );
+			}
+		}
+
+		for( i = 0 ; i < AES_SOFT_BLOCKS * AES_BLOCK_SIZE ; i++ )
+		{
+			s[i] = t[i] ^ aes->round_key[round * AES_BLOCK_SIZE + i % AES_BLOCK_SIZE];
+		}
+	}
+
+} /* aes_encrypt_soft */
+
+
+
+static inline void aes_counter_block( aes_ctr_state_t* aes, uint8_t* block )
+{
+	/* Write the counter big-endian and step it. */
+	int i;
+
+	for( i = 0 ; i < 8 ; i++ )
+	{
+		block[i]     = (uint8_t)( aes->counter_hi >> ( 56 - 8 * i ) );
+		block[i + 8] = (uint8_t)( aes->counter_lo >> ( 56 - 8 * i ) );
+	}
+
+	if( ++aes->counter_lo == 0 ) { aes->counter_hi += 1; }
+
+} /* aes_counter_block */
+
+static void aes_ctr_blocks_soft( aes_ctr_state_t* aes, uint8_t* out, size_t blocks )
+{
+	uint8_t s [AES_SOFT_BLOCKS * AES_BLOCK_SIZE];
+	size_t n;
+	size_t i;
+
+	while( blocks > 0 )
+	{
+		n = blocks < AES_SOFT_BLOCKS ? blocks : AES_SOFT_BLOCKS;
+
+		for( i = 0 ; i < AES_SOFT_BLOCKS ; i++ )
+		{
+			/* A short batch still encrypts whole planes, but only steps the counter for the blocks it keeps. */
+			if( i < n ) { aes_counter_block( aes, &s[i * AES_BLOCK_SIZE] ); }
+			else        { memset( &s[i * AES_BLOCK_SIZE], 0, AES_BLOCK_SIZE ); }
+		}
+
+		aes_encrypt_soft( aes, s );
+		memcpy( out, s, n * AES_BLOCK_SIZE );
+
+		out += n * AES_BLOCK_SIZE;
+		blocks -= n;
+	}
+
+} /* aes_ctr_blocks_soft */
+
+
+
+#ifdef AES_HAVE_NI
+
+#define AES_NI_BLOCK( i ) \
+	b##i = _mm_set_epi64x( __builtin_bswap64( aes->counter_lo ), __builtin_bswap64( aes->counter_hi ) ); \
+	b##i = _mm_xor_si128( b##i, k[0] ); \
+	if( ++aes->counter_lo == 0 ) { aes->counter_hi += 1; }
+
+__attribute__(( target( "aes,sse2" ) ))
+static void aes_ctr_blocks_ni( aes_ctr_state_t* aes, uint8_t* out, size_t blocks )
+{
+	__m128i k [AES_ROUNDS_MAX + 1];
+	__m128i b0, b1, b2, b3, b4, b5, b6, b7;
+	__m128i* o = (__m128i*)out;
+	int r;
+
+	for( r = 0 ; r <= aes->rounds ; r++ )
+	{
+		k[r] = _mm_load_si128( (const __m128i*)&aes->round_key[r * AES_BLOCK_SIZE] );
+	}
+
+	/* Keep eight independent blocks in flight to cover the aesenc latency. */
+	for( ; blocks >= AES_PARALLEL ; blocks -= AES_PARALLEL )
+	{
+		AES_NI_BLOCK( 0 ) AES_NI_BLOCK( 1 ) AES_NI_BLOCK( 2 ) AES_NI_BLOCK( 3 )
+		AES_NI_BLOCK( 4 ) AES_NI_BLOCK( 5 ) AES_NI_BLOCK( 6 ) AES_NI_BLOCK( 7 )
+
+		for( r = 1 ; r < aes->rounds ; r++ )
+		{
+			b0 = _mm_aesenc_si128( b0, k[r] );
+			b1 = _mm_aesenc_si128( b1, k[r] );
+			b2 = _mm_aesenc_si128( b2, k[r] );
+			b3 = _mm_aesenc_si128( b3, k[r] );
+			b4 = _mm_aesenc_si128( b4, k[r] );
+			b5 = _mm_aesenc_si128( b5, k[r] );
+			b6 = _mm_aesenc_si128( b6, k[r] );
+			b7 = _mm_aesenc_si128( b7, k[r] );
+		}
+
+		_mm_storeu_si128( o++, _mm_aesenclast_si128( b0, k[r] ) );
+		_mm_storeu_si128( o++, _mm_aesenclast_si128( b1, k[r] ) );
+		_mm_storeu_si128( o++, _mm_aesenclast_si128( b2, k[r] ) );
+		_mm_storeu_si128( o++, _mm_aesenclast_si128( b3, k[r] ) );
+		_mm_storeu_si128( o++, _mm_aesenclast_si128( b4, k[r] ) );
+		_mm_storeu_si128( o++, _mm_aesenclast_si128( b5, k[r] ) );
+		_mm_storeu_si128( o++, _mm_aesenclast_si128( b6, k[r] ) );
+		_mm_storeu_si128( o++, _mm_aesenclast_si128( b7, k[r] ) );
+	}
+
+	for( ; blocks > 0 ; blocks-- )
+	{
+		AES_NI_BLOCK( 0 )
+
+		for( r = 1 ; r < aes->rounds ; r++ )
+		{
+			b0 = _mm_aesenc_si128( b0, k[r] );
+		}
+
+		_mm_storeu_si128( o++, _mm_aesenclast_si128( b0, k[r] ) );
+	}
+
+} /* aes_ctr_blocks_ni */
+
+#endif /* AES_HAVE_NI */
+
+
+
+int aes_hardware( void )
+{
+#ifdef AES_HAVE_NI
+	return dwipe_cpu_aes();
+#else
+	return 0;
+#endif
+
+} /* aes_hardware */
+
+
+
+void aes_ctr_init( aes_ctr_state_t* aes, const uint8_t* key, int key_length, const uint8_t* iv )
+{
+/**
+ * Expands the key as in FIPS-197. AES-NI reads the same round keys, so there is only one
+ * key schedule.
+ *
+ */
+
+	uint8_t* w = aes->round_key;
+	uint8_t t [4];
+	uint8_t rcon = 1;
+	int nk = key_length >= 32 ? 8 : 4;
+	int words;
+	int i;
+	int j;
+
+	aes->rounds = nk + 6;
+	words = 4 * ( aes->rounds + 1 );
+
+	memcpy( w, key, nk * 4 );
+
+	for( i = nk ; i < words ; i++ )
+	{
+		memcpy( t, &w[( i - 1 ) * 4], 4 );
+
+		if( i % nk == 0 )
+		{
+			/* RotWord, SubWord and Rcon. */
+			uint8_t t0 = t[0];
+
+			t[0] = t[1];
+			t[1] = t[2];
+			t[2] = t[3];
+			t[3] = t0;
+
+			aes_sub_bytes( t, 4 );
+			t[0] ^= rcon;
+
+			rcon = aes_xtime( rcon );
+		}
+
+		else if( nk > 6 && i % nk == 4 )
+		{
+			aes_sub_bytes( t, 4 );
+		}
+
+		for( j = 0 ; j < 4 ; j++ )
+		{
+			w[i * 4 + j] = w[( i - nk ) * 4 + j] ^ t[j];
+		}
+	}
+
+	aes->counter_hi = 0;
+	aes->counter_lo = 0;
+
+	for( i = 0 ; i < 8 ; i++ )
+	{
+		aes->counter_hi = ( aes->counter_hi << 8 ) | iv[i];
+		aes->counter_lo = ( aes->counter_lo << 8 ) | iv[i + 8];
+	}
+
+	aes->origin_hi = aes->counter_hi;
+	aes->origin_lo = aes->counter_lo;
+
+	aes->left = 0;
+	aes->hardware = aes_hardware();
+
+} /* aes_ctr_init */
+
+
+
+static void aes_ctr_blocks( aes_ctr_state_t* aes, uint8_t* out, size_t blocks )
+{
+#ifdef AES_HAVE_NI
+	if( aes->hardware )
+	{
+		aes_ctr_blocks_ni( aes, out, blocks );
+		return;
+	}
+#endif
+
+	aes_ctr_blocks_soft( aes, out, blocks );
+
+} /* aes_ctr_blocks */
+
+void aes_ctr_read( aes_ctr_state_t* aes, uint8_t* buffer, size_t count )
+{
+	size_t n;
+
+	/* Drain the keystream that is left over from the last call. */
+	n = count < aes->left ? count : aes->left;
+	memcpy( buffer, aes->stream + sizeof( aes->stream ) - aes->left, n );
+	aes->left -= n;
+	buffer += n;
+	count -= n;
+
+	/* Encrypt whole blocks straight into the buffer. */
+	n = count / AES_BLOCK_SIZE;
+	aes_ctr_blocks( aes, buffer, n );
+	buffer += n * AES_BLOCK_SIZE;
+	count -= n * AES_BLOCK_SIZE;
+
+	if( count > 0 )
+	{
+		/* Keep the rest of the last block for the next call. */
+		aes_ctr_blocks( aes, aes->stream, 1 );
+		memcpy( buffer, aes->stream, count );
+		aes->left = AES_BLOCK_SIZE - count;
+	}
+
+} /* aes_ctr_read */
+
+void aes_ctr_seek( aes_ctr_state_t* aes, uint64_t offset )
+{
+	/* The counter wraps like a 128-bit integer. */
+	aes->counter_lo = aes->origin_lo + offset / AES_BLOCK_SIZE;
+	aes->counter_hi = aes->origin_hi + ( aes->counter_lo < aes->origin_lo );
+	aes->left = 0;
+
+	if( offset % AES_BLOCK_SIZE != 0 )
+	{
+		/* Encrypt the block that holds the offset, and drop the bytes in front of it. */
+		aes_ctr_blocks( aes, aes->stream, 1 );
+		aes->left = AES_BLOCK_SIZE - offset % AES_BLOCK_SIZE;
+	}
+
+} /* aes_ctr_seek */
+
+/* eof */
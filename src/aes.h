@@ -0,0 +1,58 @@
+/*
+ *  aes.h: AES in counter mode as a keystream generator for dwipe.
+ *
+ *  Copyright Paolo Iannelli <info@paoloiannelli.com>.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc., 675 Mass
+ *  Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#ifndef AES_H_
+#define AES_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define AES_BLOCK_SIZE    16
+#define AES_ROUNDS_MAX    14
+#define AES_PARALLEL      8    /* Counter blocks that are encrypted together. */
+
+typedef struct aes_ctr_state_t_
+{
+	uint8_t  round_key[( AES_ROUNDS_MAX + 1 ) * AES_BLOCK_SIZE] __attribute__(( aligned( 16 ) ));
+	uint8_t  stream[AES_BLOCK_SIZE];   /* The keystream block that a short read split.  */
+	uint64_t counter_hi;   /* The 128-bit big-endian counter block, in host order. */
+	uint64_t counter_lo;
+	uint64_t origin_hi;    /* The initial counter block, which is offset zero.     */
+	uint64_t origin_lo;
+	size_t   left;         /* The number of unread bytes at the end of stream.     */
+	int      rounds;       /* 10 for AES-128, 14 for AES-256.                      */
+	int      hardware;     /* Set when AES-NI is used.                              */
+} aes_ctr_state_t;
+
+/* Returns non-zero when the CPU has the AES-NI instructions. */
+int  aes_hardware( void );
+
+/* Set up AES-128 or AES-256, depending on key_length, with a 16-byte initial counter block. */
+void aes_ctr_init( aes_ctr_state_t* aes, const uint8_t* key, int key_length, const uint8_t* iv );
+
+/* Write count bytes of keystream, keeping any unread tail for the next call. */
+void aes_ctr_read( aes_ctr_state_t* aes, uint8_t* buffer, size_t count );
+
+/* Move to a byte offset of the keystream without encrypting anything in front of it. */
+void aes_ctr_seek( aes_ctr_state_t* aes, uint64_t offset );
+
+#endif /* AES_H_ */
+
+/* eof */
@@ -0,0 +1,341 @@
+/*
+ *  backend.c: Pluggable i/o backends for the dwipe pass routines.
+ *
+ *  Copyright Paolo Iannelli <info@paoloiannelli.com>.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc., 675 Mass
+ *  Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include "dwipe.h"
+#include "context.h"
+#include "backend.h"
+#include "logging.h"
+
+#include <sys/mman.h>
+#include <setjmp.h>
+#include <signal.h>
+
+/* Where a media error in the mapping returns to, and whether a copy is running. */
+static __thread sigjmp_buf dwipe_mmap_env;
+static __thread volatile sig_atomic_t dwipe_mmap_guard = 0;
+
+dwipe_backend_t dwipe_backend_posix =
+{
+	"POSIX (pread/pwrite)",
+	DWIPE_BACKEND_CAP_READ | DWIPE_BACKEND_CAP_DISCARD | DWIPE_BACKEND_CAP_DURABLE,
+	dwipe_posix_open,
+	dwipe_posix_close,
+	dwipe_posix_write,
+	dwipe_posix_read,
+	dwipe_posix_flush,
+	dwipe_posix_discard
+};
+
+dwipe_backend_t dwipe_backend_mmap =
+{
+	"Memory Map (mmap/msync)",
+	DWIPE_BACKEND_CAP_READ | DWIPE_BACKEND_CAP_DISCARD | DWIPE_BACKEND_CAP_DURABLE,
+	dwipe_mmap_open,
+	dwipe_mmap_close,
+	dwipe_mmap_write,
+	dwipe_mmap_read,
+	dwipe_mmap_flush,
+	dwipe_posix_discard
+};
+
+dwipe_backend_t dwipe_backend_null =
+{
+	"Null Sink (benchmark)",
+	0,
+	dwipe_null_open,
+	dwipe_posix_close,
+	dwipe_null_write,
+	dwipe_null_read,
+	dwipe_null_flush,
+	dwipe_null_discard
+};
+
+
+
+int dwipe_posix_open( DWIPE_BACKEND_OPEN_SIGNATURE )
+{
+	/* The device was opened by the parent, so there is nothing to do. */
+	c->backend_state = NULL;
+	return 0;
+}
+
+int dwipe_posix_close( DWIPE_BACKEND_CLOSE_SIGNATURE )
+{
+	c->backend_state = NULL;
+	return 0;
+}
+
+ssize_t dwipe_posix_write( DWIPE_BACKEND_WRITE_SIGNATURE )
+{
+	ssize_t r = pwrite( c->device_fd, buffer, count, offset );
+
+	if( r <= 0 || c->writeback_window == 0 ) { return r; }
+
+	if( offset != c->writeback_end )
+	{
+		/* The writes are not sequential, so start a new window here. */
+		c->writeback_start = offset;
+	}
+
+	c->writeback_end = offset + r;
+
+	if( c->writeback_end - c->writeback_start >= c->writeback_window )
+	{
+		/* Start writing this window back, and wait for the one before it, */
+		/* so that at most two windows of dirty data are in the page cache. */
+		sync_file_range( c->device_fd, c->writeback_start, c->writeback_end - c->writeback_start, SYNC_FILE_RANGE_WRITE );
+
+		if( c->writeback_start >= c->writeback_window )
+		{
+			sync_file_range( c->device_fd, c->writeback_start - c->writeback_window, c->writeback_window, \
+			  SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER );
+		}
+
+		c->writeback_start = c->writeback_end;
+	}
+
+	return r;
+}
+
+ssize_t dwipe_posix_read( DWIPE_BACKEND_READ_SIGNATURE )
+{
+	return pread( c->device_fd, buffer, count, offset );
+}
+
+int dwipe_posix_flush( DWIPE_BACKEND_FLUSH_SIGNATURE )
+{
+	return fdatasync( c->device_fd );
+}
+
+int dwipe_posix_discard( DWIPE_BACKEND_DISCARD_SIGNATURE )
+{
+	/* The BLKDISCARD argument is a start and length pair. */
+	u64 range [2];
+
+	if( S_ISREG( c->device_stat.st_mode ) )
+	{
+		/* Punch a hole into the file and keep its size. */
+		return fallocate( c->device_fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, length );
+	}
+
+	range[0] = offset;
+	range[1] = length;
+
+	return ioctl( c->device_fd, BLKDISCARD, &range );
+}
+
+
+
+static void dwipe_mmap_sigbus( int signum )
+{
+/**
+ * Catches a media error in the mapping, which the kernel delivers as SIGBUS instead of
+ * an error return, and abandons the copy that touched it. A SIGBUS outside of a copy
+ * is a real bug, so it still kills the process.
+ *
+ */
+
+	if( dwipe_mmap_guard )
+	{
+		dwipe_mmap_guard = 0;
+		siglongjmp( dwipe_mmap_env, 1 );
+	}
+
+	signal( SIGBUS, SIG_DFL );
+	raise( SIGBUS );
+
+} /* dwipe_mmap_sigbus */
+
+
+
+static ssize_t dwipe_mmap_copy( void* dst, const void* src, size_t count, loff_t offset )
+{
+/**
+ * Copies between the buffer and the mapping one page at a time, so that a media error
+ * ends the copy like a short pwrite() or pread() does.
+ *
+ * @returns  The bytes copied before the failed page, or -1 with errno EIO if the first
+ *           page failed.
+ *
+ */
+
+	static long page = 0;
+
+	/* The progress, which must survive the jump back from the handler. */
+	volatile size_t done = 0;
+
+	size_t n;
+
+	if( page == 0 ) { page = sysconf( _SC_PAGESIZE ); }
+
+	if( sigsetjmp( dwipe_mmap_env, 1 ) != 0 )
+	{
+		if( done > 0 ) { return done; }
+
+		errno = EIO;
+		return -1;
+	}
+
+	dwipe_mmap_guard = 1;
+
+	while( done < count )
+	{
+		/* Stop at each page boundary of the device. */
+		n = page - ( offset + done ) % page;
+
+		if( n > count - done ) { n = count - done; }
+
+		memcpy( (char*)dst + done, (const char*)src + done, n );
+		done += n;
+	}
+
+	dwipe_mmap_guard = 0;
+
+	return done;
+
+} /* dwipe_mmap_copy */
+
+
+
+int dwipe_mmap_open( DWIPE_BACKEND_OPEN_SIGNATURE )
+{
+	/* The handler that turns a media error in the mapping into a failed copy. */
+	struct sigaction sa;
+
+	/* The whole device is mapped once, so this needs a 64-bit address space. */
+	void* m = mmap( NULL, c->device_size, PROT_READ | PROT_WRITE, MAP_SHARED, c->device_fd, 0 );
+
+	if( m == MAP_FAILED )
+	{
+		dwipe_perror( errno, __FUNCTION__, "mmap" );
+		dwipe_log( DWIPE_LOG_FATAL, "Unable to map '%s' into memory.", c->device_name );
+		return -1;
+	}
+
+	memset( &sa, 0, sizeof( sa ) );
+	sa.sa_handler = dwipe_mmap_sigbus;
+	sigemptyset( &sa.sa_mask );
+
+	if( sigaction( SIGBUS, &sa, NULL ) != 0 )
+	{
+		dwipe_perror( errno, __FUNCTION__, "sigaction" );
+		dwipe_log( DWIPE_LOG_FATAL, "Unable to catch media errors on '%s'.", c->device_name );
+		munmap( m, c->device_size );
+		return -1;
+	}
+
+	/* Sequential access lets the kernel write back behind us. */
+	madvise( m, c->device_size, MADV_SEQUENTIAL );
+
+	c->backend_state = m;
+	return 0;
+}
+
+int dwipe_mmap_close( DWIPE_BACKEND_CLOSE_SIGNATURE )
+{
+	int r = 0;
+
+	if( c->backend_state != NULL )
+	{
+		r = munmap( c->backend_state, c->device_size );
+		c->backend_state = NULL;
+	}
+
+	return r;
+}
+
+ssize_t dwipe_mmap_write( DWIPE_BACKEND_WRITE_SIGNATURE )
+{
+	/* The page that holds the offset, because madvise() takes page aligned ranges. */
+	loff_t start = offset & ~(loff_t)( sysconf( _SC_PAGESIZE ) - 1 );
+
+	if( offset + count > c->device_size )
+	{
+		count = c->device_size - offset;
+	}
+
+#ifdef MADV_POPULATE_WRITE
+	/* Fault the block in with one call instead of one read per page during the copy. */
+	madvise( (char*)c->backend_state + start, offset + count - start, MADV_POPULATE_WRITE );
+#endif
+
+	if( offset + count * 2 <= c->device_size )
+	{
+		/* Start reading the next block in while this one is copied. */
+		madvise( (char*)c->backend_state + start + count, count, MADV_WILLNEED );
+	}
+
+	return dwipe_mmap_copy( (char*)c->backend_state + offset, buffer, count, offset );
+}
+
+ssize_t dwipe_mmap_read( DWIPE_BACKEND_READ_SIGNATURE )
+{
+	if( offset + count > c->device_size )
+	{
+		count = c->device_size - offset;
+	}
+
+	return dwipe_mmap_copy( buffer, (char*)c->backend_state + offset, count, offset );
+}
+
+int dwipe_mmap_flush( DWIPE_BACKEND_FLUSH_SIGNATURE )
+{
+	if( msync( c->backend_state, c->device_size, MS_SYNC ) != 0 )
+	{
+		return -1;
+	}
+
+	/* Also flush the device write cache. */
+	return fdatasync( c->device_fd );
+}
+
+
+
+int dwipe_null_open( DWIPE_BACKEND_OPEN_SIGNATURE )
+{
+	dwipe_log( DWIPE_LOG_WARNING, "The null i/o backend does not write anything to '%s'.", c->device_name );
+	c->backend_state = NULL;
+	return 0;
+}
+
+ssize_t dwipe_null_write( DWIPE_BACKEND_WRITE_SIGNATURE )
+{
+	/* Swallow the buffer so that only the pass and PRNG pipeline is measured. */
+	return count;
+}
+
+ssize_t dwipe_null_read( DWIPE_BACKEND_READ_SIGNATURE )
+{
+	/* The sink keeps nothing, so there is nothing to read back. */
+	errno = EOPNOTSUPP;
+	return -1;
+}
+
+int dwipe_null_flush( DWIPE_BACKEND_FLUSH_SIGNATURE )
+{
+	return 0;
+}
+
+int dwipe_null_discard( DWIPE_BACKEND_DISCARD_SIGNATURE )
+{
+	return 0;
+}
+
+/* eof */
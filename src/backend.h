@@ -0,0 +1,81 @@
+/*
+ *  backend.h: Pluggable i/o backends for the dwipe pass routines.
+ *
+ *  Copyright Paolo Iannelli <info@paoloiannelli.com>.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc., 675 Mass
+ *  Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#ifndef BACKEND_H_
+#define BACKEND_H_
+
+/* Backend capability flags. */
+#define DWIPE_BACKEND_CAP_READ     0x01  /* Data can be read back for verification.  */
+#define DWIPE_BACKEND_CAP_DISCARD  0x02  /* Ranges can be discarded or punched out.  */
+#define DWIPE_BACKEND_CAP_DURABLE  0x04  /* A flush puts the data on the media.      */
+
+#define DWIPE_BACKEND_OPEN_SIGNATURE    dwipe_context_t* c
+#define DWIPE_BACKEND_CLOSE_SIGNATURE   dwipe_context_t* c
+#define DWIPE_BACKEND_WRITE_SIGNATURE   dwipe_context_t* c, const void* buffer, size_t count, loff_t offset
+#define DWIPE_BACKEND_READ_SIGNATURE    dwipe_context_t* c, void* buffer, size_t count, loff_t offset
+#define DWIPE_BACKEND_FLUSH_SIGNATURE   dwipe_context_t* c
+#define DWIPE_BACKEND_DISCARD_SIGNATURE dwipe_context_t* c, loff_t offset, u64 length
+
+/* Function pointers for backend actions. */
+typedef int(*dwipe_backend_open_t)( DWIPE_BACKEND_OPEN_SIGNATURE );
+typedef int(*dwipe_backend_close_t)( DWIPE_BACKEND_CLOSE_SIGNATURE );
+typedef ssize_t(*dwipe_backend_write_t)( DWIPE_BACKEND_WRITE_SIGNATURE );
+typedef ssize_t(*dwipe_backend_read_t)( DWIPE_BACKEND_READ_SIGNATURE );
+typedef int(*dwipe_backend_flush_t)( DWIPE_BACKEND_FLUSH_SIGNATURE );
+typedef int(*dwipe_backend_discard_t)( DWIPE_BACKEND_DISCARD_SIGNATURE );
+
+/* The generic backend definition, which is forward declared in context.h. */
+struct dwipe_backend_t_
+{
+	const char*             label;    /* The name of the i/o backend.                              */
+	int                     caps;     /* The DWIPE_BACKEND_CAP_* flags.                            */
+	dwipe_backend_open_t    open;     /* Prepare the device for i/o in the child process.          */
+	dwipe_backend_close_t   close;    /* Release whatever open() acquired.                         */
+	dwipe_backend_write_t   write;    /* Write count bytes at offset, like pwrite().               */
+	dwipe_backend_read_t    read;     /* Read count bytes at offset, like pread().                 */
+	dwipe_backend_flush_t   flush;    /* Push written data to the device, like fdatasync().        */
+	dwipe_backend_discard_t discard;  /* Tell the device that a range is unused.                   */
+};
+
+/* POSIX prototypes. */
+int     dwipe_posix_open( DWIPE_BACKEND_OPEN_SIGNATURE );
+int     dwipe_posix_close( DWIPE_BACKEND_CLOSE_SIGNATURE );
+ssize_t dwipe_posix_write( DWIPE_BACKEND_WRITE_SIGNATURE );
+ssize_t dwipe_posix_read( DWIPE_BACKEND_READ_SIGNATURE );
+int     dwipe_posix_flush( DWIPE_BACKEND_FLUSH_SIGNATURE );
+int     dwipe_posix_discard( DWIPE_BACKEND_DISCARD_SIGNATURE );
+
+/* Memory map prototypes. */
+int     dwipe_mmap_open( DWIPE_BACKEND_OPEN_SIGNATURE );
+int     dwipe_mmap_close( DWIPE_BACKEND_CLOSE_SIGNATURE );
+ssize_t dwipe_mmap_write( DWIPE_BACKEND_WRITE_SIGNATURE );
+ssize_t dwipe_mmap_read( DWIPE_BACKEND_READ_SIGNATURE );
+int     dwipe_mmap_flush( DWIPE_BACKEND_FLUSH_SIGNATURE );
+
+/* Null sink prototypes. */
+int     dwipe_null_open( DWIPE_BACKEND_OPEN_SIGNATURE );
+ssize_t dwipe_null_write( DWIPE_BACKEND_WRITE_SIGNATURE );
+ssize_t dwipe_null_read( DWIPE_BACKEND_READ_SIGNATURE );
+int     dwipe_null_flush( DWIPE_BACKEND_FLUSH_SIGNATURE );
+int     dwipe_null_discard( DWIPE_BACKEND_DISCARD_SIGNATURE );
+
+#endif /* BACKEND_H_ */
+
+/* eof */
@@ -0,0 +1,584 @@
+/*
+ *  bench_prng.c: Micro-benchmark for the PRNGs and the dispatched pass kernels.
+ *
+ *  Copyright Paolo Iannelli <info@paoloiannelli.com>.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc., 675 Mass
+ *  Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include "dwipe.h"
+#include "context.h"
+#include "method.h"
+#include "prng.h"
+#include "options.h"
+#include "logging.h"
+#include "cpu.h"
+
+#include <pthread.h>
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#define BENCH_TSC
+#include <x86intrin.h>
+#endif
+
+/* The defaults, which can all be changed on the command line. */
+#define DWIPE_KNOB_BENCH_SIZES   "4096,65536,1048576,16777216"
+#define DWIPE_KNOB_BENCH_BYTES   134217728
+#define DWIPE_KNOB_BENCH_LIST    16
+
+/* What a benchmark job runs. */
+typedef enum bench_kind_t_
+{
+	BENCH_PRNG = 0,    /* dwipe_prng_fill() from one seeded state.          */
+	BENCH_FILL,        /* dwipe_kernels.pattern_fill() with a static pattern. */
+	BENCH_EQUAL,       /* dwipe_kernels.equal() over two matching buffers.    */
+	BENCH_ZERO         /* dwipe_kernels.is_zero() over a zeroed buffer.       */
+} bench_kind_t;
+
+/* One benchmark, which runs once on every thread. */
+typedef struct bench_job_t_
+{
+	bench_kind_t       kind;     /* What to run.                                  */
+	const char*        name;     /* The name in the report.                       */
+	dwipe_prng_t*      prng;     /* The generator for BENCH_PRNG.                 */
+	const char*        pattern;  /* The pattern for BENCH_FILL.                   */
+	size_t             length;   /* The pattern length.                           */
+	size_t             size;     /* The bytes that one call handles.              */
+	u64                bytes;    /* The bytes that each thread handles.           */
+	pthread_barrier_t* start;    /* Released when every thread is ready.          */
+	double             t0, t1;   /* When this thread started and finished.        */
+	u64                cycles;   /* The TSC ticks between the two.                */
+	volatile int       sink;     /* Keeps the compare results alive.              */
+	int                failed;   /* Set if the setup failed.                      */
+} bench_job_t;
+
+/* One line of the report. */
+typedef struct bench_result_t_
+{
+	const char* kind;
+	const char* name;
+	const char* variant;
+	size_t      size;
+	int         threads;
+	u64         bytes;
+	double      seconds;
+	double      gbps;
+	double      cpb;
+} bench_result_t;
+
+/* The command line settings. */
+static size_t      bench_sizes   [DWIPE_KNOB_BENCH_LIST];
+static int         bench_threads [DWIPE_KNOB_BENCH_LIST];
+static int         bench_size_count;
+static int         bench_thread_count;
+static u64         bench_bytes = DWIPE_KNOB_BENCH_BYTES;
+static const char* bench_json;
+static const char* bench_only;
+static int         bench_cpu = DWIPE_CPU_AVX512;
+
+/* The collected results. */
+static bench_result_t* bench_results;
+static int             bench_result_count;
+
+
+
+static u64 bench_cycles( void )
+{
+#ifdef BENCH_TSC
+	return __rdtsc();
+#else
+	return 0;
+#endif
+
+} /* bench_cycles */
+
+static double bench_now( void )
+{
+	struct timespec t;
+
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	return t.tv_sec + t.tv_nsec / 1e9;
+
+} /* bench_now */
+
+static int bench_list( const char* s, int sizes )
+{
+/**
+ * Parses a comma separated list of sizes or thread counts into the settings.
+ *
+ * @parameter  s      The list, where sizes may end in k, m or g.
+ * @parameter  sizes  Non-zero for the size list, zero for the thread list.
+ * @return     The number of entries, or -1 if the list is bad.
+ *
+ */
+
+	int count = 0;
+	char* end;
+	unsigned long long v;
+
+	while( *s != 0 )
+	{
+		if( count == DWIPE_KNOB_BENCH_LIST ) { return -1; }
+
+		v = strtoull( s, &end, 10 );
+
+		if( end == s ) { return -1; }
+
+		switch( *end )
+		{
+			case 'k': case 'K': v <<= 10; end++; break;
+			case 'm': case 'M': v <<= 20; end++; break;
+			case 'g': case 'G': v <<= 30; end++; break;
+		}
+
+		if( v == 0 || ( *end != ',' && *end != 0 ) ) { return -1; }
+
+		if( sizes ) { bench_sizes[count++] = v; }
+		else        { bench_threads[count++] = v; }
+
+		s = *end == ',' ? end + 1 : end;
+	}
+
+	return count;
+
+} /* bench_list */
+
+static void* bench_thread( void* ptr )
+{
+/**
+ * Runs one job on this thread. The setup and a warm-up call happen before the start barrier.
+ *
+ */
+
+	bench_job_t* job = (bench_job_t*) ptr;
+
+	/* A fixed seed so that every run generates the same data. */
+	u8 key [32];
+	dwipe_entropy_t seed = { sizeof( key ), key };
+
+	void* state = NULL;
+	char* a = NULL;
+	char* b = NULL;
+	u64 done;
+	int sink = 0;
+	int i;
+
+	for( i = 0; i < sizeof( key ); i++ ) { key[i] = i * 7 + 1; }
+
+	/* Pad the buffers like the pass routines do for the pattern overrun. */
+	if( posix_memalign( (void**)&a, 64, job->size + 64 ) != 0
+	 || posix_memalign( (void**)&b, 64, job->size + 64 ) != 0 )
+	{
+		dwipe_perror( errno, __FUNCTION__, "posix_memalign" );
+		job->failed = 1;
+	}
+
+	else if( job->kind == BENCH_PRNG && job->prng->init( &state, &seed ) != 0 )
+	{
+		job->failed = 1;
+	}
+
+	else
+	{
+		/* Fault the pages in and give the second buffer the same contents. */
+		memset( a, 0, job->size + 64 );
+		memset( b, 0, job->size + 64 );
+
+		if( job->kind == BENCH_PRNG ) { dwipe_prng_fill( job->prng, &state, a, job->size ); }
+		if( job->kind == BENCH_FILL ) { dwipe_kernels.pattern_fill( a, job->size, job->pattern, job->length ); }
+	}
+
+	pthread_barrier_wait( job->start );
+
+	/* Each thread times itself, because the main thread may not run again until they finish. */
+	job->t0 = bench_now();
+	job->cycles = bench_cycles();
+
+	for( done = 0; ! job->failed && done < job->bytes; done += job->size )
+	{
+		switch( job->kind )
+		{
+			case BENCH_PRNG:
+				dwipe_prng_fill( job->prng, &state, a, job->size );
+				break;
+
+			case BENCH_FILL:
+				dwipe_kernels.pattern_fill( a, job->size, job->pattern, job->length );
+				break;
+
+			case BENCH_EQUAL:
+				sink += dwipe_kernels.equal( a, b, job->size );
+				break;
+
+			case BENCH_ZERO:
+				sink += dwipe_kernels.is_zero( a, job->size );
+				break;
+		}
+	}
+
+	job->cycles = bench_cycles() - job->cycles;
+	job->t1 = bench_now();
+	job->sink = sink;
+
+	/* The generators allocate their state with malloc or posix_memalign. */
+	free( state );
+	free( a );
+	free( b );
+
+	return NULL;
+
+} /* bench_thread */
+
+static int bench_run( bench_job_t* model, const char* kind, const char* variant, int threads )
+{
+/**
+ * Runs a job on each of the threads at once and records the aggregate throughput.
+ *
+ * @return  0 on success, -1 if a thread could not be set up.
+ *
+ */
+
+	pthread_barrier_t start;
+	bench_job_t* jobs;
+	pthread_t* tid;
+	bench_result_t* r;
+	double t0 = 0, t1 = 0;
+	u64 cycles = 0;
+	int failed = 0;
+	int i;
+
+	jobs = calloc( threads, sizeof( bench_job_t ) );
+	tid = calloc( threads, sizeof( pthread_t ) );
+	r = realloc( bench_results, ( bench_result_count + 1 ) * sizeof( bench_result_t ) );
+
+	if( jobs == NULL || tid == NULL || r == NULL )
+	{
+		dwipe_perror( errno, __FUNCTION__, "calloc" );
+		free( jobs );
+		free( tid );
+		return -1;
+	}
+
+	bench_results = r;
+	pthread_barrier_init( &start, NULL, threads + 1 );
+
+	for( i = 0; i < threads; i++ )
+	{
+		jobs[i] = *model;
+		jobs[i].start = &start;
+
+		/* Round the share of each thread up to whole calls. */
+		jobs[i].bytes = ( bench_bytes / threads + model->size - 1 ) / model->size * model->size;
+
+		pthread_create( &tid[i], NULL, bench_thread, &jobs[i] );
+	}
+
+	pthread_barrier_wait( &start );
+
+	/* The run lasts from the first start to the last finish. */
+	for( i = 0; i < threads; i++ )
+	{
+		pthread_join( tid[i], NULL );
+		failed |= jobs[i].failed;
+		cycles += jobs[i].cycles;
+
+		if( i == 0 || jobs[i].t0 < t0 ) { t0 = jobs[i].t0; }
+		if( i == 0 || jobs[i].t1 > t1 ) { t1 = jobs[i].t1; }
+	}
+
+	pthread_barrier_destroy( &start );
+
+	r = &bench_results[bench_result_count];
+	r->kind = kind;
+	r->name = model->name;
+	r->variant = variant;
+	r->size = model->size;
+	r->threads = threads;
+	r->bytes = jobs[0].bytes * threads;
+	r->seconds = t1 - t0;
+	r->gbps = r->bytes / r->seconds / 1e9;
+
+	/* The TSC counts at the reference clock, so this is the sum of the thread times in reference cycles. */
+	r->cpb = (double)cycles / r->bytes;
+
+	free( jobs );
+	free( tid );
+
+	if( failed )
+	{
+		fprintf( stderr, "Error: Unable to set up the '%s' benchmark.\n", model->name );
+		return -1;
+	}
+
+	printf( "%-6s %-20s %-8s %10lu %3i %9.3f GB/s %8.3f c/B\n", \
+	  r->kind, r->name, r->variant, (unsigned long)r->size, r->threads, r->gbps, r->cpb );
+	fflush( stdout );
+
+	bench_result_count += 1;
+	return 0;
+
+} /* bench_run */
+
+static int bench_wanted( const char* name )
+{
+	/* Matches a name against the comma separated --only list. */
+	const char* s = bench_only;
+	size_t n = strlen( name );
+
+	if( s == NULL ) { return 1; }
+
+	while( ( s = strstr( s, name ) ) != NULL )
+	{
+		if( ( s == bench_only || s[-1] == ',' ) && ( s[n] == ',' || s[n] == 0 ) ) { return 1; }
+		s += n;
+	}
+
+	return 0;
+
+} /* bench_wanted */
+
+static int bench_write_json( const char* path )
+{
+/**
+ * Writes the results as JSON so that runs can be compared by a script.
+ *
+ */
+
+	FILE* fp;
+	char host [256];
+	int i;
+
+	fp = fopen( path, "w" );
+
+	if( fp == NULL )
+	{
+		fprintf( stderr, "Error: Unable to open '%s' for the JSON report.\n", path );
+		return -1;
+	}
+
+	if( gethostname( host, sizeof( host ) ) != 0 ) { strcpy( host, "unknown" ); }
+	host[sizeof( host ) - 1] = 0;
+
+	fprintf( fp, "{\n" );
+	fprintf( fp, "  \"version\": \"%s\",\n", _DWIPE_VERSION );
+	fprintf( fp, "  \"host\": \"%s\",\n", host );
+	fprintf( fp, "  \"time\": %lu,\n", (unsigned long)time( NULL ) );
+	fprintf( fp, "  \"cpu\": { \"detected\": \"%s\", \"limit\": \"%s\", \"aes\": %s },\n", \
+	  dwipe_cpu_label( dwipe_cpu_detect() ), dwipe_cpu_label( dwipe_cpu_level() ), dwipe_cpu_aes() ? "true" : "false" );
+	fprintf( fp, "  \"bytes\": %llu,\n", bench_bytes );
+	fprintf( fp, "  \"results\": [\n" );
+
+	for( i = 0; i < bench_result_count; i++ )
+	{
+		bench_result_t* r = &bench_results[i];
+
+		fprintf( fp, "    { \"kind\": \"%s\", \"name\": \"%s\", \"variant\": \"%s\", \"size\": %lu, \"threads\": %i, " \
+		  "\"bytes\": %llu, \"seconds\": %.6f, \"gbps\": %.4f, \"cycles_per_byte\": ", \
+		  r->kind, r->name, r->variant, (unsigned long)r->size, r->threads, r->bytes, r->seconds, r->gbps );
+
+#ifdef BENCH_TSC
+		fprintf( fp, "%.4f }%s\n", r->cpb, i + 1 < bench_result_count ? "," : "" );
+#else
+		fprintf( fp, "null }%s\n", i + 1 < bench_result_count ? "," : "" );
+#endif
+	}
+
+	fprintf( fp, "  ]\n}\n" );
+
+	if( fclose( fp ) != 0 )
+	{
+		fprintf( stderr, "Error: Unable to write the JSON report to '%s'.\n", path );
+		return -1;
+	}
+
+	return 0;
+
+} /* bench_write_json */
+
+static void bench_usage( const char* argv0 )
+{
+	printf( "Usage: %s [options]\n", argv0 );
+	printf( "  --sizes=LIST    Bytes per call, like 4k,1m (default %s).\n", DWIPE_KNOB_BENCH_SIZES );
+	printf( "  --threads=LIST  Thread counts (default 1 and the number of CPUs).\n" );
+	printf( "  --bytes=N       Bytes per benchmark over all threads (default %i).\n", DWIPE_KNOB_BENCH_BYTES );
+	printf( "  --cpu=LEVEL     Highest instruction set: generic, sse2, avx2 or avx512.\n" );
+	printf( "  --only=LIST     Only run these, like aes-ctr,chacha20,fill,equal,zero.\n" );
+	printf( "  --json=FILE     Write the results to FILE as JSON.\n" );
+
+} /* bench_usage */
+
+
+
+int main( int argc, char** argv )
+{
+	extern dwipe_prng_t dwipe_twister;
+	extern dwipe_prng_t dwipe_isaac;
+	extern dwipe_prng_t dwipe_sfmt;
+	extern dwipe_prng_t dwipe_aes_ctr;
+	extern dwipe_prng_t dwipe_chacha20;
+	extern dwipe_prng_t dwipe_philox;
+	extern dwipe_prng_t dwipe_xoshiro;
+
+	/* The generators by the names that --prng takes. */
+	struct { const char* name; dwipe_prng_t* prng; } prngs [] =
+	{
+		{ "twister",  &dwipe_twister  },
+		{ "isaac",    &dwipe_isaac    },
+		{ "sfmt",     &dwipe_sfmt     },
+		{ "aes-ctr",  &dwipe_aes_ctr  },
+		{ "chacha20", &dwipe_chacha20 },
+		{ "philox",   &dwipe_philox   },
+		{ "xoshiro",  &dwipe_xoshiro  },
+	};
+
+	/* A one byte pattern suits every vector width, and the DoD pattern falls back to the generic fill. */
+	static const char one   [] = { 0x55 };
+	static const char three [] = { 0x92, 0x49, 0x24 };
+
+	static struct option longopts [] =
+	{
+		{ "sizes",   required_argument, 0, 's' },
+		{ "threads", required_argument, 0, 't' },
+		{ "bytes",   required_argument, 0, 'b' },
+		{ "cpu",     required_argument, 0, 'c' },
+		{ "only",    required_argument, 0, 'o' },
+		{ "json",    required_argument, 0, 'j' },
+		{ "help",    no_argument,       0, 'h' },
+		{ 0, 0, 0, 0 }
+	};
+
+	bench_job_t job;
+	int failed = 0;
+	int level;
+	int top;
+	int opt;
+	int i, j, k;
+	long n;
+
+	/* The generators log their errors. */
+	dwipe_options.logfile = "/dev/stderr";
+
+	bench_size_count = bench_list( DWIPE_KNOB_BENCH_SIZES, 1 );
+
+	n = sysconf( _SC_NPROCESSORS_ONLN );
+	bench_threads[0] = 1;
+	bench_thread_count = 1;
+	if( n > 1 ) { bench_threads[bench_thread_count++] = n < 256 ? n : 256; }
+
+	while( ( opt = getopt_long( argc, argv, "s:t:b:c:o:j:h", longopts, NULL ) ) != -1 )
+	{
+		switch( opt )
+		{
+			case 's':
+				bench_size_count = bench_list( optarg, 1 );
+				if( bench_size_count < 0 ) { fprintf( stderr, "Error: Bad size list '%s'.\n", optarg ); return EINVAL; }
+				break;
+
+			case 't':
+				bench_thread_count = bench_list( optarg, 0 );
+				if( bench_thread_count < 0 ) { fprintf( stderr, "Error: Bad thread list '%s'.\n", optarg ); return EINVAL; }
+				break;
+
+			case 'b':
+				bench_bytes = strtoull( optarg, NULL, 10 );
+				if( bench_bytes == 0 ) { fprintf( stderr, "Error: Bad byte count '%s'.\n", optarg ); return EINVAL; }
+				break;
+
+			case 'c':
+				bench_cpu = dwipe_cpu_parse( optarg );
+				if( bench_cpu < 0 ) { fprintf( stderr, "Error: Unknown instruction set '%s'.\n", optarg ); return EINVAL; }
+				break;
+
+			case 'o':
+				bench_only = optarg;
+				break;
+
+			case 'j':
+				bench_json = optarg;
+				break;
+
+			default:
+				bench_usage( argv[0] );
+				return opt == 'h' ? 0 : EINVAL;
+		}
+	}
+
+	dwipe_cpu_dispatch( bench_cpu );
+
+	printf( "cpu: detected %s, using %s, aes-ni %s\n", dwipe_cpu_label( dwipe_cpu_detect() ), \
+	  dwipe_cpu_label( dwipe_cpu_level() ), dwipe_cpu_aes() ? "yes" : "no" );
+
+	/* The generators pick their variant in init, at the --cpu level. */
+	for( i = 0; i < sizeof( prngs ) / sizeof( prngs[0] ); i++ )
+	{
+		if( ! bench_wanted( prngs[i].name ) ) { continue; }
+
+		for( j = 0; j < bench_size_count; j++ )
+		{
+			for( k = 0; k < bench_thread_count; k++ )
+			{
+				memset( &job, 0, sizeof( job ) );
+				job.kind = BENCH_PRNG;
+				job.name = prngs[i].name;
+				job.prng = prngs[i].prng;
+				job.size = bench_sizes[j];
+
+				failed |= bench_run( &job, "prng", dwipe_prng_variant( prngs[i].prng ), bench_threads[k] );
+			}
+		}
+	}
+
+	/* The kernels run at every level up to --cpu so that the variants can be compared. */
+	top = dwipe_cpu_level();
+
+	for( level = DWIPE_CPU_GENERIC; level <= top; level++ )
+	{
+		dwipe_cpu_dispatch( level );
+
+		for( i = 0; i < 4; i++ )
+		{
+			memset( &job, 0, sizeof( job ) );
+
+			switch( i )
+			{
+				case 0: job.kind = BENCH_FILL;  job.name = "fill";   job.pattern = one;   job.length = sizeof( one );   break;
+				case 1: job.kind = BENCH_FILL;  job.name = "fill3";  job.pattern = three; job.length = sizeof( three ); break;
+				case 2: job.kind = BENCH_EQUAL; job.name = "equal";  break;
+				case 3: job.kind = BENCH_ZERO;  job.name = "zero";   break;
+			}
+
+			if( ! bench_wanted( job.name ) ) { continue; }
+
+			for( j = 0; j < bench_size_count; j++ )
+			{
+				for( k = 0; k < bench_thread_count; k++ )
+				{
+					job.size = bench_sizes[j];
+					failed |= bench_run( &job, "kernel", dwipe_cpu_label( dwipe_kernels.level ), bench_threads[k] );
+				}
+			}
+		}
+	}
+
+	dwipe_cpu_dispatch( bench_cpu );
+
+	if( bench_json != NULL && bench_write_json( bench_json ) != 0 ) { failed = 1; }
+
+	free( bench_results );
+	return failed ? 1 : 0;
+
+} /* main */
+
+/* eof */
@@ -0,0 +1,215 @@
+/*
+ *  chacha.c: The ChaCha20 stream cipher as a keystream generator for dwipe.
+ *
+ *  Copyright Paolo Iannelli <info@paoloiannelli.com>.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc., 675 Mass
+ *  Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include <string.h>
+#include "chacha.h"
+#include "cpu.h"
+
+#define CHACHA_ROTL( v, n ) ( ( (v) << (n) ) | ( (v) >> ( 32 - (n) ) ) )
+
+#define CHACHA_QUARTER_ROUND( a, b, c, d ) \
+	a += b; d ^= a; d = CHACHA_ROTL( d, 16 ); \
+	c += d; b ^= c; b = CHACHA_ROTL( b, 12 ); \
+	a += b; d ^= a; d = CHACHA_ROTL( d, 8  ); \
+	c += d; b ^= c; b = CHACHA_ROTL( b, 7  );
+
+/* A column round and a diagonal round; this works on scalars and on vectors of lanes. */
+#define CHACHA_DOUBLE_ROUND( x ) \
+	CHACHA_QUARTER_ROUND( x[0], x[4], x[8],  x[12] ) \
+	CHACHA_QUARTER_ROUND( x[1], x[5], x[9],  x[13] ) \
+	CHACHA_QUARTER_ROUND( x[2], x[6], x[10], x[14] ) \
+	CHACHA_QUARTER_ROUND( x[3], x[7], x[11], x[15] ) \
+	CHACHA_QUARTER_ROUND( x[0], x[5], x[10], x[15] ) \
+	CHACHA_QUARTER_ROUND( x[1], x[6], x[11], x[12] ) \
+	CHACHA_QUARTER_ROUND( x[2], x[7], x[8],  x[13] ) \
+	CHACHA_QUARTER_ROUND( x[3], x[4], x[9],  x[14] )
+
+#define CHACHA_STORE32( p, v ) \
+	( (p)[0] = (uint8_t)(v), (p)[1] = (uint8_t)( (v) >> 8 ), (p)[2] = (uint8_t)( (v) >> 16 ), (p)[3] = (uint8_t)( (v) >> 24 ) )
+
+#define CHACHA_LOAD32( p ) \
+	( (uint32_t)(p)[0] | (uint32_t)(p)[1] << 8 | (uint32_t)(p)[2] << 16 | (uint32_t)(p)[3] << 24 )
+
+
+
+static void chacha_blocks_1( chacha_state_t* chacha, uint8_t* out, size_t blocks )
+{
+	uint32_t x [16];
+	int i;
+
+	for( ; blocks > 0 ; blocks-- )
+	{
+		for( i = 0 ; i < 16 ; i++ )
+		{
+			x[i] = chacha->input[i];
+		}
+
+		for( i = 0 ; i < 10 ; i++ )
+		{
+			CHACHA_DOUBLE_ROUND( x );
+		}
+
+		for( i = 0 ; i < 16 ; i++ )
+		{
+			x[i] += chacha->input[i];
+			CHACHA_STORE32( out + i * 4, x[i] );
+		}
+
+		out += CHACHA_BLOCK_SIZE;
+
+		/* Step the 64-bit block counter. */
+		if( ++chacha->input[12] == 0 ) { chacha->input[13] += 1; }
+	}
+
+} /* chacha_blocks_1 */
+
+
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+
+#define CHACHA_LANES    4
+#define CHACHA_VECTOR   chacha_v4_t
+#define CHACHA_TARGET   "sse2"
+#define CHACHA_FUNCTION chacha_blocks_4
+#include "chacha_lanes.h"
+
+#define CHACHA_LANES    8
+#define CHACHA_VECTOR   chacha_v8_t
+#define CHACHA_TARGET   "avx2"
+#define CHACHA_FUNCTION chacha_blocks_8
+#include "chacha_lanes.h"
+
+#define CHACHA_LANES    16
+#define CHACHA_VECTOR   chacha_v16_t
+#define CHACHA_TARGET   "avx512f"
+#define CHACHA_FUNCTION chacha_blocks_16
+#include "chacha_lanes.h"
+
+#endif
+
+
+
+void chacha_init( chacha_state_t* chacha, const uint8_t* key, const uint8_t* nonce )
+{
+	int i;
+
+	/* "expand 32-byte k" */
+	chacha->input[0] = 0x61707865;
+	chacha->input[1] = 0x3320646e;
+	chacha->input[2] = 0x79622d32;
+	chacha->input[3] = 0x6b206574;
+
+	for( i = 0 ; i < 8 ; i++ )
+	{
+		chacha->input[4 + i] = CHACHA_LOAD32( key + i * 4 );
+	}
+
+	chacha->input[12] = 0;
+	chacha->input[13] = 0;
+	chacha->input[14] = CHACHA_LOAD32( nonce );
+	chacha->input[15] = CHACHA_LOAD32( nonce + 4 );
+
+	chacha->left = 0;
+	chacha->lanes = 1;
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+	/* Use the widest vectors that the dispatch level allows. */
+	switch( dwipe_cpu_level() )
+	{
+		case DWIPE_CPU_AVX512: chacha->lanes = 16; break;
+		case DWIPE_CPU_AVX2:   chacha->lanes = 8;  break;
+		case DWIPE_CPU_SSE2:   chacha->lanes = 4;  break;
+	}
+#endif
+
+} /* chacha_init */
+
+
+
+static void chacha_blocks( chacha_state_t* chacha, uint8_t* out, size_t blocks )
+{
+	switch( chacha->lanes )
+	{
+#if defined( __x86_64__ ) || defined( __i386__ )
+		case 16:
+			chacha_blocks_16( chacha, out, blocks );
+			break;
+
+		case 8:
+			chacha_blocks_8( chacha, out, blocks );
+			break;
+
+		case 4:
+			chacha_blocks_4( chacha, out, blocks );
+			break;
+#endif
+
+		default:
+			chacha_blocks_1( chacha, out, blocks );
+			break;
+	}
+
+} /* chacha_blocks */
+
+void chacha_read( chacha_state_t* chacha, uint8_t* buffer, size_t count )
+{
+	size_t n;
+
+	/* Drain the keystream that is left over from the last call. */
+	n = count < chacha->left ? count : chacha->left;
+	memcpy( buffer, chacha->stream + sizeof( chacha->stream ) - chacha->left, n );
+	chacha->left -= n;
+	buffer += n;
+	count -= n;
+
+	/* Generate whole blocks straight into the buffer. */
+	n = count / CHACHA_BLOCK_SIZE;
+	chacha_blocks( chacha, buffer, n );
+	buffer += n * CHACHA_BLOCK_SIZE;
+	count -= n * CHACHA_BLOCK_SIZE;
+
+	if( count > 0 )
+	{
+		/* Keep the rest of the last block for the next call. */
+		chacha_blocks_1( chacha, chacha->stream, 1 );
+		memcpy( buffer, chacha->stream, count );
+		chacha->left = CHACHA_BLOCK_SIZE - count;
+	}
+
+} /* chacha_read */
+
+void chacha_seek( chacha_state_t* chacha, uint64_t offset )
+{
+	uint64_t block = offset / CHACHA_BLOCK_SIZE;
+
+	chacha->input[12] = (uint32_t)block;
+	chacha->input[13] = (uint32_t)( block >> 32 );
+	chacha->left = 0;
+
+	if( offset % CHACHA_BLOCK_SIZE != 0 )
+	{
+		/* Generate the block that holds the offset, and drop the bytes in front of it. */
+		chacha_blocks_1( chacha, chacha->stream, 1 );
+		chacha->left = CHACHA_BLOCK_SIZE - offset % CHACHA_BLOCK_SIZE;
+	}
+
+} /* chacha_seek */
+
+/* eof */
@@ -0,0 +1,50 @@
+/*
+ *  chacha.h: The ChaCha20 stream cipher as a keystream generator for dwipe.
+ *
+ *  Copyright Paolo Iannelli <info@paoloiannelli.com>.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc., 675 Mass
+ *  Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#ifndef CHACHA_H_
+#define CHACHA_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define CHACHA_BLOCK_SIZE   64
+#define CHACHA_KEY_SIZE     32
+#define CHACHA_NONCE_SIZE   8
+
+typedef struct chacha_state_t_
+{
+	uint32_t input[16];                 /* Constants, key, 64-bit block counter and 64-bit nonce. */
+	uint8_t  stream[CHACHA_BLOCK_SIZE]; /* The keystream block that a short read split.         */
+	size_t   left;                      /* The number of unread bytes at the end of stream.     */
+	int      lanes;                     /* Blocks per iteration: 1, 4 (SSE2), 8 (AVX2) or 16 (AVX-512). */
+} chacha_state_t;
+
+/* Set up ChaCha20 with the original 64-bit counter and 64-bit nonce layout, starting at block zero. */
+void chacha_init( chacha_state_t* chacha, const uint8_t* key, const uint8_t* nonce );
+
+/* Write count bytes of keystream, keeping any unread tail for the next call. */
+void chacha_read( chacha_state_t* chacha, uint8_t* buffer, size_t count );
+
+/* Move to a byte offset of the keystream without generating anything in front of it. */
+void chacha_seek( chacha_state_t* chacha, uint64_t offset );
+
+#endif /* CHACHA_H_ */
+
+/* eof */
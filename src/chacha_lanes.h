@@ -0,0 +1,100 @@
+/*
+ *  chacha_lanes.h: The multi-block ChaCha20 core, instantiated once per vector width.
+ *
+ *  Copyright Paolo Iannelli <info@paoloiannelli.com>.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc., 675 Mass
+ *  Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/*
+ * This file has no include guard, because chacha.c includes it once for each vector width
+ * after defining CHACHA_LANES, CHACHA_VECTOR, CHACHA_TARGET and CHACHA_FUNCTION. Every vector
+ * lane computes a different block, so the rounds need no shuffles, and the lanes are only
+ * transposed into block order when they are stored.
+ *
+ */
+
+typedef uint32_t CHACHA_VECTOR __attribute__(( vector_size( CHACHA_LANES * 4 ) ));
+
+__attribute__(( target( CHACHA_TARGET ) ))
+static void CHACHA_FUNCTION( chacha_state_t* chacha, uint8_t* out, size_t blocks )
+{
+	CHACHA_VECTOR in [16];
+	CHACHA_VECTOR x [16];
+	uint64_t counter;
+	int i;
+	int j;
+
+	for( ; blocks >= CHACHA_LANES ; blocks -= CHACHA_LANES )
+	{
+		counter = (uint64_t)chacha->input[13] << 32 | chacha->input[12];
+
+		for( i = 0 ; i < 16 ; i++ )
+		{
+			in[i] = (CHACHA_VECTOR){ 0 } + chacha->input[i];
+		}
+
+		for( j = 0 ; j < CHACHA_LANES ; j++ )
+		{
+			in[12][j] = (uint32_t)( counter + j );
+			in[13][j] = (uint32_t)( ( counter + j ) >> 32 );
+		}
+
+		for( i = 0 ; i < 16 ; i++ )
+		{
+			x[i] = in[i];
+		}
+
+		for( i = 0 ; i < 10 ; i++ )
+		{
+			CHACHA_DOUBLE_ROUND( x );
+		}
+
+		for( i = 0 ; i < 16 ; i++ )
+		{
+			x[i] += in[i];
+		}
+
+		for( i = 0 ; i < 16 ; i++ )
+		{
+			/* This core only runs on x86, which is little-endian, so a lane is stored as it is. */
+			uint32_t w [CHACHA_LANES];
+
+			memcpy( w, &x[i], sizeof( w ) );
+
+			for( j = 0 ; j < CHACHA_LANES ; j++ )
+			{
+				memcpy( out + j * CHACHA_BLOCK_SIZE + i * 4, &w[j], 4 );
+			}
+		}
+
+		out += CHACHA_LANES * CHACHA_BLOCK_SIZE;
+
+		counter += CHACHA_LANES;
+		chacha->input[12] = (uint32_t)counter;
+		chacha->input[13] = (uint32_t)( counter >> 32 );
+	}
+
+	/* The scalar core finishes a short batch. */
+	chacha_blocks_1( chacha, out, blocks );
+
+} /* CHACHA_FUNCTION */
+
+#undef CHACHA_LANES
+#undef CHACHA_VECTOR
+#undef CHACHA_TARGET
+#undef CHACHA_FUNCTION
+
+/* eof */
@@ -42,6 +42,14 @@ typedef enum dwipe_pass_t_
 	DWIPE_PASS_FINAL_OPS2    /* Special case for dwipe_ops2.     */
 } dwipe_pass_t;
 
+typedef enum dwipe_media_t_
+{
+	DWIPE_MEDIA_UNKNOWN = 0,   /* A regular file, or a device without queue attributes in sysfs. */
+	DWIPE_MEDIA_DISK,          /* Rotational media.                                             */
+	DWIPE_MEDIA_FLASH,         /* Non-rotational media.                                         */
+	DWIPE_MEDIA_ZONED          /* Host-managed or host-aware zoned media.                       */
+} dwipe_media_t;
+
 typedef enum dwipe_select_t_
 {
 	DWIPE_SELECT_NONE = 0,     /* Unused.                                                                  */
@@ -53,6 +61,12 @@ typedef enum dwipe_select_t_
 } dwipe_select_t;
 
 
+/* The i/o backend is defined in backend.h. */
+typedef struct dwipe_backend_t_ dwipe_backend_t;
+
+
+#define DWIPE_KNOB_SEED_LENGTH            32                  /* The master seed and device keys, in bytes. */
+
 #define DWIPE_KNOB_SPEEDRING_SIZE         30
 #define DWIPE_KNOB_SPEEDRING_GRANULARITY  10
 
@@ -67,10 +81,27 @@ typedef struct dwipe_speedring_t_
 	u32    position;
 } dwipe_speedring_t;
 
+#define DWIPE_KNOB_PROFILE_BUCKETS        64                  /* The number of LBA ranges in a throughput profile. */
+
+typedef struct dwipe_profile_t_
+{
+	u64    bytes[DWIPE_KNOB_PROFILE_BUCKETS];  /* The bytes that were timed in each LBA range.   */
+	u64    usecs[DWIPE_KNOB_PROFILE_BUCKETS];  /* The microseconds that they took.               */
+	u64    last;                               /* The clock at the end of the last sample.       */
+} dwipe_profile_t;
+
 
 typedef struct dwipe_context_t_
 {
+	dwipe_backend_t*  backend;       /* The i/o backend implementation.                             */
+	void*             backend_state; /* The private internal state of the i/o backend.              */
 	int               block_size;    /* The soft block size reported the device.                    */
+	int               buffer_count;  /* The number of pass buffers that the memory budget allows.   */
+	size_t            buffer_size;   /* The i/o size of each pass buffer.                           */
+	u64               bytes_skipped; /* The number of bytes that already held the pattern.          */
+	u64               bytes_written; /* The number of bytes that were actually written.             */
+	u64               chunk_length;  /* The length of the device range that a pass call covers.     */
+	loff_t            chunk_start;   /* The device offset where a pass call begins.                 */
 	int               device_bus;    /* The device bus number.                                      */
 	int               device_fd;     /* The file descriptor of the device file being wiped.         */
 	int               device_host;   /* The host number.                                            */
@@ -84,16 +115,32 @@ typedef struct dwipe_context_t_
 	struct stat       device_stat;   /* The device file state from fstat().                         */
 	dwipe_device_t    device_type;   /* Indicates an IDE, SCSI, or Compaq SMART device.             */
 	int               device_target; /* The device target.                                          */
+	u64               discard_max;   /* The largest discard that the device takes, or 0 if none.    */
 	u64               eta;           /* The estimated number of seconds until method completion.    */
-	int               entropy_fd;    /* The entropy source. Usually /dev/urandom.                   */
+	int               health;        /* The DWIPE_HEALTH_* flags that have been raised.             */
+	u64               health_best[2]; /* The best rolling rate of writes and of verify reads.        */
+	int               health_class;  /* 1 for writes, 2 for verify reads, or 0 when not judged.     */
+	u64               health_done;   /* The round progress when it last changed.                    */
+	u64               health_io[2];  /* The bytes that writes and verify reads actually moved.      */
+	time_t            health_moved;  /* The time when the round progress last changed.              */
+	u64               health_rate;   /* The rolling rate of the current class, or 0 in its warmup.  */
+	dwipe_speedring_t health_ring[2]; /* Ring buffers for the rolling rates of health_io.          */
 	char*             label;         /* The string that we will show the user.                      */
+	u64               latency_max;   /* The slowest single request in milliseconds.                 */
+	u64               latency_spikes; /* The number of requests that took seconds.                  */
+	dwipe_media_t     media;         /* The media class that sysfs reports.                         */
+	int               (*method)( struct dwipe_context_t_* c ); /* The wipe method that this device runs. */
+	short             offload_status; /* A flag to indicate a discard or zone reset that moves no bytes. */
 	int               pass_count;    /* The number of passes performed by the working wipe method.  */
 	u64               pass_done;     /* The number of bytes that have already been i/o'd.           */
 	u64               pass_errors;   /* The number of errors across all passes.                     */
 	u64               pass_size;     /* The total number of i/o bytes across all passes.            */
 	dwipe_pass_t      pass_type;     /* The type of the current working pass.                       */
 	int               pass_working;  /* The current working pass.                                   */
+	const char*       plan;          /* The auto policy rule that picked the method, or NULL.       */
+	int               plan_flags;    /* The DWIPE_PLAN_* steps that the rule adds to the method.    */
 	pid_t             pid;           /* The process that has been assigned to do the wipe.          */
+	dwipe_profile_t   profile;       /* The throughput by device offset, for the ETA.               */
 	dwipe_prng_t*     prng;          /* The PRNG implementation.                                    */
 	dwipe_entropy_t   prng_seed;     /* The random data that is used to seed the PRNG.              */
 	void*             prng_state;    /* The private internal state of the PRNG.                     */
@@ -105,13 +152,26 @@ typedef struct dwipe_context_t_
 	double            round_percent; /* The percentage complete across all rounds.                  */
 	int               round_working; /* The current working round.                                  */
 	int               sector_size;   /* The hard sector size reported by the device.                */
+	u8                seed_key[DWIPE_KNOB_SEED_LENGTH]; /* The key that this device's seeds are derived from. */
 	dwipe_select_t    select;        /* Indicates whether this device should be wiped.              */
 	int               signal;        /* Set when the child is killed by a signal.                   */
 	dwipe_speedring_t speedring;     /* Ring buffer for computing the rolling throughput average.   */
 	int               status;        /* The last process status value from waitpid().               */
+	int               stream_id;     /* The shared random stream consumer slot, or -1 if unshared.  */
+	int               stream_pass;   /* The number of shared random passes that have been started.  */
+	u64               stream_offset; /* The byte position of this device in the shared stream.     */
+	short             stream_waiting; /* A flag to indicate when the device waits for the stream.  */
+	void*             substream;     /* The substream generator threads, or NULL until first used.  */
 	short             sync_status;   /* A flag to indicate when the method is syncing.              */
 	u64               throughput;    /* Average throughput in bytes per second.                     */
 	u64               verify_errors; /* The number of verification errors across all passes.        */
+	u64               writeback_window; /* The dirty bytes allowed before writeback is forced.    */
+	loff_t            writeback_start; /* The start of the written range that is not yet flushed. */
+	loff_t            writeback_end; /* The end of the written range that is not yet flushed.       */
+	u64               zeroes_max;    /* The largest write-zeroes offload, or 0 if none.             */
+	int               zoned;         /* Set when the device must be written at zone write pointers. */
+	u32               zone_count;    /* The number of zones on a zoned device.                      */
+	u64               zone_size;     /* The size of each zone in bytes.                             */
 } dwipe_context_t;
 
 #endif /* CONTEXT_H_ */
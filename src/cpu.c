@@ -0,0 +1,455 @@
+/*
+ *  cpu.c: Runtime CPU feature dispatch for the hot kernels.
+ *
+ *  Copyright Paolo Iannelli <info@paoloiannelli.com>.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc., 675 Mass
+ *  Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include <string.h>
+#include <stdint.h>
+#include "cpu.h"
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#define DWIPE_CPU_X86
+#include <immintrin.h>
+#endif
+
+static int  dwipe_generic_is_zero( const char* b, size_t n );
+static int  dwipe_generic_equal( const char* a, const char* b, size_t n );
+static void dwipe_generic_pattern_fill( char* b, size_t n, const char* pattern, size_t length );
+
+dwipe_kernels_t dwipe_kernels =
+{
+	dwipe_generic_is_zero,
+	dwipe_generic_equal,
+	dwipe_generic_pattern_fill,
+	DWIPE_CPU_GENERIC
+};
+
+/* The level that the CPU supports, or -1 before the first probe. */
+static int dwipe_cpu_detected = -1;
+
+/* The highest level that the user allows, from the --cpu option. */
+static int dwipe_cpu_limit = DWIPE_CPU_AVX512;
+
+static const char* dwipe_cpu_labels [] = { "generic", "sse2", "avx2", "avx512" };
+
+
+
+int dwipe_cpu_detect( void )
+{
+/**
+ * Probes the CPU once and returns the widest vector level that it and the OS support.
+ *
+ */
+
+	if( dwipe_cpu_detected >= 0 ) { return dwipe_cpu_detected; }
+
+	dwipe_cpu_detected = DWIPE_CPU_GENERIC;
+
+#ifdef DWIPE_CPU_X86
+	__builtin_cpu_init();
+
+	     if( __builtin_cpu_supports( "avx512f" ) != 0 ) { dwipe_cpu_detected = DWIPE_CPU_AVX512; }
+	else if( __builtin_cpu_supports( "avx2"    ) != 0 ) { dwipe_cpu_detected = DWIPE_CPU_AVX2;   }
+	else if( __builtin_cpu_supports( "sse2"    ) != 0 ) { dwipe_cpu_detected = DWIPE_CPU_SSE2;   }
+#endif
+
+	return dwipe_cpu_detected;
+
+} /* dwipe_cpu_detect */
+
+
+int dwipe_cpu_level( void )
+{
+/**
+ * Returns the widest vector level that the kernels and generators may use.
+ *
+ */
+
+	int level = dwipe_cpu_detect();
+
+	return level < dwipe_cpu_limit ? level : dwipe_cpu_limit;
+
+} /* dwipe_cpu_level */
+
+
+int dwipe_cpu_aes( void )
+{
+/**
+ * Returns non-zero if the AES-NI instructions may be used.
+ *
+ */
+
+#ifdef DWIPE_CPU_X86
+	/* The AES-NI generator works on SSE registers, so a generic limit also disables it. */
+	return dwipe_cpu_level() >= DWIPE_CPU_SSE2 && __builtin_cpu_supports( "aes" ) != 0;
+#else
+	return 0;
+#endif
+
+} /* dwipe_cpu_aes */
+
+
+int dwipe_cpu_parse( const char* name )
+{
+/**
+ * Returns the level for a --cpu argument, or -1 if the name is unknown.
+ *
+ */
+
+	int i;
+
+	for( i = DWIPE_CPU_GENERIC ; i <= DWIPE_CPU_AVX512 ; i++ )
+	{
+		if( strcmp( name, dwipe_cpu_labels[i] ) == 0 ) { return i; }
+	}
+
+	return -1;
+
+} /* dwipe_cpu_parse */
+
+
+const char* dwipe_cpu_label( int level )
+{
+	if( level < DWIPE_CPU_GENERIC || level > DWIPE_CPU_AVX512 ) { return "unknown"; }
+
+	return dwipe_cpu_labels[level];
+
+} /* dwipe_cpu_label */
+
+
+
+static int dwipe_generic_is_zero( const char* b, size_t n )
+{
+	/* A buffer is zero if its first byte is zero and every byte equals the one before it. */
+	if( n == 0 ) { return 1; }
+
+	return b[0] == 0 && memcmp( b, b + 1, n - 1 ) == 0;
+
+} /* dwipe_generic_is_zero */
+
+
+static int dwipe_generic_equal( const char* a, const char* b, size_t n )
+{
+	return memcmp( a, b, n ) == 0;
+
+} /* dwipe_generic_equal */
+
+
+static void dwipe_generic_pattern_fill( char* b, size_t n, const char* pattern, size_t length )
+{
+	/* Copy the pattern once and then keep doubling the filled prefix. */
+	size_t done = length < n ? length : n;
+
+	memcpy( b, pattern, done );
+
+	while( done < n )
+	{
+		size_t r = n - done < done ? n - done : done;
+
+		/* The prefix is a whole number of patterns, so the copy keeps the phase. */
+		memcpy( b + done, b, r );
+		done += r;
+	}
+
+} /* dwipe_generic_pattern_fill */
+
+
+
+#ifdef DWIPE_CPU_X86
+
+/* Build a vector sized tile of the pattern. Returns zero if the pattern does not tile it. */
+static int dwipe_pattern_tile( char* tile, size_t width, const char* pattern, size_t length )
+{
+	if( length == 0 || width % length != 0 ) { return 0; }
+
+	dwipe_generic_pattern_fill( tile, width, pattern, length );
+	return 1;
+
+} /* dwipe_pattern_tile */
+
+
+__attribute__(( target( "sse2" ) ))
+static int dwipe_sse2_is_zero( const char* b, size_t n )
+{
+	size_t i = 0;
+
+	/* OR four vectors together and test them once per cache line. */
+	for( ; i + 64 <= n ; i += 64 )
+	{
+		__m128i v = _mm_or_si128(
+		  _mm_or_si128( _mm_loadu_si128( (const __m128i*)( b + i      ) ), _mm_loadu_si128( (const __m128i*)( b + i + 16 ) ) ),
+		  _mm_or_si128( _mm_loadu_si128( (const __m128i*)( b + i + 32 ) ), _mm_loadu_si128( (const __m128i*)( b + i + 48 ) ) ) );
+
+		if( _mm_movemask_epi8( _mm_cmpeq_epi8( v, _mm_setzero_si128() ) ) != 0xFFFF ) { return 0; }
+	}
+
+	return dwipe_generic_is_zero( b + i, n - i );
+
+} /* dwipe_sse2_is_zero */
+
+
+__attribute__(( target( "sse2" ) ))
+static int dwipe_sse2_equal( const char* a, const char* b, size_t n )
+{
+	size_t i = 0;
+
+	/* XOR the buffers a cache line at a time and test the accumulated difference. */
+	for( ; i + 64 <= n ; i += 64 )
+	{
+		__m128i v = _mm_or_si128(
+		  _mm_or_si128(
+		    _mm_xor_si128( _mm_loadu_si128( (const __m128i*)( a + i      ) ), _mm_loadu_si128( (const __m128i*)( b + i      ) ) ),
+		    _mm_xor_si128( _mm_loadu_si128( (const __m128i*)( a + i + 16 ) ), _mm_loadu_si128( (const __m128i*)( b + i + 16 ) ) ) ),
+		  _mm_or_si128(
+		    _mm_xor_si128( _mm_loadu_si128( (const __m128i*)( a + i + 32 ) ), _mm_loadu_si128( (const __m128i*)( b + i + 32 ) ) ),
+		    _mm_xor_si128( _mm_loadu_si128( (const __m128i*)( a + i + 48 ) ), _mm_loadu_si128( (const __m128i*)( b + i + 48 ) ) ) ) );
+
+		if( _mm_movemask_epi8( _mm_cmpeq_epi8( v, _mm_setzero_si128() ) ) != 0xFFFF ) { return 0; }
+	}
+
+	return memcmp( a + i, b + i, n - i ) == 0;
+
+} /* dwipe_sse2_equal */
+
+
+__attribute__(( target( "sse2" ) ))
+static void dwipe_sse2_pattern_fill( char* b, size_t n, const char* pattern, size_t length )
+{
+	char tile [16];
+	size_t i = 0;
+	__m128i v;
+
+	if( ! dwipe_pattern_tile( tile, sizeof( tile ), pattern, length ) )
+	{
+		dwipe_generic_pattern_fill( b, n, pattern, length );
+		return;
+	}
+
+	v = _mm_loadu_si128( (const __m128i*)tile );
+
+	for( ; i + 64 <= n ; i += 64 )
+	{
+		_mm_storeu_si128( (__m128i*)( b + i      ), v );
+		_mm_storeu_si128( (__m128i*)( b + i + 16 ), v );
+		_mm_storeu_si128( (__m128i*)( b + i + 32 ), v );
+		_mm_storeu_si128( (__m128i*)( b + i + 48 ), v );
+	}
+
+	/* The tile starts on a pattern boundary, so the tail is its prefix. */
+	for( ; i < n ; i++ ) { b[i] = tile[i % sizeof( tile )]; }
+
+} /* dwipe_sse2_pattern_fill */
+
+
+__attribute__(( target( "avx2" ) ))
+static int dwipe_avx2_is_zero( const char* b, size_t n )
+{
+	size_t i = 0;
+
+	/* Test two cache lines per iteration. */
+	for( ; i + 128 <= n ; i += 128 )
+	{
+		__m256i v = _mm256_or_si256(
+		  _mm256_or_si256( _mm256_loadu_si256( (const __m256i*)( b + i      ) ), _mm256_loadu_si256( (const __m256i*)( b + i + 32 ) ) ),
+		  _mm256_or_si256( _mm256_loadu_si256( (const __m256i*)( b + i + 64 ) ), _mm256_loadu_si256( (const __m256i*)( b + i + 96 ) ) ) );
+
+		if( ! _mm256_testz_si256( v, v ) ) { return 0; }
+	}
+
+	return dwipe_generic_is_zero( b + i, n - i );
+
+} /* dwipe_avx2_is_zero */
+
+
+__attribute__(( target( "avx2" ) ))
+static int dwipe_avx2_equal( const char* a, const char* b, size_t n )
+{
+	size_t i = 0;
+
+	for( ; i + 128 <= n ; i += 128 )
+	{
+		__m256i v = _mm256_or_si256(
+		  _mm256_or_si256(
+		    _mm256_xor_si256( _mm256_loadu_si256( (const __m256i*)( a + i      ) ), _mm256_loadu_si256( (const __m256i*)( b + i      ) ) ),
+		    _mm256_xor_si256( _mm256_loadu_si256( (const __m256i*)( a + i + 32 ) ), _mm256_loadu_si256( (const __m256i*)( b + i + 32 ) ) ) ),
+		  _mm256_or_si256(
+		    _mm256_xor_si256( _mm256_loadu_si256( (const __m256i*)( a + i + 64 ) ), _mm256_loadu_si256( (const __m256i*)( b + i + 64 ) ) ),
+		    _mm256_xor_si256( _mm256_loadu_si256( (const __m256i*)( a + i + 96 ) ), _mm256_loadu_si256( (const __m256i*)( b + i + 96 ) ) ) ) );
+
+		if( ! _mm256_testz_si256( v, v ) ) { return 0; }
+	}
+
+	return memcmp( a + i, b + i, n - i ) == 0;
+
+} /* dwipe_avx2_equal */
+
+
+__attribute__(( target( "avx2" ) ))
+static void dwipe_avx2_pattern_fill( char* b, size_t n, const char* pattern, size_t length )
+{
+	char tile [32];
+	size_t i = 0;
+	__m256i v;
+
+	if( ! dwipe_pattern_tile( tile, sizeof( tile ), pattern, length ) )
+	{
+		dwipe_generic_pattern_fill( b, n, pattern, length );
+		return;
+	}
+
+	v = _mm256_loadu_si256( (const __m256i*)tile );
+
+	for( ; i + 128 <= n ; i += 128 )
+	{
+		_mm256_storeu_si256( (__m256i*)( b + i      ), v );
+		_mm256_storeu_si256( (__m256i*)( b + i + 32 ), v );
+		_mm256_storeu_si256( (__m256i*)( b + i + 64 ), v );
+		_mm256_storeu_si256( (__m256i*)( b + i + 96 ), v );
+	}
+
+	for( ; i < n ; i++ ) { b[i] = tile[i % sizeof( tile )]; }
+
+} /* dwipe_avx2_pattern_fill */
+
+
+__attribute__(( target( "avx512f" ) ))
+static int dwipe_avx512_is_zero( const char* b, size_t n )
+{
+	size_t i = 0;
+
+	/* Test four cache lines per iteration. */
+	for( ; i + 256 <= n ; i += 256 )
+	{
+		__m512i v = _mm512_or_si512(
+		  _mm512_or_si512( _mm512_loadu_si512( b + i       ), _mm512_loadu_si512( b + i + 64  ) ),
+		  _mm512_or_si512( _mm512_loadu_si512( b + i + 128 ), _mm512_loadu_si512( b + i + 192 ) ) );
+
+		if( _mm512_test_epi64_mask( v, v ) != 0 ) { return 0; }
+	}
+
+	return dwipe_generic_is_zero( b + i, n - i );
+
+} /* dwipe_avx512_is_zero */
+
+
+__attribute__(( target( "avx512f" ) ))
+static int dwipe_avx512_equal( const char* a, const char* b, size_t n )
+{
+	size_t i = 0;
+
+	for( ; i + 256 <= n ; i += 256 )
+	{
+		__m512i v = _mm512_or_si512(
+		  _mm512_or_si512(
+		    _mm512_xor_si512( _mm512_loadu_si512( a + i       ), _mm512_loadu_si512( b + i       ) ),
+		    _mm512_xor_si512( _mm512_loadu_si512( a + i + 64  ), _mm512_loadu_si512( b + i + 64  ) ) ),
+		  _mm512_or_si512(
+		    _mm512_xor_si512( _mm512_loadu_si512( a + i + 128 ), _mm512_loadu_si512( b + i + 128 ) ),
+		    _mm512_xor_si512( _mm512_loadu_si512( a + i + 192 ), _mm512_loadu_si512( b + i + 192 ) ) ) );
+
+		if( _mm512_test_epi64_mask( v, v ) != 0 ) { return 0; }
+	}
+
+	return memcmp( a + i, b + i, n - i ) == 0;
+
+} /* dwipe_avx512_equal */
+
+
+__attribute__(( target( "avx512f" ) ))
+static void dwipe_avx512_pattern_fill( char* b, size_t n, const char* pattern, size_t length )
+{
+	char tile [64];
+	size_t i = 0;
+	__m512i v;
+
+	if( ! dwipe_pattern_tile( tile, sizeof( tile ), pattern, length ) )
+	{
+		dwipe_generic_pattern_fill( b, n, pattern, length );
+		return;
+	}
+
+	v = _mm512_loadu_si512( tile );
+
+	for( ; i + 256 <= n ; i += 256 )
+	{
+		_mm512_storeu_si512( b + i,       v );
+		_mm512_storeu_si512( b + i + 64,  v );
+		_mm512_storeu_si512( b + i + 128, v );
+		_mm512_storeu_si512( b + i + 192, v );
+	}
+
+	for( ; i < n ; i++ ) { b[i] = tile[i % sizeof( tile )]; }
+
+} /* dwipe_avx512_pattern_fill */
+
+#endif /* DWIPE_CPU_X86 */
+
+
+
+void dwipe_cpu_dispatch( int limit )
+{
+/**
+ * Caps the vector level and points the kernels at the widest variants that the CPU runs.
+ *
+ * @parameter  limit  The highest DWIPE_CPU_* level that may be used.
+ *
+ */
+
+	int level;
+
+	dwipe_cpu_limit = limit;
+	level = dwipe_cpu_level();
+
+	dwipe_kernels.is_zero = dwipe_generic_is_zero;
+	dwipe_kernels.equal = dwipe_generic_equal;
+	dwipe_kernels.pattern_fill = dwipe_generic_pattern_fill;
+
+#ifdef DWIPE_CPU_X86
+	switch( level )
+	{
+		case DWIPE_CPU_AVX512:
+			dwipe_kernels.is_zero = dwipe_avx512_is_zero;
+			dwipe_kernels.equal = dwipe_avx512_equal;
+			dwipe_kernels.pattern_fill = dwipe_avx512_pattern_fill;
+			break;
+
+		case DWIPE_CPU_AVX2:
+			dwipe_kernels.is_zero = dwipe_avx2_is_zero;
+			dwipe_kernels.equal = dwipe_avx2_equal;
+			dwipe_kernels.pattern_fill = dwipe_avx2_pattern_fill;
+			break;
+
+		case DWIPE_CPU_SSE2:
+			dwipe_kernels.is_zero = dwipe_sse2_is_zero;
+			dwipe_kernels.equal = dwipe_sse2_equal;
+			dwipe_kernels.pattern_fill = dwipe_sse2_pattern_fill;
+			break;
+
+		default:
+			level = DWIPE_CPU_GENERIC;
+			break;
+	}
+#else
+	level = DWIPE_CPU_GENERIC;
+#endif
+
+	dwipe_kernels.level = level;
+
+} /* dwipe_cpu_dispatch */
+
+/* eof */
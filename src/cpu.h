@@ -0,0 +1,53 @@
+/*
+ *  cpu.h: Runtime CPU feature dispatch for the hot kernels.
+ *
+ *  Copyright Paolo Iannelli <info@paoloiannelli.com>.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc., 675 Mass
+ *  Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#ifndef CPU_H_
+#define CPU_H_
+
+#include <stddef.h>
+
+/* The vector instruction set levels, in increasing order. */
+#define DWIPE_CPU_GENERIC  0  /* Portable C.                */
+#define DWIPE_CPU_SSE2     1  /* 128-bit integer vectors.   */
+#define DWIPE_CPU_AVX2     2  /* 256-bit integer vectors.   */
+#define DWIPE_CPU_AVX512   3  /* 512-bit AVX-512F vectors.  */
+
+/* The dispatched kernels. Every kernel has a variant at every level, so they share one. */
+typedef struct dwipe_kernels_t_
+{
+	int  (*is_zero)( const char* b, size_t n );                                    /* Non-zero if every byte is zero.   */
+	int  (*equal)( const char* a, const char* b, size_t n );                       /* Non-zero if the buffers match.    */
+	void (*pattern_fill)( char* b, size_t n, const char* pattern, size_t length ); /* Repeat the pattern over n bytes.  */
+	int  level;                                                                    /* The DWIPE_CPU_* of the variants.  */
+} dwipe_kernels_t;
+
+/* The kernels that the pass routines call. They are portable until dwipe_cpu_dispatch() runs. */
+extern dwipe_kernels_t dwipe_kernels;
+
+int         dwipe_cpu_detect( void );
+int         dwipe_cpu_level( void );
+int         dwipe_cpu_aes( void );
+void        dwipe_cpu_dispatch( int limit );
+int         dwipe_cpu_parse( const char* name );
+const char* dwipe_cpu_label( int level );
+
+#endif /* CPU_H_ */
+
+/* eof */
@@ -19,6 +19,7 @@
  */
 
 #include <netinet/in.h>
+#include <sys/sysmacros.h>
 
 #include "dwipe.h"
 #include "context.h"
@@ -26,6 +27,8 @@
 #include "options.h"
 #include "identify.h"
 #include "scsicmds.h"
+#include "device.h"
+#include "logging.h"
 
 void dwipe_device_identify( dwipe_context_t* c )
 {
@@ -46,6 +49,13 @@ void dwipe_device_identify( dwipe_context_t* c )
 	/* Allocate memory for the label. */
 	c->label = malloc( DWIPE_KNOB_LABEL_SIZE );
 
+	if( S_ISREG( c->device_stat.st_mode ) )
+	{
+		/* Regular files have no hardware to identify. */
+		snprintf( c->label, DWIPE_KNOB_LABEL_SIZE, "%s - Regular File", c->device_name );
+		return;
+	}
+
 	if ( ioctl( c->device_fd, HDIO_GET_IDENTITY, &hd ) != 0 )
 	{
 		asprintf( &c->label, "%s - %.40s", c->device_name, hd.model );
@@ -77,6 +87,90 @@ void dwipe_device_identify( dwipe_context_t* c )
 } /* dwipe_device_identify */
 
 
+static int dwipe_device_queue( dwipe_context_t* c, const char* name, u64* value )
+{
+/**
+ * Reads a numeric queue attribute of the device from sysfs.
+ *
+ * @returns  0 on success, -1 if the attribute is missing.
+ *
+ */
+
+	char path [FILENAME_MAX];
+	FILE* fp;
+	int r;
+
+	*value = 0;
+
+	snprintf( path, sizeof( path ), DWIPE_KNOB_QUEUE_SYSFS, major( c->device_stat.st_rdev ), minor( c->device_stat.st_rdev ), name );
+	fp = fopen( path, "r" );
+
+	if( fp == NULL )
+	{
+		/* A partition shares the queue of its disk. */
+		snprintf( path, sizeof( path ), DWIPE_KNOB_QUEUE_PARENT_SYSFS, major( c->device_stat.st_rdev ), minor( c->device_stat.st_rdev ), name );
+		fp = fopen( path, "r" );
+	}
+
+	if( fp == NULL ) { return -1; }
+
+	r = fscanf( fp, "%llu", value ) == 1 ? 0 : -1;
+	fclose( fp );
+
+	return r;
+
+} /* dwipe_device_queue */
+
+
+void dwipe_device_media( dwipe_context_t* c )
+{
+/**
+ * Sorts the device into a media class and reads its discard and write-zeroes limits,
+ * which the auto method policy uses to pick the passes. Call after dwipe_zone_probe().
+ *
+ */
+
+	u64 rotational;
+
+	c->media = DWIPE_MEDIA_UNKNOWN;
+	c->discard_max = 0;
+	c->zeroes_max = 0;
+
+	if( ! S_ISBLK( c->device_stat.st_mode ) ) { return; }
+
+	dwipe_device_queue( c, "discard_max_bytes", &c->discard_max );
+	dwipe_device_queue( c, "write_zeroes_max_bytes", &c->zeroes_max );
+
+	if( c->zoned )
+	{
+		c->media = DWIPE_MEDIA_ZONED;
+	}
+
+	else if( dwipe_device_queue( c, "rotational", &rotational ) == 0 )
+	{
+		c->media = rotational ? DWIPE_MEDIA_DISK : DWIPE_MEDIA_FLASH;
+	}
+
+	dwipe_log( DWIPE_LOG_INFO, "Device '%s' is %s media, with discards of up to %llu bytes and write-zeroes of up to %llu bytes.", \
+	  c->device_name, dwipe_media_label( c->media ), c->discard_max, c->zeroes_max );
+
+} /* dwipe_device_media */
+
+
+const char* dwipe_media_label( dwipe_media_t media )
+{
+	switch( media )
+	{
+		case DWIPE_MEDIA_DISK:  return "rotational";
+		case DWIPE_MEDIA_FLASH: return "flash";
+		case DWIPE_MEDIA_ZONED: return "zoned";
+		default:                return "unknown";
+	}
+
+} /* dwipe_media_label */
+
+
+
 int dwipe_device_scan( char*** device_names )
 {
 	/**
@@ -22,8 +22,14 @@
 #ifndef DEVICE_H_
 #define DEVICE_H_
 
-void dwipe_device_identify( dwipe_context_t* c );  /* Get hardware information about the device.  */
-int  dwipe_device_scan( char*** device_names );    /* Find devices that we can wipe.              */
+/* The queue attributes of a device, and of the whole disk when the device is a partition. */
+#define DWIPE_KNOB_QUEUE_SYSFS         "/sys/dev/block/%i:%i/queue/%s"
+#define DWIPE_KNOB_QUEUE_PARENT_SYSFS  "/sys/dev/block/%i:%i/../queue/%s"
+
+void        dwipe_device_identify( dwipe_context_t* c );  /* Get hardware information about the device.  */
+void        dwipe_device_media( dwipe_context_t* c );     /* Get the media class and offloads.          */
+const char* dwipe_media_label( dwipe_media_t media );     /* Get the name of a media class.             */
+int         dwipe_device_scan( char*** device_names );    /* Find devices that we can wipe.              */
 
 #endif /* DEVICE_H_ */
 
@@ -31,10 +31,24 @@
 #include "gui.h"
 #include "httpd.h"
 #include "notify.h"
+#include "stream.h"
+#include "backend.h"
+#include "zone.h"
+#include "health.h"
+#include "profile.h"
+#include "preflight.h"
+#include "seed.h"
+#include "tile.h"
 
 #ifdef BB_DWIPE
 #include "mt19937ar-cok.c"
 #include "isaac_rand.c"
+#include "sfmt.c"
+#include "cpu.c"
+#include "aes.c"
+#include "chacha.c"
+#include "xoshiro.c"
+#include "philox.c"
 #include "gui.c"
 #include "options.c"
 #include "device.c"
@@ -42,6 +56,16 @@
 #include "method.c"
 #include "logging.c"
 #include "prng.c"
+#include "backend.c"
+#include "metadata.c"
+#include "stream.c"
+#include "zone.c"
+#include "health.c"
+#include "profile.c"
+#include "preflight.c"
+#include "substream.c"
+#include "seed.c"
+#include "tile.c"
 #endif
 
 #include <sys/ioctl.h>  /* FIXME: Twice Included */
@@ -60,6 +84,122 @@ int dwipe_enumerated;
 /* The number of contexts that have been selected.   */
 int dwipe_selected = 0;
 
+void dwipe_memory_budget( dwipe_context_t* c, int count )
+{
+/**
+ * Divides the memory budget across the selected devices, and sets the size and number of
+ * pass buffers and the writeback window of each device.
+ *
+ */
+
+	FILE* fp;
+	char line [FILENAME_MAX];
+	u64 available = 0;
+	u64 budget;
+	u64 share;
+	u64 unit;
+	int i;
+
+	fp = fopen( DWIPE_KNOB_MEMINFO, "r" );
+
+	if( fp != NULL )
+	{
+		while( fgets( line, sizeof( line ), fp ) != NULL )
+		{
+			/* The value is given in kB. */
+			if( sscanf( line, "MemAvailable: %llu", &available ) == 1 ) { break; }
+		}
+
+		fclose( fp );
+	}
+
+	available *= 1024;
+
+	if( dwipe_options.mem_budget > 0 )
+	{
+		budget = dwipe_options.mem_budget;
+
+		if( available > 0 && budget > available )
+		{
+			dwipe_log( DWIPE_LOG_WARNING, "The memory budget %llu MiB exceeds the available %llu MiB.", \
+			  budget / 1048576, available / 1048576 );
+		}
+	}
+
+	else
+	{
+		budget = available / 100 * DWIPE_KNOB_MEM_BUDGET_PERCENT;
+	}
+
+	if( budget == 0 || count < 1 )
+	{
+		/* Without a budget, keep the old fixed buffers and leave writeback to the kernel. */
+		dwipe_log( DWIPE_LOG_WARNING, "Unable to read MemAvailable from '%s'.", DWIPE_KNOB_MEMINFO );
+
+		for( i = 0 ; i < count ; i++ )
+		{
+			c[i].buffer_count     = 2;
+			c[i].buffer_size      = c[i].device_stat.st_blksize * 1024;
+			c[i].writeback_window = 0;
+		}
+
+		return;
+	}
+
+	if( dwipe_options.shared_stream )
+	{
+		/* The shared ring comes off the top. */
+		u64 ring = (u64)DWIPE_KNOB_STREAM_SLOTS * DWIPE_KNOB_STREAM_TILE;
+		budget = budget > ring ? budget - ring : 0;
+	}
+
+	share = budget / count;
+
+	dwipe_log( DWIPE_LOG_NOTICE, "Memory budget is %llu MiB, or %llu MiB for each of %i devices.", \
+	  budget / 1048576, share / 1048576, count );
+
+	for( i = 0 ; i < count ; i++ )
+	{
+		/* Half of the share is for the pass buffers, and half is for dirty page cache. */
+		u64 size;
+
+		/* Every zone writer holds its own buffer. */
+		c[i].buffer_count = c[i].zoned ? DWIPE_KNOB_ZONE_THREADS : 2;
+
+		/* Buffers also hold whole PRNG blocks when the block is a power of two. Other blocks, */
+		/* like the twisters, would leave the device size off a multiple of the buffer, so the */
+		/* bulk fill keeps the rest of a split block in the state for the next buffer instead.  */
+		unit = DWIPE_KNOB_BUFFER_ALIGN;
+
+		if( ( c[i].prng->block & ( c[i].prng->block - 1 ) ) == 0 && c[i].prng->block > unit )
+		{
+			unit = c[i].prng->block;
+		}
+
+		/* A power of two divides the chunk size, so only the end of the device is a short block. */
+		size = share / 2 / c[i].buffer_count;
+
+		if( size < DWIPE_KNOB_BUFFER_MIN ) { size = DWIPE_KNOB_BUFFER_MIN; }
+		if( size > DWIPE_KNOB_BUFFER_MAX ) { size = DWIPE_KNOB_BUFFER_MAX; }
+
+		while( size & ( size - 1 ) ) { size &= size - 1; }
+
+		if( size < unit ) { size = unit; }
+
+		c[i].buffer_size = size;
+
+		/* Up to two windows are dirty at once, so each one gets half of the dirty half. */
+		c[i].writeback_window = share / 4;
+		c[i].writeback_window -= c[i].writeback_window % size;
+
+		if( c[i].writeback_window < size ) { c[i].writeback_window = size; }
+
+		dwipe_log( DWIPE_LOG_INFO, "Device '%s' gets %i buffers of %llu KiB and a %llu MiB writeback window.", \
+		  c[i].device_name, c[i].buffer_count, size / 1024, c[i].writeback_window / 1048576 );
+	}
+
+} /* dwipe_memory_budget */
+
 #ifdef BB_DWIPE
 int dwipe_main( int argc, char** argv )
 #else
@@ -79,9 +219,6 @@ int main( int argc, char** argv )
 	char dwipe_result_file [FILENAME_MAX];
 	FILE* dwipe_result_fp;
 
-	/* The entropy source file handle. */
-	int dwipe_entropy; 
-
 	/* The generic index variables. */
 	int i;
 	int j;
@@ -91,23 +228,16 @@ int main( int argc, char** argv )
 
 	dwipe_log( DWIPE_LOG_NOTICE, "Program loaded." );
 
-	/* Open the entropy source. */
-	dwipe_entropy = open( DWIPE_KNOB_ENTROPY, O_RDONLY );
+	/* Parse command line options. */
+	dwipe_optind = dwipe_options_parse( argc, argv );
 
-	/* Check the result. */
-	if( dwipe_entropy < 0 )
+	/* Draw the one master seed that every device and pass seed is derived from. */
+	if( dwipe_seed_init( dwipe_options.seed_file ) < 0 )
 	{
-		dwipe_perror( errno, __FUNCTION__, "open" );
-		dwipe_log( DWIPE_LOG_FATAL, "Unable to open entropy source %s.", DWIPE_KNOB_ENTROPY );
 		dwipe_notify_fail();
-		return errno;
+		return -1;
 	}
 
-	dwipe_log( DWIPE_LOG_NOTICE, "Opened entropy source '%s'.", DWIPE_KNOB_ENTROPY );
-
-	/* Parse command line options. */
-	dwipe_optind = dwipe_options_parse( argc, argv );
-
 
 	if( dwipe_optind == argc )
 	{
@@ -157,14 +287,11 @@ int main( int argc, char** argv )
 		/* A result buffer for the BLKGETSIZE64 ioctl. */
 		u64 size64;
 
-		/* Set the entropy source. */
-		c1[i].entropy_fd = dwipe_entropy;
-
 		/* Get the file name. */
 		c1[i].device_name = dwipe_names[i];
 
-		/* Open the file for reads and writes. */
-		c1[i].device_fd = open( c1[i].device_name, O_RDWR );
+		/* Open the file for reads and writes, or only for reads when nothing will be written. */
+		c1[i].device_fd = open( c1[i].device_name, dwipe_options.plan ? O_RDONLY : O_RDWR );
 
 		/* Check the open() result. */
 		if( c1[i].device_fd < 0 )
@@ -184,127 +311,158 @@ int main( int argc, char** argv )
 			continue;
 		}
 
-		/* Check that the file is a block device. */
-		if( ! S_ISBLK( c1[i].device_stat.st_mode ) )
+		/* Check that the file is a block device or a regular file. */
+		if( ! S_ISBLK( c1[i].device_stat.st_mode ) && ! S_ISREG( c1[i].device_stat.st_mode ) )
 		{
-			dwipe_log( DWIPE_LOG_ERROR, "'%s' is not a block device.", c1[i].device_name );
+			dwipe_log( DWIPE_LOG_ERROR, "'%s' is not a block device or a regular file.", c1[i].device_name );
 			dwipe_error++;
 			continue;
 		}
 
-		/* Lock the file for exclusive access. */
-		/* TODO: Determine why the LOCK_NB flag is not being honored. */
-/* 
-		if( flock( c1[i].device_fd, LOCK_EX | LOCK_NB ) != 0 )
+		if( S_ISBLK( c1[i].device_stat.st_mode ) && ! ( dwipe_options.backend->caps & DWIPE_BACKEND_CAP_DURABLE ) && ! dwipe_options.benchmark )
 		{
-			dwipe_perror( errno, __FUNCTION__, "flock" );
-			dwipe_log( DWIPE_LOG_ERROR, "Unable to lock the '%s' file.", c1[i].device_name );
+			/* A sink would leave the data on a real device and still finish the wipe. */
+			fprintf( stderr, "Error: The %s backend does not write to '%s'. Add --benchmark to run it anyway.\n", dwipe_options.backend->label, c1[i].device_name );
+			dwipe_log( DWIPE_LOG_ERROR, "The %s backend does not write to '%s'.", dwipe_options.backend->label, c1[i].device_name );
 			dwipe_error++;
 			continue;
 		}
-*/
 
-		/* Do sector size and block size checking. */
+		if( S_ISREG( c1[i].device_stat.st_mode ) )
+		{
+			/* Regular files, like virtual machine disk images, have no driver to ask. */
+			c1[i].sector_size = 0;
+			c1[i].block_size  = 0;
+			c1[i].device_size = c1[i].device_stat.st_size;
 
-		if( ioctl( c1[i].device_fd, BLKSSZGET, &c1[i].sector_size ) == 0 )
+			if( c1[i].device_size == 0 )
+			{
+				dwipe_log( DWIPE_LOG_ERROR, "File '%s' is size %llu.", c1[i].device_name, c1[i].device_size );
+				dwipe_error++;
+				continue;
+			}
+
+			dwipe_log( DWIPE_LOG_INFO, "File '%s' is size %llu and uses %llu bytes.", c1[i].device_name, \
+			  c1[i].device_size, (u64)c1[i].device_stat.st_blocks * 512 );
+		}
+
+		else
 		{
-			dwipe_log( DWIPE_LOG_INFO, "Device '%s' has sector size %i.", c1[i].device_name,  c1[i].sector_size );
+			/* Lock the file for exclusive access. */
+			/* TODO: Determine why the LOCK_NB flag is not being honored. */
+/* 
+			if( flock( c1[i].device_fd, LOCK_EX | LOCK_NB ) != 0 )
+			{
+				dwipe_perror( errno, __FUNCTION__, "flock" );
+				dwipe_log( DWIPE_LOG_ERROR, "Unable to lock the '%s' file.", c1[i].device_name );
+				dwipe_error++;
+				continue;
+			}
+*/
 
-			if( ioctl( c1[i].device_fd, BLKBSZGET, &c1[i].block_size ) == 0 )
+			/* Do sector size and block size checking. */
+
+			if( ioctl( c1[i].device_fd, BLKSSZGET, &c1[i].sector_size ) == 0 )
 			{
-				if( c1[i].block_size != c1[i].sector_size )
-				{
-					dwipe_log( DWIPE_LOG_WARNING, "Changing '%s' block size from %i to %i.", c1[i].device_name, c1[i].block_size, c1[i].sector_size );
-					if( ioctl( c1[i].device_fd, BLKBSZSET, &c1[i].sector_size ) == 0 )
-					{
-						c1[i].block_size = c1[i].sector_size;
-					}
+				dwipe_log( DWIPE_LOG_INFO, "Device '%s' has sector size %i.", c1[i].device_name,  c1[i].sector_size );
 
-					else
+				if( ioctl( c1[i].device_fd, BLKBSZGET, &c1[i].block_size ) == 0 )
+				{
+					if( c1[i].block_size != c1[i].sector_size )
 					{
-						dwipe_log( DWIPE_LOG_WARNING, "Device '%s' failed BLKBSZSET ioctl.", c1[i].device_name );
+						dwipe_log( DWIPE_LOG_WARNING, "Changing '%s' block size from %i to %i.", c1[i].device_name, c1[i].block_size, c1[i].sector_size );
+						if( ioctl( c1[i].device_fd, BLKBSZSET, &c1[i].sector_size ) == 0 )
+						{
+							c1[i].block_size = c1[i].sector_size;
+						}
+
+						else
+						{
+							dwipe_log( DWIPE_LOG_WARNING, "Device '%s' failed BLKBSZSET ioctl.", c1[i].device_name );
+						}
 					}
 				}
+				else
+				{
+					dwipe_log( DWIPE_LOG_WARNING, "Device '%s' failed BLKBSZGET ioctl.", c1[i].device_name );
+					c1[i].block_size  = 0;
+				}
 			}
+
 			else
 			{
-				dwipe_log( DWIPE_LOG_WARNING, "Device '%s' failed BLKBSZGET ioctl.", c1[i].device_name );
+				dwipe_log( DWIPE_LOG_WARNING, "Device '%s' failed BLKSSZGET ioctl.", c1[i].device_name );
+				c1[i].sector_size = 0;
 				c1[i].block_size  = 0;
 			}
-		}
 
-		else
-		{
-			dwipe_log( DWIPE_LOG_WARNING, "Device '%s' failed BLKSSZGET ioctl.", c1[i].device_name );
-			c1[i].sector_size = 0;
-			c1[i].block_size  = 0;
-		}
 
+			/* The st_size field is zero for block devices. */
+			/* ioctl( c1[i].device_fd, BLKGETSIZE64, &c1[i].device_size ); */
 
-		/* The st_size field is zero for block devices. */
-		/* ioctl( c1[i].device_fd, BLKGETSIZE64, &c1[i].device_size ); */
+			/* Seek to the end of the device to determine its size. */
+			c1[i].device_size = lseek( c1[i].device_fd, 0, SEEK_END );
 
-		/* Seek to the end of the device to determine its size. */
-		c1[i].device_size = lseek( c1[i].device_fd, 0, SEEK_END );
+			/* Also ask the driver for the device size. */
+			/* if( ioctl( c1[i].device_fd, BLKGETSIZE64, &size64 ) ) */
+			if( ioctl( c1[i].device_fd, _IOR(0x12,114,size_t), &size64 ) )
+			{
+				/* The ioctl failed. */
+				fprintf( stderr, "Error: BLKGETSIZE64 failed  on '%s'.\n", c1[i].device_name );
+				dwipe_log( DWIPE_LOG_ERROR, "BLKGETSIZE64 failed  on '%s'.\n", c1[i].device_name );
+				dwipe_error++;
+			}
 
-		/* Also ask the driver for the device size. */
-		/* if( ioctl( c1[i].device_fd, BLKGETSIZE64, &size64 ) ) */
-		if( ioctl( c1[i].device_fd, _IOR(0x12,114,size_t), &size64 ) )
-		{
-			/* The ioctl failed. */
-			fprintf( stderr, "Error: BLKGETSIZE64 failed  on '%s'.\n", c1[i].device_name );
-			dwipe_log( DWIPE_LOG_ERROR, "BLKGETSIZE64 failed  on '%s'.\n", c1[i].device_name );
-			dwipe_error++;
-		}
+			/* Check whether the two size values agree. */
+			if( c1[i].device_size != size64 )
+			{
+				/* This could be caused by the linux last-odd-block problem. */
+				fprintf( stderr, "Error: Last-odd-block detected on '%s'.\n", c1[i].device_name );
+				dwipe_log( DWIPE_LOG_ERROR, "Last-odd-block detected on '%s'.", c1[i].device_name  );
+				dwipe_error++;
+			}
 
-		/* Check whether the two size values agree. */
-		if( c1[i].device_size != size64 )
-		{
-			/* This could be caused by the linux last-odd-block problem. */
-			fprintf( stderr, "Error: Last-odd-block detected on '%s'.\n", c1[i].device_name );
-			dwipe_log( DWIPE_LOG_ERROR, "Last-odd-block detected on '%s'.", c1[i].device_name  );
-			dwipe_error++;
-		}
+			if( c1[i].device_size == (loff_t)-1 )
+			{
+				/* We cannot determine the size of this device. */
+				dwipe_perror( errno, __FUNCTION__, "lseek" );
+				dwipe_log( DWIPE_LOG_ERROR, "Unable to determine the size of '%s'.", c1[i].device_name );
+				dwipe_error++;
+			}
 
-		if( c1[i].device_size == (loff_t)-1 )
-		{
-			/* We cannot determine the size of this device. */
-			dwipe_perror( errno, __FUNCTION__, "lseek" );
-			dwipe_log( DWIPE_LOG_ERROR, "Unable to determine the size of '%s'.", c1[i].device_name );
-			dwipe_error++;
-		}
+			else
+			{
+				/* Reset the file pointer. */
+				r = lseek( c1[i].device_fd, 0, SEEK_SET );
 
-		else
-		{
-			/* Reset the file pointer. */
-			r = lseek( c1[i].device_fd, 0, SEEK_SET );
+				if( r == (loff_t)-1 )
+				{
+					dwipe_perror( errno, __FUNCTION__, "lseek" );
+					dwipe_log( DWIPE_LOG_ERROR, "Unable to reset the '%s' file offset.", c1[i].device_name );
+					dwipe_error++;
+				}
+			}
 
-			if( r == (loff_t)-1 )
+			if( c1[i].device_size == 0 )
 			{
-				dwipe_perror( errno, __FUNCTION__, "lseek" );
-				dwipe_log( DWIPE_LOG_ERROR, "Unable to reset the '%s' file offset.", c1[i].device_name );
+				dwipe_log( DWIPE_LOG_ERROR, "Device '%s' is size %llu.", c1[i].device_name, c1[i].device_size );
 				dwipe_error++;
+				continue;
 			}
-		}
 
-		if( c1[i].device_size == 0 )
-		{
-			dwipe_log( DWIPE_LOG_ERROR, "Device '%s' is size %llu.", c1[i].device_name, c1[i].device_size );
-			dwipe_error++;
-			continue;
-		}
+			else
+			{
+				dwipe_log( DWIPE_LOG_INFO, "Device '%s' is size %llu.", c1[i].device_name,  c1[i].device_size );
+			}
 
-		else
-		{
-			dwipe_log( DWIPE_LOG_INFO, "Device '%s' is size %llu.", c1[i].device_name,  c1[i].device_size );
-		}
+		} /* block device */
 
 		/* Try to get detailed information about this device. */
 		dwipe_device_identify( &c1[i] );
 
-		if( dwipe_options.autonuke )
+		if( dwipe_options.autonuke || dwipe_options.plan )
 		{
-			/* When the autonuke option is set, select all disks. */
+			/* When the autonuke or plan option is set, select all disks. */
 			if( c1[i].device_part == 0 ) { c1[i].select = DWIPE_SELECT_TRUE;        }
 			else                         { c1[i].select = DWIPE_SELECT_TRUE_PARENT; }
 		}
@@ -320,6 +478,24 @@ int main( int argc, char** argv )
 		c1[i].prng_seed.length = 0;
 		c1[i].prng_seed.s      = 0;
 		c1[i].prng_state       = 0;
+		c1[i].substream        = NULL;
+
+		/* Set the i/o backend. */
+		c1[i].backend       = dwipe_options.backend;
+		c1[i].backend_state = NULL;
+
+		/* Zoned devices are written with direct i/o at the write pointers, but a */
+		/* sink that keeps nothing stays in place and leaves the zones alone.    */
+		if( dwipe_zone_probe( &c1[i] ) && ( c1[i].backend->caps & DWIPE_BACKEND_CAP_DURABLE ) )
+		{
+			c1[i].backend = &dwipe_backend_zone;
+		}
+
+		/* The auto method picks the passes from the media class and the offloads. */
+		dwipe_device_media( &c1[i] );
+
+		/* The shared random stream is assigned after the devices are selected. */
+		c1[i].stream_id = -1;
 
 	} /* file arguments */
 
@@ -330,6 +506,12 @@ int main( int argc, char** argv )
 		return -1;
 	}
 
+	if( dwipe_options.plan )
+	{
+		/* Print the estimates and leave the devices untouched. */
+		return dwipe_preflight( c1, dwipe_enumerated );
+	}
+
 	/* Start the web server */
 	if ( dwipe_options.web_enabled == 1 )
 	{
@@ -394,7 +576,16 @@ int main( int argc, char** argv )
 		if( c1[i].select == DWIPE_SELECT_TRUE )
 		{
 			/* Copy the context. */
-			c2[j++] = c1[i];
+			c2[j] = c1[i];
+
+			/* The PRNG may have been changed in the GUI after the devices were enumerated. */
+			c2[j].prng = dwipe_options.prng;
+
+			/* So may the method, and the auto method picks one for each device. */
+			dwipe_method_select( &c2[j] );
+
+			/* The children derive every seed from this key instead of reading the entropy source. */
+			dwipe_seed_device( &c2[j++] );
 		}
 
 		else
@@ -412,6 +603,57 @@ int main( int argc, char** argv )
 	/* We're done with the array of enumerated contexts. */
 	//free( c1 );
 
+	/* Size the buffers before the children inherit the contexts. */
+	dwipe_memory_budget( c2, dwipe_selected );
+
+	/* Build the static patterns once for all children, now that the buffer sizes are known. */
+	dwipe_tile_create( c2, dwipe_selected );
+
+	if( dwipe_options.shared_stream )
+	{
+		for( i = 1 ; i < dwipe_selected ; i++ )
+		{
+			if( c2[i].method != c2[0].method )
+			{
+				/* Every consumer must reach its random passes at the same time, or the ring stalls. */
+				dwipe_log( DWIPE_LOG_FATAL, "The shared random stream needs the same method on every device, but '%s' runs %s and '%s' runs %s.", \
+				  c2[0].device_name, dwipe_method_label( c2[0].method ), c2[i].device_name, dwipe_method_label( c2[i].method ) );
+				dwipe_gui_free();
+				dwipe_notify_fail();
+				return -1;
+			}
+		}
+
+		/* Create the ring before the children so that they all inherit it. */
+		if( dwipe_stream_create( c2, dwipe_selected ) < 0 )
+		{
+			dwipe_gui_free();
+			dwipe_notify_fail();
+			return -1;
+		}
+
+		/* Fork the generator process. */
+		dwipe_pid = fork();
+
+		if( dwipe_pid < 0 )
+		{
+			/* Without the generator every consumer would wait for the ring forever. */
+			dwipe_perror( errno, __FUNCTION__, "fork" );
+			dwipe_log( DWIPE_LOG_FATAL, "Unable to start the shared random stream generator." );
+			dwipe_gui_free();
+			dwipe_notify_fail();
+			return -1;
+		}
+
+		if( dwipe_pid == 0 )
+		{
+			/* The generator fills the ring and exits. */
+			return dwipe_stream_generate();
+		}
+
+		dwipe_stream_set_pid( dwipe_pid );
+	}
+
 
 	for( i = 0 ; i < dwipe_selected ; i++ )
 	{
@@ -429,7 +671,7 @@ int main( int argc, char** argv )
 			else
 			{
 				/* The child invokes the wipe method and exits. */
-				return dwipe_options.method( &c2[i] );
+				return c2[i].method( &c2[i] );
 			}
 		}
 
@@ -491,17 +733,29 @@ int main( int argc, char** argv )
 					/* Increment the number of children that have returned. */
 					dwipe_wait += 1;
 
+					/* Release the tiles that the child was holding. */
+					dwipe_stream_release( i );
+
 				} /* child reaped */
 
 			} /* child active */
 				  
 		} /* child waitpid */
 
+		/* Check that the random stream generator is still running. */
+		dwipe_stream_poll();
+
 		/* Show the user what is happening. */
 		dwipe_gui_status( dwipe_selected, c2 );
 
+		/* Flag slow and stalled devices with the updated throughput. */
+		dwipe_health_check( dwipe_selected, c2 );
+
 	} /* while */
 
+	/* Stop the random stream generator. */
+	dwipe_stream_finish();
+
 	/* TODO: Fanfare. */
 	dwipe_pid = getch();
 
@@ -515,29 +769,55 @@ int main( int argc, char** argv )
 		snprintf( dwipe_result_file, sizeof(dwipe_result_file), "%s.result", c2[i].device_name );
 		dwipe_result_fp = fopen( dwipe_result_file, "w" );
 		fprintf( dwipe_result_fp, "DWIPE_LABEL='%s'\n", c2[i].label );
-		fprintf( dwipe_result_fp, "DWIPE_METHOD='%s'\n", dwipe_method_label( dwipe_options.method) );
+		fprintf( dwipe_result_fp, "DWIPE_METHOD='%s'\n", dwipe_method_label( c2[i].method ) );
+
+		if( c2[i].plan != NULL )
+		{
+			/* The auto policy rule and what it was based on. */
+			fprintf( dwipe_result_fp, "DWIPE_PLAN='%s'\n", c2[i].plan );
+			fprintf( dwipe_result_fp, "DWIPE_MEDIA='%s'\n", dwipe_media_label( c2[i].media ) );
+			fprintf( dwipe_result_fp, "DWIPE_DISCARD_FIRST='%s'\n", c2[i].plan_flags & DWIPE_PLAN_DISCARD ? "yes" : "no" );
+			fprintf( dwipe_result_fp, "DWIPE_ZEROOUT_BLANK='%s'\n", c2[i].plan_flags & DWIPE_PLAN_ZEROOUT ? "yes" : "no" );
+		}
 		fprintf( dwipe_result_fp, "DWIPE_ROUNDS='%i'\n", dwipe_options.rounds );
+		fprintf( dwipe_result_fp, "DWIPE_IO='%s'\n", c2[i].backend->label );
 
-		if( dwipe_options.verify == DWIPE_VERIFY_NONE )
+		if( dwipe_options.verify != DWIPE_VERIFY_NONE && ! ( c2[i].backend->caps & DWIPE_BACKEND_CAP_READ ) )
+		{
+			/* The passes logged that nothing could be read back. */
+			fprintf( dwipe_result_fp, "DWIPE_VERIFY='skipped'\n" );
+		}
+		else if( dwipe_options.verify == DWIPE_VERIFY_NONE )
 		{
 			fprintf( dwipe_result_fp, "DWIPE_VERIFY='off'\n" );
 		}
-		if( dwipe_options.verify == DWIPE_VERIFY_ALL  )
+		else if( dwipe_options.verify == DWIPE_VERIFY_ALL  )
 		{
 			fprintf( dwipe_result_fp, "DWIPE_VERIFY='all'\n" );
 		}
-		if( dwipe_options.verify == DWIPE_VERIFY_LAST )
+		else if( dwipe_options.verify == DWIPE_VERIFY_LAST )
 		{
 			fprintf( dwipe_result_fp, "DWIPE_VERIFY='last'\n" );
 		}
 
+		fprintf( dwipe_result_fp, "DWIPE_BYTES_WRITTEN='%llu'\n", c2[i].bytes_written );
+		fprintf( dwipe_result_fp, "DWIPE_BYTES_SKIPPED='%llu'\n", c2[i].bytes_skipped );
+		fprintf( dwipe_result_fp, "DWIPE_HEALTH='%s'\n", dwipe_health_label( c2[i].health ) );
+
 		if( c2[i].result < 0 )
 		{
 			dwipe_log( DWIPE_LOG_NOTICE, "Wipe of device '%s' failed.", c2[i].device_name );
 			fprintf( dwipe_result_fp, "DWIPE_RESULT='fail'\n" );
 		}
 
-		if( c2[i].result == 0 )
+		if( c2[i].result == 0 && ! ( c2[i].backend->caps & DWIPE_BACKEND_CAP_DURABLE ) )
+		{
+			/* Nothing reached the media, so this is never a certificate. */
+			dwipe_log( DWIPE_LOG_NOTICE, "Benchmark of device '%s' finished, but it was not wiped.", c2[i].device_name );
+			fprintf( dwipe_result_fp, "DWIPE_RESULT='benchmark'\n" );
+		}
+
+		else if( c2[i].result == 0 )
 		{
 			dwipe_log( DWIPE_LOG_NOTICE, "Wipe of device '%s' succeeded.", c2[i].device_name );
 			fprintf( dwipe_result_fp, "DWIPE_RESULT='pass'\n" );
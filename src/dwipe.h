@@ -78,6 +78,8 @@ typedef unsigned char      u8;
 #define BLKBSZGET    _IOR(0x12,112,size_t)
 #define BLKBSZSET    _IOW(0x12,113,size_t)
 #define BLKGETSIZE64 _IOR(0x12,114,sizeof(u64))
+#define BLKDISCARD   _IO(0x12,119)
+#define BLKZEROOUT   _IO(0x12,127)
 
 /* This is required for ioctl FDFLUSH. */
 #include <linux/fd.h>
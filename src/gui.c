@@ -35,6 +35,9 @@
 #include "options.h"
 #include "gui.h"
 #include "pass.h"
+#include "health.h"
+#include "profile.h"
+#include "seed.h"
 
 
 #define DWIPE_GUI_PANE        8
@@ -756,7 +759,7 @@ void dwipe_gui_options( void )
 	werase( options_window );
 
 	mvwprintw( options_window, DWIPE_GUI_OPTIONS_ENTROPY_Y, DWIPE_GUI_OPTIONS_ENTROPY_X, \
-	  "Entropy: Linux Kernel (urandom)" );
+	  "Entropy: %s", dwipe_seed_source );
 
 	mvwprintw( options_window, DWIPE_GUI_OPTIONS_PRNG_Y,    DWIPE_GUI_OPTIONS_PRNG_X, \
 	  "PRNG:    %s", dwipe_options.prng->label );
@@ -936,9 +939,14 @@ void dwipe_gui_prng( void )
 
 	extern dwipe_prng_t dwipe_twister;
 	extern dwipe_prng_t dwipe_isaac;
+	extern dwipe_prng_t dwipe_sfmt;
+	extern dwipe_prng_t dwipe_aes_ctr;
+	extern dwipe_prng_t dwipe_chacha20;
+	extern dwipe_prng_t dwipe_xoshiro;
+	extern dwipe_prng_t dwipe_philox;
 
 	/* The number of implemented PRNGs. */
-	const int count = 2;
+	const int count = 7;
 
 	/* The first tabstop. */
 	const int tab1 = 2;
@@ -962,6 +970,11 @@ void dwipe_gui_prng( void )
 
 	if( dwipe_options.prng == &dwipe_twister ) { focus = 0; }
 	if( dwipe_options.prng == &dwipe_isaac   ) { focus = 1; }
+	if( dwipe_options.prng == &dwipe_sfmt    ) { focus = 2; }
+	if( dwipe_options.prng == &dwipe_aes_ctr ) { focus = 3; }
+	if( dwipe_options.prng == &dwipe_chacha20 ) { focus = 4; }
+	if( dwipe_options.prng == &dwipe_xoshiro ) { focus = 5; }
+	if( dwipe_options.prng == &dwipe_philox  ) { focus = 6; }
 
 
 	while( 1 )
@@ -977,6 +990,11 @@ void dwipe_gui_prng( void )
 		mvwprintw( main_window, yy++, tab1, ""                  );
 		mvwprintw( main_window, yy++, tab1, "  %s", dwipe_twister.label );
 		mvwprintw( main_window, yy++, tab1, "  %s", dwipe_isaac.label   );
+		mvwprintw( main_window, yy++, tab1, "  %s", dwipe_sfmt.label    );
+		mvwprintw( main_window, yy++, tab1, "  %s", dwipe_aes_ctr.label );
+		mvwprintw( main_window, yy++, tab1, "  %s", dwipe_chacha20.label );
+		mvwprintw( main_window, yy++, tab1, "  %s", dwipe_xoshiro.label );
+		mvwprintw( main_window, yy++, tab1, "  %s", dwipe_philox.label  );
 		mvwprintw( main_window, yy++, tab1, ""                  );
 
 		/* Print the cursor. */
@@ -1009,6 +1027,61 @@ void dwipe_gui_prng( void )
 				mvwprintw( main_window, yy++, tab1, "                                                                            " );
 				break;
 
+			case 2:
+
+				mvwprintw( main_window, 2, tab2, "syslinux.cfg:  nuke=\"dwipe --prng sfmt\"" );
+
+				/*                                 0         1         2         3         4         5         6         7        8  */
+				mvwprintw( main_window, yy++, tab1, "SFMT, by Mutsuo Saito and Makoto Matsumoto, is a Mersenne Twister variant   " );
+				mvwprintw( main_window, yy++, tab1, "that generates 128 bits per step with SIMD instructions.  It has the same    " );
+				mvwprintw( main_window, yy++, tab1, "period of 2^19937-1 and runs several times faster than the Twister.         " );
+				mvwprintw( main_window, yy++, tab1, "                                                                            " );
+				break;
+
+			case 3:
+
+				mvwprintw( main_window, 2, tab2, "syslinux.cfg:  nuke=\"dwipe --prng aes\"" );
+
+				/*                                 0         1         2         3         4         5         6         7        8  */
+				mvwprintw( main_window, yy++, tab1, "AES-256 in counter mode is a cryptographically strong stream.  It runs at   " );
+				mvwprintw( main_window, yy++, tab1, "gigabytes per second on CPUs with AES-NI, where it is the default, and      " );
+				mvwprintw( main_window, yy++, tab1, "falls back to a slow constant-time software cipher elsewhere.               " );
+				mvwprintw( main_window, yy++, tab1, "                                                                            " );
+				break;
+
+			case 4:
+
+				mvwprintw( main_window, 2, tab2, "syslinux.cfg:  nuke=\"dwipe --prng chacha20\"" );
+
+				/*                                 0         1         2         3         4         5         6         7        8  */
+				mvwprintw( main_window, yy++, tab1, "ChaCha20, by Daniel J. Bernstein, is a modern stream cipher that needs no   " );
+				mvwprintw( main_window, yy++, tab1, "special instructions.  It generates 4, 8 or 16 blocks at a time with SSE2,  " );
+				mvwprintw( main_window, yy++, tab1, "AVX2 or AVX-512, and is the strong choice on CPUs without AES-NI.           " );
+				mvwprintw( main_window, yy++, tab1, "                                                                            " );
+				break;
+
+			case 5:
+
+				mvwprintw( main_window, 2, tab2, "syslinux.cfg:  nuke=\"dwipe --prng xoshiro\"" );
+
+				/*                                 0         1         2         3         4         5         6         7        8  */
+				mvwprintw( main_window, yy++, tab1, "xoshiro256++, by David Blackman and Sebastiano Vigna, runs eight lanes      " );
+				mvwprintw( main_window, yy++, tab1, "side by side and costs the least CPU of all the generators.  It is not      " );
+				mvwprintw( main_window, yy++, tab1, "cryptographically strong, so use it where only the cost matters.            " );
+				mvwprintw( main_window, yy++, tab1, "                                                                            " );
+				break;
+
+			case 6:
+
+				mvwprintw( main_window, 2, tab2, "syslinux.cfg:  nuke=\"dwipe --prng philox\"" );
+
+				/*                                 0         1         2         3         4         5         6         7        8  */
+				mvwprintw( main_window, yy++, tab1, "Philox4x32-10, by Salmon, Moraes, Dror and Shaw, makes every block from its " );
+				mvwprintw( main_window, yy++, tab1, "own counter, so any part of the device can be written or verified without   " );
+				mvwprintw( main_window, yy++, tab1, "the data in front of it.  It runs eight counters at a time with AVX2.       " );
+				mvwprintw( main_window, yy++, tab1, "                                                                            " );
+				break;
+
 		} /* switch */
 
 		/* Add a border. */
@@ -1045,6 +1118,11 @@ void dwipe_gui_prng( void )
 
 				if( focus == 0 ) { dwipe_options.prng = &dwipe_twister; }
 				if( focus == 1 ) { dwipe_options.prng = &dwipe_isaac;   }
+				if( focus == 2 ) { dwipe_options.prng = &dwipe_sfmt;    }
+				if( focus == 3 ) { dwipe_options.prng = &dwipe_aes_ctr; }
+				if( focus == 4 ) { dwipe_options.prng = &dwipe_chacha20; }
+				if( focus == 5 ) { dwipe_options.prng = &dwipe_xoshiro; }
+				if( focus == 6 ) { dwipe_options.prng = &dwipe_philox;  }
 				return;
 
 			case KEY_BACKSPACE:
@@ -1204,7 +1282,7 @@ void dwipe_gui_method( void )
  */
 
 	/* The number of implemented methods. */
-	const int count = 6;
+	const int count = 7;
 
 	/* The first tabstop. */
 	const int tab1 = 2;
@@ -1232,6 +1310,7 @@ void dwipe_gui_method( void )
 	if( dwipe_options.method == &dwipe_dod522022m ) { focus = 3; }
 	if( dwipe_options.method == &dwipe_gutmann    ) { focus = 4; }
 	if( dwipe_options.method == &dwipe_random     ) { focus = 5; }
+	if( dwipe_options.method == &dwipe_auto       ) { focus = 6; }
 
 
 	do
@@ -1249,6 +1328,7 @@ void dwipe_gui_method( void )
 		mvwprintw( main_window, yy++, tab1, "  %s", dwipe_method_label( &dwipe_dod522022m ) );
 		mvwprintw( main_window, yy++, tab1, "  %s", dwipe_method_label( &dwipe_gutmann    ) );
 		mvwprintw( main_window, yy++, tab1, "  %s", dwipe_method_label( &dwipe_random     ) );
+		mvwprintw( main_window, yy++, tab1, "  %s", dwipe_method_label( &dwipe_auto       ) );
 		mvwprintw( main_window, yy++, tab1, "                                             " );
 
 		/* Print the cursor. */
@@ -1326,6 +1406,18 @@ void dwipe_gui_method( void )
 				mvwprintw( main_window, yy++, tab1, "level with 8 rounds.                                                         " );
 				break;
 
+			case 6:
+
+				mvwprintw( main_window, 2, tab2, "syslinux.cfg: nuke=\"dwipe --method auto\"" );
+				mvwprintw( main_window, 3, tab2, "Security Level: Depends on Media" );
+
+				/*                                 0         1         2         3         4         5         6         7         8  */
+				mvwprintw( main_window, yy++, tab1, "This method picks the passes for each device from its media type. Flash and  " );
+				mvwprintw( main_window, yy++, tab1, "zoned devices get one PRNG pass, and flash is discarded first if it can be.  " );
+				mvwprintw( main_window, yy++, tab1, "Rotational and unknown devices get the DoD short wipe. Devices with a        " );
+				mvwprintw( main_window, yy++, tab1, "write-zeroes offload blank themselves. The choice is logged for each device. " );
+				break;
+
 		} /* switch */
 
 		/* Add a border. */
@@ -1390,6 +1482,10 @@ void dwipe_gui_method( void )
 		case 5:
 			dwipe_options.method = &dwipe_random;
 			break;
+
+		case 6:
+			dwipe_options.method = &dwipe_auto;
+			break;
 	}
 
 
@@ -1601,8 +1697,8 @@ void dwipe_gui_status( int count, dwipe_context_t* c )
 				/* Update the current average throughput in bytes-per-second. */
 				c[i].throughput = c[i].speedring.bytestotal / c[i].speedring.timestotal;
 
-				/* Update the estimated remaining runtime. */
-				c[i].eta = ( c[i].round_size - c[i].round_done ) / c[i].throughput;
+				/* Update the estimated remaining runtime from the throughput profile. */
+				c[i].eta = dwipe_profile_eta( &c[i] );
 
 				if( c[i].eta > dwipe_maxeta )
 				{
@@ -1631,6 +1727,12 @@ void dwipe_gui_status( int count, dwipe_context_t* c )
 		/* Print the context label. */
 		mvwprintw( main_window, yy++, 2, "%s", c[i].label );
 
+		if( c[i].plan != NULL )
+		{
+			/* Show what the auto method picked for this device. */
+			wprintw( main_window, " [%s: %s]", c[i].plan, dwipe_method_label( c[i].method ) );
+		}
+
 		/* Check whether the child process is still running the wipe. */
 		if( c[i].pid > 0 )
 		{
@@ -1675,6 +1777,7 @@ void dwipe_gui_status( int count, dwipe_context_t* c )
 		}
 
   		if( c[i].sync_status   ) { wprintw( main_window, "[syncing] "   ); }
+		if( c[i].health        ) { wprintw( main_window, "[%s] ", dwipe_health_label( c[i].health ) ); }
 
 		     if( c[i].throughput >= INT64_C( 1000000000000000 ) )
 			    { wprintw( main_window, "[%llu TB/s] ", c[i].throughput / INT64_C( 1000000000000 ) ); }
@@ -0,0 +1,286 @@
+/*
+ *  health.c: Slow and stalling device detection.
+ *
+ *  Copyright Paolo Iannelli <info@paoloiannelli.com>.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc., 675 Mass
+ *  Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include "dwipe.h"
+#include "context.h"
+#include "method.h"
+#include "prng.h"
+#include "options.h"
+#include "gui.h"
+#include "health.h"
+#include "logging.h"
+#include "notify.h"
+
+#include <signal.h>
+
+
+
+u64 dwipe_health_clock( void )
+{
+/**
+ * Returns a monotonic time in milliseconds for timing single requests.
+ *
+ */
+
+	struct timespec t;
+
+	clock_gettime( CLOCK_MONOTONIC, &t );
+
+	return (u64)t.tv_sec * 1000 + t.tv_nsec / 1000000;
+
+} /* dwipe_health_clock */
+
+
+
+void dwipe_health_latency( dwipe_context_t* c, u64 start, ssize_t moved )
+{
+/**
+ * Records the latency of one request that began at start, and the bytes that it moved.
+ * Skipped ranges and offloads move nothing, so they stay out of the health rates. The
+ * child calls this, and the parent reads the counters from the shared context.
+ *
+ */
+
+	u64 d = dwipe_health_clock() - start;
+	u64 max;
+
+	if( moved > 0 )
+	{
+		__sync_fetch_and_add( &c->health_io[ c->pass_type == DWIPE_PASS_VERIFY ], moved );
+	}
+
+	/* The zone threads of one child share the context, so the counters are atomic. */
+	max = c->latency_max;
+
+	while( d > max && ! __sync_bool_compare_and_swap( &c->latency_max, max, d ) )
+	{
+		max = c->latency_max;
+	}
+
+	if( d >= DWIPE_KNOB_HEALTH_SPIKE )
+	{
+		__sync_fetch_and_add( &c->latency_spikes, 1 );
+		dwipe_log( DWIPE_LOG_WARNING, "A request to '%s' took %llu ms.", c->device_name, d );
+	}
+
+} /* dwipe_health_latency */
+
+
+
+const char* dwipe_health_label( int health )
+{
+/**
+ * Returns a printable list of health flags.
+ *
+ */
+
+	static char label [64];
+
+	label[0] = '\0';
+
+	if( health & DWIPE_HEALTH_SLOW       ) { strcat( label, "slow, "          ); }
+	if( health & DWIPE_HEALTH_SLOW_PEERS ) { strcat( label, "slower than peers, " ); }
+	if( health & DWIPE_HEALTH_STALLED    ) { strcat( label, "stalled, "       ); }
+	if( health & DWIPE_HEALTH_LATENCY    ) { strcat( label, "latency spikes, " ); }
+
+	if( label[0] == '\0' ) { return "ok"; }
+
+	/* Drop the trailing separator. */
+	label[ strlen( label ) - 2 ] = '\0';
+
+	return label;
+
+} /* dwipe_health_label */
+
+
+
+static const char* dwipe_health_model( dwipe_context_t* c )
+{
+/**
+ * Returns the model part of the context label, which follows the device name.
+ *
+ */
+
+	char* s = strstr( c->label, " - " );
+
+	return s == NULL ? c->label : s + 3;
+
+} /* dwipe_health_model */
+
+
+
+static int dwipe_health_compare( const void* a, const void* b )
+{
+	u64 x = *(const u64*)a;
+	u64 y = *(const u64*)b;
+
+	return ( x > y ) - ( x < y );
+
+} /* dwipe_health_compare */
+
+
+
+void dwipe_health_check( int count, dwipe_context_t* c )
+{
+/**
+ * Flags running devices whose throughput collapsed, that lag their peers of the same model,
+ * that stopped making progress, or that keep taking seconds per request. The rates come from
+ * the bytes that requests actually moved, so skipped and offloaded ranges do not count.
+ *
+ * @parameter count  The number of contexts in the array.
+ * @parameter c      An array of device contexts.
+ *
+ */
+
+	time_t now = time( NULL );
+	u64* peers;
+	int judged;
+	int i;
+	int j;
+	int k;
+
+	peers = malloc( count * sizeof( u64 ) );
+
+	if( peers == NULL ) { return; }
+
+	for( i = 0 ; i < count ; i++ )
+	{
+		if( c[i].pid <= 0 ) { continue; }
+
+		/* Writes and verify reads are judged apart. Syncs, offloads, waits for the */
+		/* shared stream and the gaps between passes are not judged at all.         */
+		k = c[i].pass_type == DWIPE_PASS_VERIFY;
+
+		judged = c[i].pass_type != DWIPE_PASS_NONE && ! c[i].sync_status && ! c[i].stream_waiting && ! c[i].offload_status \
+		  && ! ( c[i].pass_type == DWIPE_PASS_FINAL_BLANK && ( c[i].plan_flags & DWIPE_PLAN_ZEROOUT ) );
+
+		if( ! judged )
+		{
+			c[i].health_class = 0;
+			c[i].health_rate  = 0;
+			continue;
+		}
+
+		if( c[i].health_class != k + 1 )
+		{
+			/* Resume the ring of this class without the time that it was idle. */
+			c[i].health_ring[k].byteslast = c[i].health_io[k];
+			c[i].health_ring[k].timeslast = now;
+			c[i].health_class = k + 1;
+		}
+
+		dwipe_update_speedring( &c[i].health_ring[k], c[i].health_io[k], now );
+
+		c[i].health_rate = 0;
+
+		if( c[i].health_ring[k].timestotal >= DWIPE_KNOB_HEALTH_WARMUP )
+		{
+			c[i].health_rate = c[i].health_ring[k].bytestotal / c[i].health_ring[k].timestotal;
+		}
+	}
+
+	for( i = 0 ; i < count ; i++ )
+	{
+		int health = 0;
+		int n = 0;
+
+		if( c[i].pid <= 0 ) { continue; }
+
+		/* Stalls are timed from the last change in progress, or from the end of a wait */
+		/* for the shared stream, which depends on the slowest consumer, or of an offload. */
+		if( c[i].health_moved == 0 || c[i].round_done != c[i].health_done || c[i].stream_waiting || c[i].offload_status )
+		{
+			c[i].health_done  = c[i].round_done;
+			c[i].health_moved = now;
+		}
+
+		/* A long sync, discard or zone reset is not a stall. */
+		if( ! c[i].sync_status && ! c[i].stream_waiting && ! c[i].offload_status && now - c[i].health_moved >= DWIPE_KNOB_HEALTH_STALL )
+		{
+			health |= DWIPE_HEALTH_STALLED;
+		}
+
+		if( c[i].latency_spikes >= DWIPE_KNOB_HEALTH_SPIKES )
+		{
+			health |= DWIPE_HEALTH_LATENCY;
+		}
+
+		if( c[i].health_rate > 0 )
+		{
+			k = c[i].health_class - 1;
+
+			/* The baseline is the best rolling rate of this device in the same class. */
+			if( c[i].health_rate > c[i].health_best[k] )
+			{
+				c[i].health_best[k] = c[i].health_rate;
+			}
+
+			if( c[i].health_rate < c[i].health_best[k] / 100 * DWIPE_KNOB_HEALTH_BASELINE )
+			{
+				health |= DWIPE_HEALTH_SLOW;
+			}
+
+			/* Collect the peers of the same model that are past their warmup in the same class. */
+			for( j = 0 ; j < count ; j++ )
+			{
+				if( c[j].pid > 0 && c[j].health_rate > 0 && c[j].health_class == c[i].health_class \
+				  && strcmp( dwipe_health_model( &c[i] ), dwipe_health_model( &c[j] ) ) == 0 )
+				{
+					peers[n++] = c[j].health_rate;
+				}
+			}
+
+			if( n >= DWIPE_KNOB_HEALTH_PEERS_MIN )
+			{
+				qsort( peers, n, sizeof( u64 ), dwipe_health_compare );
+
+				if( c[i].health_rate < peers[n / 2] / 100 * DWIPE_KNOB_HEALTH_PEERS )
+				{
+					health |= DWIPE_HEALTH_SLOW_PEERS;
+				}
+			}
+		}
+
+		/* Only report flags that are new. */
+		health &= ~c[i].health;
+
+		if( health == 0 ) { continue; }
+
+		c[i].health |= health;
+
+		dwipe_log( DWIPE_LOG_WARNING, "Device '%s' is unhealthy: %s (%llu B/s, best %llu B/s, worst request %llu ms).", \
+		  c[i].device_name, dwipe_health_label( health ), c[i].health_rate, c[i].health_class ? c[i].health_best[ c[i].health_class - 1 ] : 0, c[i].latency_max );
+
+		dwipe_notify_health( &c[i] );
+
+		if( dwipe_options.abort_unhealthy )
+		{
+			/* Free the bay for the next batch. */
+			dwipe_log( DWIPE_LOG_WARNING, "Aborting the wipe of '%s'.", c[i].device_name );
+			kill( c[i].pid, SIGTERM );
+		}
+
+	} /* for */
+
+	free( peers );
+
+} /* dwipe_health_check */
+
+/* eof */
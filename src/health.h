@@ -0,0 +1,45 @@
+/*
+ *  health.h: Slow and stalling device detection.
+ *
+ *  Copyright Paolo Iannelli <info@paoloiannelli.com>.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc., 675 Mass
+ *  Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#ifndef HEALTH_H_
+#define HEALTH_H_
+
+#define DWIPE_KNOB_HEALTH_WARMUP          60                  /* Seconds of throughput history before judging a device. */
+#define DWIPE_KNOB_HEALTH_BASELINE        25                  /* Percent of its own best throughput that a device must hold. */
+#define DWIPE_KNOB_HEALTH_PEERS           50                  /* Percent of the median throughput of its peers.            */
+#define DWIPE_KNOB_HEALTH_PEERS_MIN       3                   /* The number of same-model devices that make a peer group.  */
+#define DWIPE_KNOB_HEALTH_STALL           120                 /* Seconds without progress before a device is stalled.      */
+#define DWIPE_KNOB_HEALTH_SPIKE           2000                /* Milliseconds that make a single request a latency spike.  */
+#define DWIPE_KNOB_HEALTH_SPIKES          3                   /* The number of spikes before a device is flagged.          */
+
+/* Health flags, which are never cleared once set. */
+#define DWIPE_HEALTH_SLOW       0x01  /* Throughput collapsed against the device's own baseline. */
+#define DWIPE_HEALTH_SLOW_PEERS 0x02  /* Throughput is far below peers of the same model.        */
+#define DWIPE_HEALTH_STALLED    0x04  /* No progress for DWIPE_KNOB_HEALTH_STALL seconds.         */
+#define DWIPE_HEALTH_LATENCY    0x08  /* Repeated per-request latency spikes.                    */
+
+u64  dwipe_health_clock( void );
+void dwipe_health_latency( dwipe_context_t* c, u64 start, ssize_t moved );
+void dwipe_health_check( int count, dwipe_context_t* c );
+const char* dwipe_health_label( int health );
+
+#endif /* HEALTH_H_ */
+
+/* eof */
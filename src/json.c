@@ -23,7 +23,13 @@
 #include "context.h"
 #include "method.h"
 #include "prng.h"
+#include "backend.h"
 #include "options.h"
+#include "health.h"
+#include "profile.h"
+#include "device.h"
+#include "seed.h"
+#include "cpu.h"
 #include <json/json.h>
 
 /* The combined number of errors of all processes. */
@@ -52,9 +58,21 @@ const char* dwipe_get_info_json( void )
 	char* tmp;
 	json_object* jdwipe = json_object_new_object();
 	json_object* jinfo  = json_object_new_object();
+	json_object* jcpu   = json_object_new_object();
 
-	json_object_object_add( jinfo, "entropy", json_object_new_string( "Linux Kernel (urandom)" ) );
+	json_object_object_add( jinfo, "entropy", json_object_new_string( dwipe_seed_source ) );
 	json_object_object_add( jinfo, "prng", json_object_new_string( dwipe_options.prng->label ) );
+
+	/* The instruction set variants that the dispatch layer picked. */
+	json_object_object_add( jcpu, "detected", json_object_new_string( dwipe_cpu_label( dwipe_cpu_detect() ) ) );
+	json_object_object_add( jcpu, "level", json_object_new_string( dwipe_cpu_label( dwipe_cpu_level() ) ) );
+	json_object_object_add( jcpu, "zero_check", json_object_new_string( dwipe_cpu_label( dwipe_kernels.level ) ) );
+	json_object_object_add( jcpu, "compare", json_object_new_string( dwipe_cpu_label( dwipe_kernels.level ) ) );
+	json_object_object_add( jcpu, "pattern_fill", json_object_new_string( dwipe_cpu_label( dwipe_kernels.level ) ) );
+	json_object_object_add( jcpu, "prng_fill", json_object_new_string( dwipe_prng_variant( dwipe_options.prng ) ) );
+	json_object_object_add( jinfo, "cpu", jcpu );
+
+	json_object_object_add( jinfo, "io", json_object_new_string( dwipe_options.backend->label ) );
 	json_object_object_add( jinfo, "method", json_object_new_string( dwipe_method_label( dwipe_options.method ) ) );
 	json_object_object_add( jinfo, "verify", json_object_new_int( dwipe_options.verify ) );
 	json_object_object_add( jinfo, "rounds", json_object_new_int( dwipe_options.rounds ) );
@@ -95,6 +113,9 @@ const char* dwipe_get_status_json( dwipe_context_t* context )
 			json_object* jdevice = json_object_new_object();
 			json_object* jround = json_object_new_object();
 			json_object* jpass = json_object_new_object();
+			json_object* jprofile = json_object_new_object();
+			json_object* jrates = json_object_new_array();
+			int k;
 
 			json_object_object_add( jdisk, "name", json_object_new_string( context[i].device_name ) );
 			json_object_object_add( jdisk, "select", json_object_new_int( context[i].select ) );
@@ -105,6 +126,17 @@ const char* dwipe_get_status_json( dwipe_context_t* context )
 			json_object_object_add( jdisk, "sync_status", json_object_new_int( context[i].sync_status ) );
 			json_object_object_add( jdisk, "throughput", json_object_new_double( context[i].throughput ) );
 			json_object_object_add( jdisk, "verify_errors", json_object_new_double( context[i].verify_errors ) );
+			json_object_object_add( jdisk, "bytes_written", json_object_new_double( context[i].bytes_written ) );
+			json_object_object_add( jdisk, "bytes_skipped", json_object_new_double( context[i].bytes_skipped ) );
+			json_object_object_add( jdisk, "health", json_object_new_int( context[i].health ) );
+			json_object_object_add( jdisk, "health_label", json_object_new_string( dwipe_health_label( context[i].health ) ) );
+			json_object_object_add( jdisk, "latency_max", json_object_new_double( context[i].latency_max ) );
+			json_object_object_add( jdisk, "latency_spikes", json_object_new_double( context[i].latency_spikes ) );
+
+			/* The enumerated devices only get their method when they are selected. */
+			json_object_object_add( jdisk, "method", json_object_new_string( dwipe_method_label( context[i].method != NULL ? context[i].method : dwipe_options.method ) ) );
+			json_object_object_add( jdisk, "plan", json_object_new_string( context[i].plan != NULL ? context[i].plan : "" ) );
+			json_object_object_add( jdisk, "media", json_object_new_string( dwipe_media_label( context[i].media ) ) );
 
 			json_object_object_add( jdevice, "bus", json_object_new_int( context[i].device_bus ) );
 			json_object_object_add( jdevice, "fd", json_object_new_int( context[i].device_fd ) );
@@ -133,6 +165,16 @@ const char* dwipe_get_status_json( dwipe_context_t* context )
 			json_object_object_add( jround, "working", json_object_new_int( context[i].round_working ) );
 			json_object_object_add( jdisk, "round", jround );
 
+			/* The throughput of each LBA range, or 0 where it is not measured yet. */
+			for( k = 0 ; k < DWIPE_KNOB_PROFILE_BUCKETS ; k++ )
+			{
+				json_object_array_add( jrates, json_object_new_double( dwipe_profile_throughput( &context[i], k ) ) );
+			}
+
+			json_object_object_add( jprofile, "bucket", json_object_new_double( dwipe_profile_bucket( &context[i] ) ) );
+			json_object_object_add( jprofile, "throughput", jrates );
+			json_object_object_add( jdisk, "profile", jprofile );
+
 			json_object_array_add( jdisks, jdisk );
                 }
         }
@@ -0,0 +1,459 @@
+/*
+ *  metadata.c: The metadata pre-pass that runs before the first full pass.
+ *
+ *  Copyright Paolo Iannelli <info@paoloiannelli.com>.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc., 675 Mass
+ *  Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include "dwipe.h"
+#include "context.h"
+#include "method.h"
+#include "prng.h"
+#include "options.h"
+#include "backend.h"
+#include "metadata.h"
+#include "profile.h"
+#include "zone.h"
+#include "logging.h"
+
+#include <endian.h>
+
+/* A device range that holds metadata. */
+typedef struct dwipe_range_t_
+{
+	loff_t offset;
+	u64    length;
+} dwipe_range_t;
+
+typedef struct dwipe_ranges_t_
+{
+	dwipe_range_t range [DWIPE_KNOB_METADATA_RANGES];
+	int           count;
+} dwipe_ranges_t;
+
+
+
+static void dwipe_metadata_add( dwipe_context_t* c, dwipe_ranges_t* list, loff_t offset, u64 length )
+{
+/**
+ * Adds a range to the pre-pass list after clamping it to the device.
+ *
+ */
+
+	if( offset < 0 || offset >= c->device_size || length == 0 ) { return; }
+
+	if( length > c->device_size - offset ) { length = c->device_size - offset; }
+
+	if( list->count >= DWIPE_KNOB_METADATA_RANGES )
+	{
+		/* The most important ranges are added first, so the rest can be dropped. */
+		return;
+	}
+
+	list->range[list->count].offset = offset;
+	list->range[list->count].length = length;
+	list->count += 1;
+
+} /* dwipe_metadata_add */
+
+
+
+static int dwipe_metadata_read( dwipe_context_t* c, void* buffer, size_t count, loff_t offset )
+{
+/**
+ * Reads metadata directly from the device, because the i/o backend may not be able to read.
+ *
+ * @returns  Zero if the whole range was read.
+ *
+ */
+
+	if( offset < 0 || offset + count > c->device_size ) { return -1; }
+
+	return ( pread( c->device_fd, buffer, count, offset ) == count ) ? 0 : -1;
+
+} /* dwipe_metadata_read */
+
+
+
+static void dwipe_metadata_region( dwipe_context_t* c, dwipe_ranges_t* list, loff_t start, u64 length )
+{
+/**
+ * Adds the metadata ranges of a whole device or partition.
+ *
+ * Both ends of the region are always overwritten, which takes care of the
+ * LVM2 label, MD superblocks, LUKS headers and the primary superblock of most
+ * filesystems. Backup superblocks are found by probing ext2/3/4 and XFS, and
+ * the btrfs mirrors sit at fixed offsets.
+ *
+ */
+
+	/* The superblock buffer. */
+	u8 sb [1024];
+
+	/* Filesystem geometry. */
+	u64 bs;
+	u64 group;
+	u64 count;
+	u64 g;
+	u64 p;
+
+	if( start < 0 || start >= c->device_size ) { return; }
+
+	if( length > c->device_size - start ) { length = c->device_size - start; }
+
+	/* The start and the end of the region. */
+	dwipe_metadata_add( c, list, start, DWIPE_KNOB_METADATA_EDGE );
+
+	if( length > DWIPE_KNOB_METADATA_EDGE )
+	{
+		dwipe_metadata_add( c, list, start + length - DWIPE_KNOB_METADATA_EDGE, DWIPE_KNOB_METADATA_EDGE );
+	}
+
+	/* The btrfs superblock mirrors. */
+	if( length > 0x4000000ULL     ) { dwipe_metadata_add( c, list, start + 0x4000000ULL,     4096 ); }
+	if( length > 0x4000000000ULL  ) { dwipe_metadata_add( c, list, start + 0x4000000000ULL,  4096 ); }
+
+	if( dwipe_metadata_read( c, sb, sizeof( sb ), start + 1024 ) == 0 && sb[56] == 0x53 && sb[57] == 0xEF )
+	{
+		/* An ext2/3/4 superblock, so find its backups in the block groups. */
+		u32 log_block_size = le32toh( *(uint32_t*)&sb[24] );
+		u32 per_group      = le32toh( *(uint32_t*)&sb[32] );
+		u32 first_block    = le32toh( *(uint32_t*)&sb[20] );
+		u32 ro_compat      = le32toh( *(uint32_t*)&sb[100] );
+
+		if( log_block_size <= 6 && per_group > 0 )
+		{
+			bs = 1024ULL << log_block_size;
+			group = per_group * bs;
+			count = length / group;
+
+			for( g = 1 ; g < count ; g++ )
+			{
+				if( ro_compat & 0x0001 )
+				{
+					/* With sparse_super, backups are only in group 1 and powers of 3, 5 and 7. */
+					for( p = g ; p % 3 == 0 ; p /= 3 );
+					if( p != 1 ) { for( p = g ; p % 5 == 0 ; p /= 5 ); }
+					if( p != 1 ) { for( p = g ; p % 7 == 0 ; p /= 7 ); }
+					if( p != 1 ) { continue; }
+				}
+
+				dwipe_metadata_add( c, list, start + ( g * per_group + first_block ) * bs, bs );
+			}
+		}
+
+		dwipe_log( DWIPE_LOG_INFO, "Found an ext filesystem at offset %llu on '%s'.", (u64)start, c->device_name );
+	}
+
+	if( dwipe_metadata_read( c, sb, 512, start ) == 0 && memcmp( sb, "XFSB", 4 ) == 0 )
+	{
+		/* An XFS superblock, which is repeated at the start of every allocation group. */
+		bs    = be32toh( *(uint32_t*)&sb[4] );
+		group = be32toh( *(uint32_t*)&sb[84] ) * bs;
+		count = be32toh( *(uint32_t*)&sb[88] );
+
+		for( g = 1 ; g < count && group > 0 ; g++ )
+		{
+			dwipe_metadata_add( c, list, start + g * group, 512 );
+		}
+
+		dwipe_log( DWIPE_LOG_INFO, "Found an XFS filesystem at offset %llu on '%s'.", (u64)start, c->device_name );
+	}
+
+} /* dwipe_metadata_region */
+
+
+
+static int dwipe_metadata_gpt( dwipe_context_t* c, dwipe_ranges_t* list )
+{
+/**
+ * Adds the GPT backup header and the regions of every GPT partition.
+ *
+ * @returns  Non-zero if a GPT was found.
+ *
+ */
+
+	/* The header buffer. */
+	u8 h [512];
+
+	/* The partition entry buffer. */
+	u8* e;
+
+	/* The sector sizes that a GPT can use. */
+	const int sizes [] = { 512, 4096, 0 };
+
+	u64 ss = 0;
+	u64 alternate;
+	u64 entries;
+	u32 number;
+	u32 size;
+	u32 i;
+	int j;
+
+	for( j = 0 ; sizes[j] ; j++ )
+	{
+		if( dwipe_metadata_read( c, h, sizeof( h ), sizes[j] ) == 0 && memcmp( h, "EFI PART", 8 ) == 0 )
+		{
+			ss = sizes[j];
+			break;
+		}
+	}
+
+	if( ss == 0 ) { return 0; }
+
+	alternate = le64toh( *(uint64_t*)&h[32] );
+	entries   = le64toh( *(uint64_t*)&h[72] );
+	number    = le32toh( *(uint32_t*)&h[80] );
+	size      = le32toh( *(uint32_t*)&h[84] );
+
+	/* The backup header and the backup partition array that precedes it. */
+	dwipe_metadata_add( c, list, alternate * ss, ss );
+
+	if( number > 128 ) { number = 128; }
+	if( size < 128 || size > 512 ) { return 1; }
+
+	dwipe_metadata_add( c, list, alternate * ss - (u64)number * size, (u64)number * size );
+
+	/* Read the primary partition array. */
+	e = malloc( number * size );
+
+	if( e == NULL ) { return 1; }
+
+	if( dwipe_metadata_read( c, e, number * size, entries * ss ) == 0 )
+	{
+		for( i = 0 ; i < number ; i++ )
+		{
+			u8* p = e + i * size;
+			u64 first = le64toh( *(uint64_t*)&p[32] );
+			u64 last  = le64toh( *(uint64_t*)&p[40] );
+
+			/* Unused entries have a zero type GUID. */
+			if( ( *(uint64_t*)&p[0] | *(uint64_t*)&p[8] ) == 0 || last < first ) { continue; }
+
+			dwipe_metadata_region( c, list, first * ss, ( last - first + 1 ) * ss );
+		}
+	}
+
+	free( e );
+	return 1;
+
+} /* dwipe_metadata_gpt */
+
+
+
+static void dwipe_metadata_mbr( dwipe_context_t* c, dwipe_ranges_t* list )
+{
+/**
+ * Adds the regions of every primary MBR partition.
+ *
+ */
+
+	/* The MBR buffer. */
+	u8 m [512];
+
+	int i;
+
+	if( dwipe_metadata_read( c, m, sizeof( m ), 0 ) != 0 || m[510] != 0x55 || m[511] != 0xAA ) { return; }
+
+	for( i = 0 ; i < 4 ; i++ )
+	{
+		u8* p = m + 446 + i * 16;
+		u32 first = le32toh( *(uint32_t*)&p[8] );
+		u32 count = le32toh( *(uint32_t*)&p[12] );
+
+		/* Skip empty slots and the protective entry of a GPT. */
+		if( p[4] == 0x00 || p[4] == 0xEE || count == 0 ) { continue; }
+
+		/* The head of an extended partition holds the first EBR. */
+		dwipe_metadata_region( c, list, (u64)first * 512, (u64)count * 512 );
+	}
+
+} /* dwipe_metadata_mbr */
+
+
+
+static void dwipe_metadata_list( dwipe_context_t* c, dwipe_ranges_t* list )
+{
+/**
+ * Probes the device for every metadata range. Everything is probed before anything is
+ * written, because the writes destroy the tables.
+ *
+ */
+
+	dwipe_metadata_region( c, list, 0, c->device_size );
+
+	if( ! dwipe_metadata_gpt( c, list ) )
+	{
+		dwipe_metadata_mbr( c, list );
+	}
+
+} /* dwipe_metadata_list */
+
+
+
+double dwipe_metadata_time( dwipe_context_t* c )
+{
+/**
+ * Estimates the time of the pre-pass from the throughput profile, without writing.
+ *
+ * @returns  The time in seconds, or -1 if the ranges could not be listed.
+ *
+ */
+
+	dwipe_ranges_t* list = calloc( 1, sizeof( dwipe_ranges_t ) );
+
+	double t = 0;
+	int i;
+
+	if( list == NULL )
+	{
+		dwipe_perror( errno, __FUNCTION__, "malloc" );
+		return -1;
+	}
+
+	dwipe_metadata_list( c, list );
+
+	for( i = 0 ; i < list->count ; i++ )
+	{
+		t += dwipe_profile_time( c, list->range[i].offset, list->range[i].offset + list->range[i].length );
+	}
+
+	free( list );
+
+	return t;
+
+} /* dwipe_metadata_time */
+
+
+
+int dwipe_metadata_pass( dwipe_context_t* c )
+{
+/**
+ * Overwrites the partition tables, volume headers and filesystem superblocks
+ * so that the device is unusable long before the first full pass finishes.
+ *
+ * The ranges are written with zeros through the i/o backend and are flushed
+ * before returning. They are not counted in the round progress.
+ *
+ */
+
+	/* The result holder. */
+	int r;
+
+	/* The list of ranges to overwrite. */
+	dwipe_ranges_t* list;
+
+	/* The zero buffer. */
+	char* b;
+
+	/* The range index and the position within the range. */
+	int i;
+	u64 k;
+	size_t n;
+
+	/* The number of bytes that were written. */
+	u64 written = 0;
+
+	list = calloc( 1, sizeof( dwipe_ranges_t ) );
+	b = calloc( 1, DWIPE_KNOB_METADATA_EDGE );
+
+	/* Check the memory allocation. */
+	if( ! list || ! b )
+	{
+		dwipe_perror( errno, __FUNCTION__, "malloc" );
+		dwipe_log( DWIPE_LOG_FATAL, "Unable to allocate memory for the metadata pre-pass." );
+		return -1;
+	}
+
+	dwipe_metadata_list( c, list );
+
+	if( c->zoned )
+	{
+		/* Resetting the sequential zones drops their contents at once. */
+		if( dwipe_zone_reset( c ) < 0 ) { return -1; }
+
+		/* Only the conventional zones can be overwritten out of order. */
+		for( i = 0, k = 0 ; i < list->count ; i++ )
+		{
+			if( dwipe_zone_conventional( c, list->range[i].offset, list->range[i].length ) )
+			{
+				list->range[k++] = list->range[i];
+			}
+		}
+
+		list->count = k;
+	}
+
+	dwipe_log( DWIPE_LOG_NOTICE, "Overwriting %i metadata ranges on '%s'.", list->count, c->device_name );
+
+	for( i = 0 ; i < list->count ; i++ )
+	{
+		dwipe_log( DWIPE_LOG_DEBUG, "Metadata range at offset %llu, %llu bytes, on '%s'.", \
+		  (u64)list->range[i].offset, list->range[i].length, c->device_name );
+
+		for( k = 0 ; k < list->range[i].length ; k += n )
+		{
+			n = list->range[i].length - k;
+
+			if( n > DWIPE_KNOB_METADATA_EDGE ) { n = DWIPE_KNOB_METADATA_EDGE; }
+
+			r = c->backend->write( c, b, n, list->range[i].offset + k );
+
+			if( r < 0 )
+			{
+				dwipe_perror( errno, __FUNCTION__, "write" );
+				dwipe_log( DWIPE_LOG_FATAL, "Unable to write to '%s'.", c->device_name );
+				return -1;
+			}
+
+			if( r != n )
+			{
+				c->pass_errors += n - r;
+				dwipe_log( DWIPE_LOG_WARNING, "Partial write on '%s', %i bytes short.", c->device_name, (int)( n - r ) );
+			}
+
+			written += r;
+		}
+	}
+
+	/* A sink that keeps nothing has not written anything. */
+	if( c->backend->caps & DWIPE_BACKEND_CAP_DURABLE ) { c->bytes_written += written; }
+
+	/* Tell our parent that we are syncing the device. */
+	c->sync_status = 1;
+
+	/* Sync the device. */
+	r = c->backend->flush( c );
+
+	/* Tell our parent that we have finished syncing the device. */
+	c->sync_status = 0;
+
+	if( r != 0 )
+	{
+		dwipe_perror( errno, __FUNCTION__, "flush" );
+		dwipe_log( DWIPE_LOG_WARNING, "Buffer flush failure on '%s'.", c->device_name );
+	}
+
+	dwipe_log( DWIPE_LOG_NOTICE, "Wrote %llu bytes of metadata on '%s'.", written, c->device_name );
+
+	free( list );
+	free( b );
+
+	return 0;
+
+} /* dwipe_metadata_pass */
+
+/* eof */
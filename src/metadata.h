@@ -0,0 +1,35 @@
+/*
+ *  metadata.h: The metadata pre-pass that runs before the first full pass.
+ *
+ *  Copyright Paolo Iannelli <info@paoloiannelli.com>.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc., 675 Mass
+ *  Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#ifndef METADATA_H_
+#define METADATA_H_
+
+/* The number of bytes that are overwritten at each end of the device and of each partition. */
+#define DWIPE_KNOB_METADATA_EDGE          4194304             /* 4 MiB */
+
+/* The maximum number of ranges that the pre-pass will overwrite. */
+#define DWIPE_KNOB_METADATA_RANGES        512
+
+int    dwipe_metadata_pass( dwipe_context_t* c );
+double dwipe_metadata_time( dwipe_context_t* c );
+
+#endif /* METADATA_H_ */
+
+/* eof */
@@ -41,8 +41,13 @@
 #include "context.h"
 #include "method.h"
 #include "prng.h"
+#include "backend.h"
+#include "metadata.h"
 #include "options.h"
 #include "pass.h"
+#include "substream.h"
+#include "seed.h"
+#include "device.h"
 #include "logging.h"
 
 
@@ -56,6 +61,7 @@
  *
  */
 
+const char* dwipe_auto_label       = "Automatic (per device)";
 const char* dwipe_dod522022m_label = "DoD 5220.22-M";
 const char* dwipe_dodshort_label   = "DoD Short";
 const char* dwipe_gutmann_label    = "Gutmann Wipe";
@@ -65,6 +71,32 @@ const char* dwipe_zero_label       = "Quick Erase";
 
 const char* dwipe_unknown_label    = "Unknown Method (FIXME)";
 
+/* An auto policy rule. The rule matches a device of its media class that offers every offload in flags. */
+typedef struct /* dwipe_policy_t */
+{
+	dwipe_media_t  media;   /* The media class that the rule applies to.                  */
+	int            flags;   /* The DWIPE_PLAN_* steps, which need the matching offloads.  */
+	dwipe_method_t method;  /* The method that the device runs.                           */
+	const char*    label;   /* The name of the rule in the log and the result file.       */
+} dwipe_policy_t;
+
+/* The auto policy. The first rule that matches wins, so the rules with offloads come first.   */
+/* Overwriting flash more than once only wears it, because the FTL remaps every write, and    */
+/* zoned devices are reset before each pass, so both get one random pass and the blank.      */
+static const dwipe_policy_t dwipe_policy [] =
+{
+	{ DWIPE_MEDIA_ZONED,   0,                                       &dwipe_random,   "zoned"          },
+	{ DWIPE_MEDIA_FLASH,   DWIPE_PLAN_DISCARD | DWIPE_PLAN_ZEROOUT, &dwipe_random,   "flash-offload"  },
+	{ DWIPE_MEDIA_FLASH,   DWIPE_PLAN_DISCARD,                      &dwipe_random,   "flash-discard"  },
+	{ DWIPE_MEDIA_FLASH,   0,                                       &dwipe_random,   "flash"          },
+	{ DWIPE_MEDIA_DISK,    DWIPE_PLAN_ZEROOUT,                      &dwipe_dodshort, "disk-offload"   },
+	{ DWIPE_MEDIA_DISK,    0,                                       &dwipe_dodshort, "disk"           },
+	{ DWIPE_MEDIA_UNKNOWN, 0,                                       &dwipe_dodshort, "unknown"        },
+};
+
+/* When set, dwipe_runmethod hands the patterns to this function instead of wiping. */
+static dwipe_method_visitor_t dwipe_runmethod_visitor = NULL;
+
 const char* dwipe_method_label( dwipe_method_t method )
 {
 /**
@@ -72,6 +104,7 @@ const char* dwipe_method_label( dwipe_method_t method )
  *
  */
 
+	if( method == &dwipe_auto       ) { return dwipe_auto_label;       }
 	if( method == &dwipe_dod522022m ) { return dwipe_dod522022m_label; }
 	if( method == &dwipe_dodshort   ) { return dwipe_dodshort_label;   }
 	if( method == &dwipe_gutmann    ) { return dwipe_gutmann_label;    }
@@ -112,9 +145,6 @@ int dwipe_dod522022m( DWIPE_METHOD_SIGNATURE )
  * 
  */
 
-	/* A result holder. */
-	int r;
-
 	/* Random characters. (Elements 2 and 6 are unused.) */
 	char dod [7];
 
@@ -131,23 +161,10 @@ int dwipe_dod522022m( DWIPE_METHOD_SIGNATURE )
 	};
 
 	/* Load the array with random characters. */
-	r = read( c->entropy_fd, &dod, sizeof( dod ) );
+	dwipe_seed_derive( c->seed_key, DWIPE_SEED_METHOD, 0, 0, &dod, sizeof( dod ) );
 
 	/* NOTE: Only the random data in dod[0], dod[3], and dod[4] is actually used. */
 
-	/* Check the result. */
-	if( r != sizeof( dod ) )
-	{
-		r = errno;
-		dwipe_perror( r, __FUNCTION__, "read" );
-		dwipe_log( DWIPE_LOG_FATAL, "Unable to seed the %s method.", dwipe_dod522022m_label );
-
-		/* Ensure a negative return. */
-		if( r < 0 ) { return  r; }
-		else        { return -1; }
-
-	}
-
 	/* Pass 2 is the bitwise complement of Pass 1. */
 	dod[1] = ~ dod[0];
 
@@ -169,9 +186,6 @@ int dwipe_dodshort( DWIPE_METHOD_SIGNATURE )
  * 
  */
 
-	/* A result holder. */
-	int r;
-
 	/* Random characters. (Element 3 is unused.) */
 	char dod [3];
 
@@ -184,23 +198,10 @@ int dwipe_dodshort( DWIPE_METHOD_SIGNATURE )
 	};
 
 	/* Load the array with random characters. */
-	r = read( c->entropy_fd, &dod, sizeof( dod ) );
+	dwipe_seed_derive( c->seed_key, DWIPE_SEED_METHOD, 0, 0, &dod, sizeof( dod ) );
 
 	/* NOTE: Only the random data in dod[0] is actually used. */
 
-	/* Check the result. */
-	if( r != sizeof( dod ) )
-	{
-		r = errno;
-		dwipe_perror( r, __FUNCTION__, "read" );
-		dwipe_log( DWIPE_LOG_FATAL, "Unable to seed the %s method.", dwipe_dodshort_label );
-
-		/* Ensure a negative return. */
-		if( r < 0 ) { return  r; }
-		else        { return -1; }
-
-	}
-
 	/* Pass 2 is the bitwise complement of Pass 1. */
 	dod[1] = ~ dod[0];
 
@@ -218,9 +219,6 @@ int dwipe_gutmann( DWIPE_METHOD_SIGNATURE )
  *
  */
 
-	/* A result buffer. */
-	int r;
-
 	/* The number of patterns in the Guttman Wipe, also used to index the 'patterns' array. */
 	int i = 35;
 
@@ -278,18 +276,7 @@ int dwipe_gutmann( DWIPE_METHOD_SIGNATURE )
 	u16 s [i];
 
 	/* Load the array with random characters. */
-	r = read( c->entropy_fd, &s, sizeof( s ) );
-
-	if( r != sizeof( s ) )
-	{
-		r = errno;
-		dwipe_perror( r, __FUNCTION__, "read" );
-		dwipe_log( DWIPE_LOG_FATAL, "Unable to seed the %s method.", dwipe_gutmann_label );
-		
-		/* Ensure a negative return. */
-		if( r < 0 ) { return  r; }
-		else        { return -1; }
-	}
+	dwipe_seed_derive( c->seed_key, DWIPE_SEED_METHOD, 0, 0, &s, sizeof( s ) );
 
 
 	while( --i >= 0 )
@@ -402,18 +389,7 @@ int dwipe_ops2( DWIPE_METHOD_SIGNATURE )
 
 
 	/* Load the array of random characters. */
-	r = read( c->entropy_fd, s, u );
-
-	if( r != u )
-	{
-		r = errno;
-		dwipe_perror( r, __FUNCTION__, "read" );
-		dwipe_log( DWIPE_LOG_FATAL, "Unable to seed the %s method.", dwipe_ops2_label );
-		
-		/* Ensure a negative return. */
-		if( r < 0 ) { return  r; }
-		else        { return -1; }
-	}
+	dwipe_seed_derive( c->seed_key, DWIPE_SEED_METHOD, 0, 0, s, u );
 
 
 	for( i = 0 ; i < u ; i += 1 )
@@ -491,74 +467,99 @@ int dwipe_random( DWIPE_METHOD_SIGNATURE )
 } /* dwipe_zero */
 
 
-
-int dwipe_runmethod( DWIPE_METHOD_SIGNATURE, dwipe_pattern_t* patterns )
+void dwipe_method_select( DWIPE_METHOD_SIGNATURE )
 {
 /**
- * Writes patterns to the device.
+ * Sets the method that the device runs. With the auto method, the first rule of the
+ * policy table that matches the media class and the offloads of the device is used.
+ *
+ * @parameter  c  A context that dwipe_device_media() has probed.
+ * @modifies   c->method, c->plan, c->plan_flags
  *
  */
 
-	/* The result holder. */
-	int r;
+	extern dwipe_backend_t dwipe_backend_posix;
 
-	/* An index variable. */
-	int i = 0;
+	/* The DWIPE_PLAN_* steps that this device can take. */
+	int offload = 0;
 
-	/* The zero-fill pattern for the final pass of most methods. */
-	dwipe_pattern_t pattern_zero = { 1, "\x00" };
+	int i;
 
+	c->method = dwipe_options.method;
+	c->plan = NULL;
+	c->plan_flags = 0;
 
-	/* Create the PRNG state buffer. */
-	c->prng_seed.length = DWIPE_KNOB_PRNG_STATE_LENGTH;
-	c->prng_seed.s = malloc( c->prng_seed.length );
+	if( dwipe_options.method != &dwipe_auto ) { return; }
 
-	/* Check the memory allocation. */
-	if( ! c->prng_seed.s )
+	if( c->discard_max > 0 && c->backend->caps & DWIPE_BACKEND_CAP_DISCARD )
 	{
-		dwipe_perror( errno, __FUNCTION__, "malloc" );
-		dwipe_log( DWIPE_LOG_FATAL, "Unable to allocate memory for the prng seed buffer." );
-		return -1;
+		offload |= DWIPE_PLAN_DISCARD;
 	}
 
-	/* Count the number of patterns in the array. */
-	while( patterns[i].length ) { i += 1; }
- 
-
-	/* Tell the parent the number of device passes that will be run in one round. */
-	c->pass_count = i;
-
-	/* Set the number of bytes that will be written across all passes in one round. */
-	c->pass_size = c->pass_count * c->device_size;
+	if( c->zeroes_max > 0 && c->backend == &dwipe_backend_posix && S_ISBLK( c->device_stat.st_mode ) )
+	{
+		/* The ioctl bypasses the backend, so only the plain pread/pwrite backend may use it. */
+		offload |= DWIPE_PLAN_ZEROOUT;
+	}
 
-	if( dwipe_options.verify == DWIPE_VERIFY_ALL )
+	/* Every media class has a rule without offloads, so one always matches. */
+	for( i = 0 ; i < sizeof( dwipe_policy ) / sizeof( dwipe_policy[0] ) ; i++ )
 	{
-		/* We must read back all passes, so double the byte count. */
-		c->pass_size *= 2;
+		if( dwipe_policy[i].media == c->media && ( dwipe_policy[i].flags & offload ) == dwipe_policy[i].flags )
+		{
+			c->method = dwipe_policy[i].method;
+			c->plan = dwipe_policy[i].label;
+			c->plan_flags = dwipe_policy[i].flags;
+			break;
+		}
 	}
 
+	dwipe_log( DWIPE_LOG_NOTICE, "The auto policy picked '%s' for '%s', which is %s media, by rule '%s'%s%s.", \
+	  dwipe_method_label( c->method ), c->device_name, dwipe_media_label( c->media ), c->plan, \
+	  c->plan_flags & DWIPE_PLAN_DISCARD ? ", discarding first" : "", \
+	  c->plan_flags & DWIPE_PLAN_ZEROOUT ? ", with an offloaded blank" : "" );
 
-	/* Tell the parent the number of rounds that will be run. */
-	c->round_count = dwipe_options.rounds;
+} /* dwipe_method_select */
 
-	/* Set the number of bytes that will be written across all rounds. */
-	c->round_size = c->round_count * c->pass_size;
 
-	/* The final pass is always a zero fill, except ops2 which is random. */
-	c->round_size += c->device_size;
 
-	if( dwipe_options.verify == DWIPE_VERIFY_LAST || dwipe_options.verify == DWIPE_VERIFY_ALL )
-	{
-		/* We must read back the last pass to verify it. */
-		c->round_size += c->device_size;
-	}
+int dwipe_auto( DWIPE_METHOD_SIGNATURE )
+{
+/**
+ * Runs the method that the auto policy picked for this device.
+ *
+ */
+
+	/* The parent normally picks the method before the children are forked. */
+	if( c->method == NULL || c->method == &dwipe_auto ) { dwipe_method_select( c ); }
+
+	return c->method( c );
 
+} /* dwipe_auto */
+
+
+
+static int dwipe_runmethod_passes( DWIPE_METHOD_SIGNATURE, dwipe_pattern_t* patterns )
+{
+/**
+ * Runs each pass of the method over the whole device before starting the next one.
+ *
+ */
+
+	/* The result holder. */
+	int r;
+
+	/* An index variable. */
+	int i;
+
+	/* The zero-fill pattern for the final pass of most methods. */
+	dwipe_pattern_t pattern_zero = { 1, "\x00" };
 
 	/* Initialize the working round counter. */
 	c->round_working = 0;
 
 	dwipe_log( DWIPE_LOG_NOTICE, "Invoking method '%s' on device '%s'.", \
-	  dwipe_method_label( dwipe_options.method ), c->device_name );
+	  dwipe_method_label( c->method ), c->device_name );
 
 	while( c->round_working < c->round_count )
 	{
@@ -622,24 +623,7 @@ int dwipe_runmethod( DWIPE_METHOD_SIGNATURE, dwipe_pattern_t* patterns )
 				c->pass_type = DWIPE_PASS_WRITE;
 
 				/* Seed the PRNG. */
-				r = read( c->entropy_fd, c->prng_seed.s, c->prng_seed.length );
-	
-				/* Check the result. */
-				if( r < 0 )
-				{
-					c->pass_type = DWIPE_PASS_NONE;
-					dwipe_perror( errno, __FUNCTION__, "read" );
-					dwipe_log( DWIPE_LOG_FATAL, "Unable to seed the PRNG." );
-					return -1;
-				}
-	
-				/* Check for a partial read. */
-				if( r != c->prng_seed.length )
-				{
-					/* TODO: Handle partial reads. */
-					dwipe_log( DWIPE_LOG_FATAL, "Insufficient entropy is available." );
-					return -1;
-				}
+				dwipe_seed_pass( c, DWIPE_SEED_PASS, c->round_working, c->pass_working );
 	
 				/* Write the random pass. */
 				r = dwipe_random_pass( c );
@@ -662,7 +646,7 @@ int dwipe_runmethod( DWIPE_METHOD_SIGNATURE, dwipe_pattern_t* patterns )
 					if( r < 0 ) { return r; }
 
 					dwipe_log( DWIPE_LOG_NOTICE, "Verified pass %i of %i, round %i of %i, on device '%s'.", \
-			  		  c->pass_working, c->pass_count, c->round_working, c->round_count, dwipe_method_label( dwipe_options.method ) );
+			  		  c->pass_working, c->pass_count, c->round_working, c->round_count, c->device_name );
 				}
 	
 			} /* random pass */
@@ -678,7 +662,7 @@ int dwipe_runmethod( DWIPE_METHOD_SIGNATURE, dwipe_pattern_t* patterns )
 	} /* while rounds */
 
 
-	if( dwipe_options.method == &dwipe_ops2 )
+	if( c->method == &dwipe_ops2 )
 	{
 		/* NOTE: The OPS-II method specifically requires that a random pattern be left on the device. */
 
@@ -686,23 +670,7 @@ int dwipe_runmethod( DWIPE_METHOD_SIGNATURE, dwipe_pattern_t* patterns )
 		c->pass_type = DWIPE_PASS_FINAL_OPS2;
 
 		/* Seed the PRNG. */
-		r = read( c->entropy_fd, c->prng_seed.s, c->prng_seed.length );
-	
-		/* Check the result. */
-		if( r < 0 )
-		{
-			dwipe_perror( errno, __FUNCTION__, "read" );
-			dwipe_log( DWIPE_LOG_FATAL, "Unable to seed the PRNG." );
-			return -1;
-		}
-	
-		/* Check for a partial read. */
-		if( r != c->prng_seed.length )
-		{
-			/* TODO: Handle partial reads. */
-			dwipe_log( DWIPE_LOG_FATAL, "Insufficient entropy is available." );
-			return -1;
-		}
+		dwipe_seed_pass( c, DWIPE_SEED_FINAL, 0, 0 );
 	
 		dwipe_log( DWIPE_LOG_NOTICE, "Writing final random pattern to '%s'.", c->device_name );
 
@@ -737,8 +705,11 @@ int dwipe_runmethod( DWIPE_METHOD_SIGNATURE, dwipe_pattern_t* patterns )
 
 		dwipe_log( DWIPE_LOG_NOTICE, "Blanking device '%s'.", c->device_name );
 
-		/* The final zero pass. */
-		r = dwipe_static_pass( c, &pattern_zero );
+		/* The final zero pass, which the device runs itself when the plan offloads it. */
+		r = ( c->plan_flags & DWIPE_PLAN_ZEROOUT ) ? dwipe_zeroout_pass( c ) : 1;
+
+		/* Write the zeros when there is no offload or the device refused it. */
+		if( r > 0 ) { r = dwipe_static_pass( c, &pattern_zero ); }
 	
 		/* Check for a fatal error. */
 		if( r < 0 ) { return r; }
@@ -760,7 +731,391 @@ int dwipe_runmethod( DWIPE_METHOD_SIGNATURE, dwipe_pattern_t* patterns )
 		dwipe_log( DWIPE_LOG_NOTICE, "Blanked device '%s'.", c->device_name );
 
 	} /* final blank */
+
+	return 0;
+
+} /* dwipe_runmethod_passes */
+
+
+
+static int dwipe_chunk_pass( DWIPE_METHOD_SIGNATURE, dwipe_pass_t type, dwipe_pattern_t* pattern, int verify, u8* seed, void** states )
+{
+/**
+ * Writes and optionally verifies one pass over the current chunk.
+ *
+ * @parameter  type    The pass type that is shown to the parent while writing.
+ * @parameter  verify  Read the chunk back after writing it when set.
+ * @parameter  seed    The PRNG seed of a random pass.
+ * @parameter  states  The writer and verifier PRNG states of a random pass.
+ *
+ */
+
+	/* The result holder. */
+	int r;
+
+	c->pass_type = type;
+
+	if( pattern->length > 0 )
+	{
+		/* The device zeroes the chunk itself when the plan offloads the blank. */
+		r = ( type == DWIPE_PASS_FINAL_BLANK && c->plan_flags & DWIPE_PLAN_ZEROOUT ) ? dwipe_zeroout_pass( c ) : 1;
+
+		if( r > 0 ) { r = dwipe_static_pass( c, pattern ); }
+
+		if( r < 0 || ! verify ) { return r; }
+
+		if( type == DWIPE_PASS_WRITE ) { c->pass_type = DWIPE_PASS_VERIFY; }
+
+		return dwipe_static_verify( c, pattern );
+	}
+
+	/* A random pass keeps its own seed, and the writer and the verifier each */
+	/* keep their own position in the stream from one chunk to the next.     */
+	c->prng_seed.s = seed;
+
+	c->prng_state = states[0];
+	r = dwipe_random_pass( c );
+	states[0] = c->prng_state;
+
+	if( r < 0 || ! verify ) { return r; }
+
+	if( type == DWIPE_PASS_WRITE ) { c->pass_type = DWIPE_PASS_VERIFY; }
+
+	c->prng_state = states[1];
+	r = dwipe_random_verify( c );
+	states[1] = c->prng_state;
+
+	return r;
+
+} /* dwipe_chunk_pass */
+
+
+
+static int dwipe_runmethod_chunked( DWIPE_METHOD_SIGNATURE, dwipe_pattern_t* patterns )
+{
+/**
+ * Runs every pass of the method over one chunk of the device before moving to
+ * the next chunk, so that a multi-pass method streams the device only once.
+ *
+ */
+
+	/* The result holder. */
+	int r = 0;
+
+	/* Index variables. */
+	int i;
+	int j;
+	int k;
+
+	/* The number of random passes across all rounds, including the final ops2 pass. */
+	int randoms = 0;
+
+	/* The seeds and PRNG states of the random passes. */
+	u8* seeds;
+	void** states;
+
+	/* The seed buffer and PRNG state that belong to the context. */
+	u8* seed = c->prng_seed.s;
+	void* state = c->prng_state;
+
+	/* The number of chunks and the working chunk. */
+	u64 chunk_count = ( c->device_size + DWIPE_KNOB_CHUNK_SIZE - 1 ) / DWIPE_KNOB_CHUNK_SIZE;
+	u64 chunk_working = 0;
+
+	/* Set when the final pass should be verified. */
+	int verify_last = ( dwipe_options.verify == DWIPE_VERIFY_LAST || dwipe_options.verify == DWIPE_VERIFY_ALL );
+
+	/* The zero-fill pattern for the final pass of most methods. */
+	dwipe_pattern_t pattern_zero = { 1, "\x00" };
+
+	/* The random pattern for the final ops2 pass. */
+	dwipe_pattern_t pattern_random = { -1, "" };
+
+	/* The pattern and type of the final pass. */
+	dwipe_pattern_t* pattern_final = &pattern_zero;
+	dwipe_pass_t type_final = DWIPE_PASS_FINAL_BLANK;
+
+	if( c->method == &dwipe_ops2 )
+	{
+		/* NOTE: The OPS-II method specifically requires that a random pattern be left on the device. */
+		pattern_final = &pattern_random;
+		type_final = DWIPE_PASS_FINAL_OPS2;
+	}
+
+	/* Count the random passes. */
+	for( i = 0 ; i < c->pass_count ; i++ )
+	{
+		if( patterns[i].length < 0 ) { randoms += 1; }
+	}
+
+	randoms = randoms * c->round_count + ( pattern_final->length < 0 );
+
+	/* Every random pass is seeded up front because all of them are in flight at once. */
+	seeds = malloc( randoms * c->prng_seed.length + 1 );
+	states = calloc( randoms * 2 + 1, sizeof( void* ) );
+
+	/* Check the memory allocation. */
+	if( ! seeds || ! states )
+	{
+		dwipe_perror( errno, __FUNCTION__, "malloc" );
+		dwipe_log( DWIPE_LOG_FATAL, "Unable to allocate memory for the chunk seeds." );
+		return -1;
+	}
+
+	/* Derive the seeds in the order that the chunk loop numbers the random passes. */
+	for( k = 0, j = 1 ; j <= c->round_count ; j++ )
+	{
+		for( i = 0 ; i < c->pass_count ; i++ )
+		{
+			if( patterns[i].length < 0 )
+			{
+				c->prng_seed.s = seeds + k++ * c->prng_seed.length;
+				dwipe_seed_pass( c, DWIPE_SEED_PASS, j, i + 1 );
+			}
+		}
+	}
+
+	if( pattern_final->length < 0 )
+	{
+		c->prng_seed.s = seeds + k * c->prng_seed.length;
+		dwipe_seed_pass( c, DWIPE_SEED_FINAL, 0, 0 );
+	}
+
+	c->prng_seed.s = seed;
+
+	dwipe_log( DWIPE_LOG_NOTICE, "Running %i passes over %llu chunks of %llu bytes on device '%s'.", \
+	  c->pass_count * c->round_count + 1, chunk_count, (u64)DWIPE_KNOB_CHUNK_SIZE, c->device_name );
+
+	for( c->chunk_start = 0 ; c->chunk_start < c->device_size ; c->chunk_start += c->chunk_length )
+	{
+		chunk_working += 1;
+
+		c->chunk_length = c->device_size - c->chunk_start;
+
+		if( c->chunk_length > DWIPE_KNOB_CHUNK_SIZE ) { c->chunk_length = DWIPE_KNOB_CHUNK_SIZE; }
+
+		dwipe_log( DWIPE_LOG_DEBUG, "Starting chunk %llu of %llu on device '%s'.", \
+		  chunk_working, chunk_count, c->device_name );
+
+		/* The random passes are numbered in the same order for every chunk. */
+		k = 0;
+
+		for( c->round_working = 1 ; c->round_working <= c->round_count ; c->round_working++ )
+		{
+			for( i = 0 ; i < c->pass_count ; i++ )
+			{
+				c->pass_working = i + 1;
+
+				r = dwipe_chunk_pass( c, DWIPE_PASS_WRITE, &patterns[i], dwipe_options.verify == DWIPE_VERIFY_ALL, \
+				  seeds + k * c->prng_seed.length, &states[k * 2] );
+
+				if( patterns[i].length < 0 ) { k += 1; }
+
+				/* Check for a fatal error. */
+				if( r < 0 ) { break; }
+			}
+
+			if( r < 0 ) { break; }
+		}
+
+		/* Leave the working counters on the last round and pass. */
+		c->round_working = c->round_count;
+
+		if( r < 0 ) { break; }
+
+		/* The final pass. */
+		r = dwipe_chunk_pass( c, type_final, pattern_final, verify_last, \
+		  seeds + k * c->prng_seed.length, &states[k * 2] );
+
+		c->pass_type = DWIPE_PASS_NONE;
+
+		/* Check for a fatal error. */
+		if( r < 0 ) { break; }
+
+	} /* chunks */
+
+	/* Restore the context seed buffer and PRNG state. */
+	c->prng_seed.s = seed;
+	c->prng_state = state;
+
+	/* Release the PRNG states. */
+	for( k = 0 ; k < randoms * 2 ; k++ ) { free( states[k] ); }
+
+	free( states );
+	free( seeds );
+
+	/* Put the whole device back into a single chunk. */
+	c->chunk_start  = 0;
+	c->chunk_length = c->device_size;
+
+	if( r < 0 ) { return r; }
+
+	dwipe_log( DWIPE_LOG_NOTICE, "Finished %llu chunks on device '%s'.", chunk_count, c->device_name );
+
+	return 0;
+
+} /* dwipe_runmethod_chunked */
+
+
+
+int dwipe_method_visit( dwipe_method_t method, DWIPE_METHOD_SIGNATURE, dwipe_method_visitor_t visitor )
+{
+/**
+ * Runs a method only as far as building its pattern array, and hands the array to the visitor.
+ *
+ */
+
+	int r;
+
+	dwipe_runmethod_visitor = visitor;
+	r = method( c );
+	dwipe_runmethod_visitor = NULL;
+
+	return r;
+
+} /* dwipe_method_visit */
+
+
+
+int dwipe_runmethod( DWIPE_METHOD_SIGNATURE, dwipe_pattern_t* patterns )
+{
+/**
+ * Writes patterns to the device.
+ *
+ */
+
+	/* The result holder. */
+	int r;
+
+	/* An index variable. */
+	int i = 0;
+
+
+	if( dwipe_runmethod_visitor != NULL )
+	{
+		/* Only list the patterns. */
+		return dwipe_runmethod_visitor( c, patterns );
+	}
+
+	/* Create the PRNG state buffer. */
+	c->prng_seed.length = DWIPE_KNOB_PRNG_STATE_LENGTH;
+	c->prng_seed.s = malloc( c->prng_seed.length );
+
+	/* Check the memory allocation. */
+	if( ! c->prng_seed.s )
+	{
+		dwipe_perror( errno, __FUNCTION__, "malloc" );
+		dwipe_log( DWIPE_LOG_FATAL, "Unable to allocate memory for the prng seed buffer." );
+		return -1;
+	}
+
+	/* Prepare the i/o backend for this device. */
+	r = c->backend->open( c );
+
+	if( r < 0 )
+	{
+		dwipe_log( DWIPE_LOG_FATAL, "Unable to open the %s backend on '%s'.", c->backend->label, c->device_name );
+		return -1;
+	}
+
+	/* Count the number of patterns in the array. */
+	while( patterns[i].length ) { i += 1; }
+ 
+
+	/* Tell the parent the number of device passes that will be run in one round. */
+	c->pass_count = i;
+
+	/* Set the number of bytes that will be written across all passes in one round. */
+	c->pass_size = c->pass_count * c->device_size;
+
+	if( dwipe_options.verify == DWIPE_VERIFY_ALL )
+	{
+		/* We must read back all passes, so double the byte count. */
+		c->pass_size *= 2;
+	}
+
+
+	/* Tell the parent the number of rounds that will be run. */
+	c->round_count = dwipe_options.rounds;
+
+	/* Set the number of bytes that will be written across all rounds. */
+	c->round_size = c->round_count * c->pass_size;
+
+	/* The final pass is always a zero fill, except ops2 which is random. */
+	c->round_size += c->device_size;
+
+	if( dwipe_options.verify == DWIPE_VERIFY_LAST || dwipe_options.verify == DWIPE_VERIFY_ALL )
+	{
+		/* We must read back the last pass to verify it. */
+		c->round_size += c->device_size;
+	}
+
+
+	if( dwipe_options.prepass )
+	{
+		/* Make the device unusable before starting the long passes. */
+		c->pass_type = DWIPE_PASS_WRITE;
+		r = dwipe_metadata_pass( c );
+		c->pass_type = DWIPE_PASS_NONE;
+
+		/* Check for a fatal error. */
+		if( r < 0 ) { return r; }
+	}
+
+	if( c->plan_flags & DWIPE_PLAN_DISCARD )
+	{
+		/* Let the flash translation layer drop the stale copies that overwrites cannot reach. */
+		dwipe_log( DWIPE_LOG_NOTICE, "Discarding '%s' before the first pass.", c->device_name );
+
+		/* Tell our parent that the device is busy without moving the progress. */
+		c->offload_status = 1;
+
+		r = c->backend->discard( c, 0, c->device_size );
+
+		c->offload_status = 0;
+
+		if( r != 0 )
+		{
+			dwipe_perror( errno, __FUNCTION__, "discard" );
+			dwipe_log( DWIPE_LOG_WARNING, "Unable to discard '%s', so the passes run without it.", c->device_name );
+		}
+	}
+
+	/* The whole device is a single chunk unless chunk-major order is selected. */
+	c->chunk_start  = 0;
+	c->chunk_length = c->device_size;
+
+	if( dwipe_options.order == DWIPE_ORDER_CHUNK && c->zoned )
+	{
+		/* Every pass resets the zones, so a zoned device must be written one pass at a time. */
+		dwipe_log( DWIPE_LOG_WARNING, "Using pass order on zoned device '%s'.", c->device_name );
+		r = dwipe_runmethod_passes( c, patterns );
+	}
+
+	else if( dwipe_options.order == DWIPE_ORDER_CHUNK )
+	{
+		r = dwipe_runmethod_chunked( c, patterns );
+	}
+
+	else
+	{
+		r = dwipe_runmethod_passes( c, patterns );
+	}
+
+	/* Check for a fatal error. */
+	if( r < 0 ) { return r; }
+
+	if( c->bytes_skipped > 0 )
+	{
+		dwipe_log( DWIPE_LOG_NOTICE, "%llu bytes written and %llu bytes skipped on '%s'.", c->bytes_written, c->bytes_skipped, c->device_name );
+	}
 	
+	/* Release the i/o backend. */
+	c->backend->close( c );
+
+	/* Release the substream generators. */
+	dwipe_substream_free( c );
+
 	/* Release the state buffer. */
 	c->prng_seed.length = 0;
 	free( c->prng_seed.s );
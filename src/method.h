@@ -32,6 +32,12 @@ typedef enum dwipe_verify_t_
 	DWIPE_VERIFY_ALL,       /* Check all passes.                          */
 } dwipe_verify_t;
 
+typedef enum dwipe_order_t_
+{
+	DWIPE_ORDER_PASS = 0,   /* Run each pass over the whole device.       */
+	DWIPE_ORDER_CHUNK,      /* Run every pass over each chunk in turn.    */
+} dwipe_order_t;
+
 
 /* The typedef of the function that will do the wipe. */
 typedef int(*dwipe_method_t)( DWIPE_METHOD_SIGNATURE );
@@ -42,9 +48,19 @@ typedef struct /* dwipe_pattern_t */
 	char* s;       /* The actual bytes of the pattern.                  */
 } dwipe_pattern_t;
 
+/* Steps that an auto policy rule adds to the method, when the device offers the offload. */
+#define DWIPE_PLAN_DISCARD  0x01  /* Discard the whole device before the first pass.   */
+#define DWIPE_PLAN_ZEROOUT  0x02  /* Blank the device with the write-zeroes offload.    */
+
+/* A function that is handed the pattern array of a method instead of running it. */
+typedef int(*dwipe_method_visitor_t)( DWIPE_METHOD_SIGNATURE, dwipe_pattern_t* patterns );
+
 const char* dwipe_method_label( dwipe_method_t method );
+int dwipe_method_visit( dwipe_method_t method, DWIPE_METHOD_SIGNATURE, dwipe_method_visitor_t visitor );
 int dwipe_runmethod( DWIPE_METHOD_SIGNATURE, dwipe_pattern_t* patterns );
+void dwipe_method_select( DWIPE_METHOD_SIGNATURE );
 
+int dwipe_auto( DWIPE_METHOD_SIGNATURE );
 int dwipe_dod522022m( DWIPE_METHOD_SIGNATURE );
 int dwipe_dodshort( DWIPE_METHOD_SIGNATURE );
 int dwipe_gutmann( DWIPE_METHOD_SIGNATURE );
@@ -137,3 +137,58 @@ unsigned long twister_genrand_int32( twister_state_t* state )
 
     return y;
 }
+
+/* generates the next N numbers on [0,0xffffffff]-interval in one go */
+void twister_genrand_block( twister_state_t* state, uint32_t* out )
+{
+    unsigned long y;
+    int j;
+
+    next_state( state );
+
+    for( j = 0; j < N; j++ )
+    {
+        y = state->array[j];
+
+        /* Tempering */
+        y ^= (y >> 11);
+        y ^= (y << 7) & 0x9d2c5680UL;
+        y ^= (y << 15) & 0xefc60000UL;
+        y ^= (y >> 18);
+
+        out[j] = (uint32_t)y;
+    }
+
+    /* The next call to twister_genrand_int32() starts a new block. */
+    state->left = 1;
+}
+
+/* generates the same N numbers as twister_genrand_block, tempering two in each 64-bit word */
+void twister_genrand_block64( twister_state_t* state, uint64_t* out )
+{
+    uint64_t y;
+    int j;
+
+    next_state( state );
+
+    for( j = 0; j < N; j += 2 )
+    {
+        /* Pack the pair so that the bytes in memory match the 32-bit output. */
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        y = (uint64_t)state->array[j] << 32 | (uint32_t)state->array[j+1];
+#else
+        y = (uint64_t)state->array[j+1] << 32 | (uint32_t)state->array[j];
+#endif
+
+        /* Tempering, with the masks keeping the right shifts inside each half */
+        y ^= (y >> 11) & 0x001fffff001fffffULL;
+        y ^= (y << 7) & 0x9d2c56809d2c5680ULL;
+        y ^= (y << 15) & 0xefc60000efc60000ULL;
+        y ^= (y >> 18) & 0x00003fff00003fffULL;
+
+        out[j/2] = y;
+    }
+
+    /* The next call to twister_genrand_int32() starts a new block. */
+    state->left = 1;
+}
@@ -7,6 +7,8 @@
 #define MT19937AR_H_
 
 /* Period parameters */
+#include <stdint.h>
+
 #define N 624
 #define M 397
 #define MATRIX_A 0x9908b0dfUL   /* constant vector a */
@@ -29,4 +31,9 @@ void twister_init( twister_state_t* state, unsigned long init_key[], unsigned lo
 /* Generate a random integer on the [0,0xffffffff] interval. */
 unsigned long twister_genrand_int32( twister_state_t* state );
 
+void twister_genrand_block( twister_state_t* state, uint32_t* out );
+
+/* The same block as pairs in 64-bit words, for a buffer that is 64-bit aligned. */
+void twister_genrand_block64( twister_state_t* state, uint64_t* out );
+
 #endif /* MT19937AR_H_ */
@@ -89,3 +89,37 @@ int dwipe_notify_fail( void )
 
 	return 0;
 }
+
+int dwipe_notify_health( dwipe_context_t* c )
+{
+	char* address;
+	char* device;
+	int r;
+
+	if( dwipe_options.notify_health_url == NULL )
+	{
+		return 0;
+	}
+
+	/* Tell the receiver which device was flagged and why. */
+	device = curl_easy_escape( NULL, c->device_name, 0 );
+
+	if( device == NULL )
+	{
+		return -1;
+	}
+
+	if( asprintf( &address, "%s%cdevice=%s&health=%i", dwipe_options.notify_health_url, \
+	  strchr( dwipe_options.notify_health_url, '?' ) ? '&' : '?', device, c->health ) < 0 )
+	{
+		curl_free( device );
+		return -1;
+	}
+
+	r = dwipe_notify_curl( address );
+
+	free( address );
+	curl_free( device );
+
+	return r;
+}
@@ -36,3 +36,4 @@ int dwipe_notify_curl( char* address );
 int dwipe_notify_start( void );
 int dwipe_notify_success( void );
 int dwipe_notify_fail( void );
+int dwipe_notify_health( dwipe_context_t* c );
@@ -22,7 +22,10 @@
 #include "context.h"
 #include "method.h"
 #include "prng.h"
+#include "backend.h"
 #include "options.h"
+#include "substream.h"
+#include "cpu.h"
 #include "logging.h"
 #include <arpa/inet.h>
 
@@ -38,6 +41,15 @@ int dwipe_options_parse( int argc, char** argv )
 
 	extern dwipe_prng_t dwipe_twister;
 	extern dwipe_prng_t dwipe_isaac;
+	extern dwipe_prng_t dwipe_sfmt;
+	extern dwipe_prng_t dwipe_aes_ctr;
+	extern dwipe_prng_t dwipe_chacha20;
+	extern dwipe_prng_t dwipe_xoshiro;
+	extern dwipe_prng_t dwipe_philox;
+
+	extern dwipe_backend_t dwipe_backend_posix;
+	extern dwipe_backend_t dwipe_backend_mmap;
+	extern dwipe_backend_t dwipe_backend_null;
 
 	/* The maximum banner size, including the null. */
 	const int dwipe_banner_size = 81;
@@ -60,21 +72,57 @@ int dwipe_options_parse( int argc, char** argv )
 		/* A GNU standard option. Corresponds to the 'h' short option. */
 		{ "help", no_argument, 0, 'h' },
 
+		/* The highest vector instruction set that the kernels may use. */
+		{ "cpu", required_argument, 0, 0 },
+
 		/* The wipe method. Corresponds to the 'm' short option. */
 		{ "method", required_argument, 0, 'm' },
 
+		/* The memory that the buffers and dirty data of all devices may use. */
+		{ "mem-budget", required_argument, 0, 0 },
+
+		/* Run the passes device by device or chunk by chunk. */
+		{ "order", required_argument, 0, 0 },
+
+		/* Do not overwrite the partition tables and superblocks before the first pass. */
+		{ "no-prepass", no_argument, 0, 0 },
+
+		/* Estimate the session time of each device without writing anything. */
+		{ "plan", no_argument, 0, 0 },
+
 		/* The Pseudo Random Number Generator. */
 		{ "prng", required_argument, 0, 'p' },
 
+		/* The number of threads that generate each random pass in substreams. */
+		{ "prng-threads", required_argument, 0, 0 },
+
+		/* The i/o backend that the passes use to reach the device. */
+		{ "io", required_argument, 0, 0 },
+
 		/* The number of times to run the method. */
 		{ "rounds", required_argument, 0, 'r' },
 
+		/* Keep the master seed in this file so that the wipe can be regenerated. */
+		{ "seed-file", required_argument, 0, 0 },
+
+		/* Only wipe the allocated extents of sparse regular files. */
+		{ "sparse", no_argument, 0, 0 },
+
+		/* Read each block first and skip writing blocks that already hold the pattern. */
+		{ "skip-matching", no_argument, 0, 0 },
+
+		/* Generate the random stream once and give every device the same data. */
+		{ "shared-stream", no_argument, 0, 0 },
+
 		/* A flag to indicate whether the devices whould be opened in sync mode. */
 		{ "sync", no_argument, 0, 0 },
 
 		/* Verify that wipe patterns are being written to the device. */
 		{ "verify", required_argument, 0, 0 },
 
+		/* Log the offset of every verification mismatch. */
+		{ "verify-offsets", no_argument, 0, 0 },
+
 		/* The path were to write dban log. */
 		{ "log", required_argument, 0, 0 },
 
@@ -102,6 +150,15 @@ int dwipe_options_parse( int argc, char** argv )
 		/* The url to call when wiping fails */
 		{ "notify-fail", required_argument, 0, 0 },
 
+		/* The url to call when a device is flagged as slow or stalled */
+		{ "notify-health", required_argument, 0, 0 },
+
+		/* Kill the wipe of a device that is flagged as slow or stalled. */
+		{ "abort-unhealthy", no_argument, 0, 0 },
+
+		/* Allow an i/o backend that does not write to run on block devices. */
+		{ "benchmark", no_argument, 0, 0 },
+
 		/* Requisite padding for getopt(). */
 		{ 0, 0, 0, 0 }
 	};
@@ -123,12 +180,26 @@ int dwipe_options_parse( int argc, char** argv )
 
 
 	/* Set default options. */
+	dwipe_options.abort_unhealthy = 0;
+	dwipe_options.benchmark     = 0;
 	dwipe_options.autonuke      = 0;
+	dwipe_options.backend       = &dwipe_backend_posix;
+	dwipe_options.cpu           = DWIPE_CPU_AVX512;
+	dwipe_options.mem_budget    = 0;
 	dwipe_options.method        = &dwipe_dodshort;
-	dwipe_options.prng          = &dwipe_twister;
+	dwipe_options.order         = DWIPE_ORDER_PASS;
+	dwipe_options.prepass       = 1;
+	dwipe_options.plan          = 0;
+	dwipe_options.prng          = NULL;
+	dwipe_options.prng_threads  = 0;
 	dwipe_options.rounds        = 1;
+	dwipe_options.seed_file     = NULL;
+	dwipe_options.skip_matching = 0;
+	dwipe_options.shared_stream = 0;
+	dwipe_options.sparse        = 0;
 	dwipe_options.sync          = 0;
 	dwipe_options.verify        = DWIPE_VERIFY_LAST;
+	dwipe_options.verify_offsets = 0;
         dwipe_options.logfile       = "/var/log/dban/dwipe.txt";
 	dwipe_options.web_enabled   = 0;
 	dwipe_options.web_port      = 9595;
@@ -155,6 +226,128 @@ int dwipe_options_parse( int argc, char** argv )
 					break;
 				}
 
+				if( strcmp( dwipe_options_long[i].name, "io" ) == 0 )
+				{
+					if( strcmp( optarg, "posix" ) == 0 )
+					{
+						dwipe_options.backend = &dwipe_backend_posix;
+						break;
+					}
+
+					if( strcmp( optarg, "mmap" ) == 0 )
+					{
+						dwipe_options.backend = &dwipe_backend_mmap;
+						break;
+					}
+
+					if( strcmp( optarg, "null" ) == 0 )
+					{
+						dwipe_options.backend = &dwipe_backend_null;
+						break;
+					}
+
+					fprintf( stderr, "Error: Unknown i/o backend '%s'.\n", optarg );
+					exit( EINVAL );
+				}
+
+				if( strcmp( dwipe_options_long[i].name, "mem-budget" ) == 0 )
+				{
+					/* The budget is given in MiB. */
+					if( sscanf( optarg, " %llu", &dwipe_options.mem_budget ) != 1 || dwipe_options.mem_budget < 1 )
+					{
+						fprintf( stderr, "Error: The mem-budget argument must be a positive number of MiB.\n" );
+						exit( EINVAL );
+					}
+
+					dwipe_options.mem_budget *= 1048576;
+					break;
+				}
+
+				if( strcmp( dwipe_options_long[i].name, "cpu" ) == 0 )
+				{
+					dwipe_options.cpu = dwipe_cpu_parse( optarg );
+
+					if( dwipe_options.cpu < 0 )
+					{
+						fprintf( stderr, "Error: The cpu argument must be generic, sse2, avx2 or avx512.\n" );
+						exit( EINVAL );
+					}
+
+					break;
+				}
+
+				if( strcmp( dwipe_options_long[i].name, "seed-file" ) == 0 )
+				{
+					dwipe_options.seed_file = optarg;
+					break;
+				}
+
+				if( strcmp( dwipe_options_long[i].name, "prng-threads" ) == 0 )
+				{
+					if( sscanf( optarg, " %i", &dwipe_options.prng_threads ) != 1 \
+					  || dwipe_options.prng_threads < 0 || dwipe_options.prng_threads > DWIPE_KNOB_SUBSTREAM_THREADS )
+					{
+						fprintf( stderr, "Error: The prng-threads argument must be between 0 and %i.\n", DWIPE_KNOB_SUBSTREAM_THREADS );
+						exit( EINVAL );
+					}
+
+					break;
+				}
+
+				if( strcmp( dwipe_options_long[i].name, "order" ) == 0 )
+				{
+					if( strcmp( optarg, "pass" ) == 0 )
+					{
+						dwipe_options.order = DWIPE_ORDER_PASS;
+						break;
+					}
+
+					if( strcmp( optarg, "chunk" ) == 0 )
+					{
+						dwipe_options.order = DWIPE_ORDER_CHUNK;
+						break;
+					}
+
+					fprintf( stderr, "Error: Unknown pass order '%s'.\n", optarg );
+					exit( EINVAL );
+				}
+
+				if( strcmp( dwipe_options_long[i].name, "no-prepass" ) == 0 )
+				{
+					dwipe_options.prepass = 0;
+					break;
+				}
+
+				if( strcmp( dwipe_options_long[i].name, "plan" ) == 0 )
+				{
+					dwipe_options.plan = 1;
+					break;
+				}
+
+				if( strcmp( dwipe_options_long[i].name, "sparse" ) == 0 )
+				{
+					dwipe_options.sparse = 1;
+					break;
+				}
+
+				if( strcmp( dwipe_options_long[i].name, "verify-offsets" ) == 0 )
+				{
+					dwipe_options.verify_offsets = 1;
+					break;
+				}
+
+				if( strcmp( dwipe_options_long[i].name, "shared-stream" ) == 0 )
+				{
+					dwipe_options.shared_stream = 1;
+					break;
+				}
+
+				if( strcmp( dwipe_options_long[i].name, "skip-matching" ) == 0 )
+				{
+					dwipe_options.skip_matching = 1;
+					break;
+				}
+
 				if( strcmp( dwipe_options_long[i].name, "sync" ) == 0 )
 				{
 					dwipe_options.sync = 1;
@@ -268,8 +461,33 @@ int dwipe_options_parse( int argc, char** argv )
 					break;
 				}
 
+				if( strcmp( dwipe_options_long[i].name, "notify-health" ) == 0 )
+				{
+					dwipe_options.notify_health_url = optarg;
+					break;
+				}
+
+				if( strcmp( dwipe_options_long[i].name, "benchmark" ) == 0 )
+				{
+					dwipe_options.benchmark = 1;
+					break;
+				}
+
+				if( strcmp( dwipe_options_long[i].name, "abort-unhealthy" ) == 0 )
+				{
+					dwipe_options.abort_unhealthy = 1;
+					break;
+				}
+
 			case 'm':  /* Method option. */
 
+				if( strcmp( optarg, "auto" ) == 0 )
+				{
+					/* Each device gets the method of the first policy rule that matches its media. */
+					dwipe_options.method = &dwipe_auto;
+					break;
+				}
+
 				if( strcmp( optarg, "dod522022m" ) == 0 || strcmp( optarg, "dod" ) == 0 )
 				{
 					dwipe_options.method = &dwipe_dod522022m;
@@ -330,6 +548,44 @@ int dwipe_options_parse( int argc, char** argv )
 					break;
 				}
 
+				if( strcmp( optarg, "sfmt" ) == 0 )
+				{
+					dwipe_options.prng = &dwipe_sfmt;
+					break;
+				}
+
+				if(  strcmp( optarg, "aes"     ) == 0
+				  || strcmp( optarg, "aes-ctr" ) == 0
+				  )
+				{
+					dwipe_options.prng = &dwipe_aes_ctr;
+					break;
+				}
+
+				if(  strcmp( optarg, "chacha"   ) == 0
+				  || strcmp( optarg, "chacha20" ) == 0
+				  )
+				{
+					dwipe_options.prng = &dwipe_chacha20;
+					break;
+				}
+
+				if(  strcmp( optarg, "xoshiro"       ) == 0
+				  || strcmp( optarg, "xoshiro256pp" ) == 0
+				  )
+				{
+					dwipe_options.prng = &dwipe_xoshiro;
+					break;
+				}
+
+				if(  strcmp( optarg, "philox"       ) == 0
+				  || strcmp( optarg, "philox4x32"   ) == 0
+				  )
+				{
+					dwipe_options.prng = &dwipe_philox;
+					break;
+				}
+
 				/* Else we do not know this PRNG. */
 				fprintf( stderr, "Error: Unknown prng '%s'.\n", optarg );
 				exit( EINVAL );
@@ -365,6 +621,35 @@ int dwipe_options_parse( int argc, char** argv )
 		exit( EINVAL );
 	}
 
+	if( dwipe_options.shared_stream && dwipe_options.order == DWIPE_ORDER_CHUNK )
+	{
+		/* Chunk order keeps every random pass in flight at once, but the ring holds one. */
+		fprintf( stderr, "Error: the shared random stream cannot be used with chunk order.\n" );
+		exit( EINVAL );
+	}
+
+	if( dwipe_options.shared_stream && dwipe_options.method == &dwipe_auto )
+	{
+		/* A device whose random pass comes later would hold back the ring for all others. */
+		fprintf( stderr, "Error: the shared random stream cannot be used with the auto method.\n" );
+		exit( EINVAL );
+	}
+
+	if( dwipe_options.shared_stream && dwipe_options.prng_threads > 0 )
+	{
+		/* The shared stream is a single sequence from the generator process. */
+		fprintf( stderr, "Error: the shared random stream cannot be used with prng threads.\n" );
+		exit( EINVAL );
+	}
+
+	/* Pick the kernels before the default PRNG, which depends on what the kernels may use. */
+	dwipe_cpu_dispatch( dwipe_options.cpu );
+
+	if( dwipe_options.prng == NULL )
+	{
+		dwipe_options.prng = dwipe_prng_default();
+	}
+
 	dwipe_options_log();
 
 	/* Return the number of options that were processed. */
@@ -393,9 +678,25 @@ void dwipe_options_log( void )
 	}
 
 
+	dwipe_log( DWIPE_LOG_NOTICE, "  abort-sick = %i", dwipe_options.abort_unhealthy );
+	dwipe_log( DWIPE_LOG_NOTICE, "  benchmark  = %i", dwipe_options.benchmark );
 	dwipe_log( DWIPE_LOG_NOTICE, "  banner     = %s", dwipe_options.banner );
+	dwipe_log( DWIPE_LOG_NOTICE, "  cpu        = %s (detected %s)", dwipe_cpu_label( dwipe_cpu_level() ), dwipe_cpu_label( dwipe_cpu_detect() ) );
+	dwipe_log( DWIPE_LOG_NOTICE, "  kernels    = %s (zero check, compare, pattern fill)", dwipe_cpu_label( dwipe_kernels.level ) );
+	dwipe_log( DWIPE_LOG_NOTICE, "  io         = %s", dwipe_options.backend->label );
+	dwipe_log( DWIPE_LOG_NOTICE, "  mem-budget = %llu", dwipe_options.mem_budget );
 	dwipe_log( DWIPE_LOG_NOTICE, "  method     = %s", dwipe_method_label( dwipe_options.method ) );
+	dwipe_log( DWIPE_LOG_NOTICE, "  order      = %s", dwipe_options.order == DWIPE_ORDER_CHUNK ? "chunk" : "pass" );
+	dwipe_log( DWIPE_LOG_NOTICE, "  plan       = %i", dwipe_options.plan );
+	dwipe_log( DWIPE_LOG_NOTICE, "  prepass    = %i", dwipe_options.prepass );
+	dwipe_log( DWIPE_LOG_NOTICE, "  prng       = %s", dwipe_options.prng->label );
+	dwipe_log( DWIPE_LOG_NOTICE, "  prng-kern  = %s", dwipe_prng_variant( dwipe_options.prng ) );
+	dwipe_log( DWIPE_LOG_NOTICE, "  prng-thrds = %i", dwipe_options.prng_threads );
 	dwipe_log( DWIPE_LOG_NOTICE, "  rounds     = %i", dwipe_options.rounds );
+	dwipe_log( DWIPE_LOG_NOTICE, "  seed-file  = %s", dwipe_options.seed_file ? dwipe_options.seed_file : "(none)" );
+	dwipe_log( DWIPE_LOG_NOTICE, "  shared     = %i", dwipe_options.shared_stream );
+	dwipe_log( DWIPE_LOG_NOTICE, "  skip-match = %i", dwipe_options.skip_matching );
+	dwipe_log( DWIPE_LOG_NOTICE, "  sparse     = %i", dwipe_options.sparse );
 	dwipe_log( DWIPE_LOG_NOTICE, "  sync       = %i", dwipe_options.sync );
 
 	switch( dwipe_options.verify )
@@ -417,6 +718,8 @@ void dwipe_options_log( void )
 			break;
 	}
 
+	dwipe_log( DWIPE_LOG_NOTICE, "  verify-off = %i", dwipe_options.verify_offsets );
+
 	dwipe_log( DWIPE_LOG_NOTICE, "  log        = %s", dwipe_options.logfile );
 	dwipe_log( DWIPE_LOG_NOTICE, "  web        = %i", dwipe_options.web_enabled );
 	dwipe_log( DWIPE_LOG_NOTICE, "  web-port   = %i", dwipe_options.web_port );
@@ -23,10 +23,16 @@
 #define OPTIONS_H_
 
 /* Program knobs. */
+#define DWIPE_KNOB_CHUNK_SIZE             268435456           /* 256 MiB per chunk in chunk-major order. */
+#define DWIPE_KNOB_BUFFER_ALIGN           65536               /* Pass buffers are a multiple of this.    */
+#define DWIPE_KNOB_BUFFER_MIN             65536
+#define DWIPE_KNOB_BUFFER_MAX             16777216
 #define DWIPE_KNOB_ENTROPY                "/dev/urandom"
 #define DWIPE_KNOB_IDENTITY_SIZE          512
 #define DWIPE_KNOB_LABEL_SIZE             128
 #define DWIPE_KNOB_LOADAVG                "/proc/loadavg"
+#define DWIPE_KNOB_MEMINFO                "/proc/meminfo"
+#define DWIPE_KNOB_MEM_BUDGET_PERCENT     50                  /* Of MemAvailable, when no budget is given. */
 #define DWIPE_KNOB_LOG_BUFFERSIZE         1024                /* Maximum length of a log event. */
 #define DWIPE_KNOB_PARTITIONS             "/proc/partitions"
 #define DWIPE_KNOB_PARTITIONS_PREFIX      "/dev/"
@@ -34,6 +40,8 @@
 #define DWIPE_KNOB_SCSI                   "/proc/scsi/scsi"
 #define DWIPE_KNOB_SLEEP                  1
 #define DWIPE_KNOB_STAT                   "/proc/stat"
+#define DWIPE_KNOB_VERIFY_TILE            32768               /* Fits in L1/L2; a multiple of the PRNG word size. */
+#define DWIPE_KNOB_ZEROOUT_STEP           268435456           /* Bytes per write-zeroes request, for progress. */
 
 /* Function prototypes for loading options from the environment and command line. */
 int dwipe_options_parse( int argc, char** argv );
@@ -41,13 +49,27 @@ void dwipe_options_log( void );
 
 typedef struct /* dwipe_options_t */
 {
+	int             abort_unhealthy;      /* Kill the wipe of a device that is flagged as unhealthy.     */
 	int             autonuke;             /* Do not prompt the user for confirmation when set.           */
+	dwipe_backend_t* backend;             /* The i/o backend that the passes use to reach the device.    */
+	int             benchmark;            /* Allow a backend that does not write to run on block devices. */
 	char*           banner;               /* The product banner shown on the top line of the screen.     */
+	int             cpu;                  /* The highest DWIPE_CPU_* level that the kernels may use.     */
 	dwipe_method_t  method;               /* A function pointer to the wipe method that will be used.    */
+	dwipe_order_t   order;                /* Whether passes run over the whole device or chunk by chunk. */
+	int             plan;                 /* Only estimate the session time of each device.              */
+	int             prepass;              /* Overwrite the partition tables and superblocks first.       */
 	dwipe_prng_t*   prng;                 /* The pseudo random number generator implementation.          */
+	int             prng_threads;         /* The substream generator threads per device, or 0 for none.  */
 	int             rounds;               /* The number of times that the wipe method should be called.  */
+	char*           seed_file;            /* The file that keeps the master seed, or NULL for none.      */
+	int             sparse;               /* Only wipe the allocated extents of sparse regular files.    */
+	int             skip_matching;        /* Read each block first and only write blocks that differ.    */
+	int             shared_stream;        /* Generate the random stream once and share it across devices.*/
 	int             sync;                 /* A flag to indicate whether writes should be sync'd.         */
 	dwipe_verify_t  verify;               /* A flag to indicate whether writes should be verified.       */
+	int             verify_offsets;       /* Log the device offset of every verification mismatch.       */
+	u64             mem_budget;           /* The memory in bytes that all devices share, or 0 for auto.  */
 	char*           logfile;              /* The dban log file.                                          */
 	int             web_enabled;          /* Specify whether to enable the web server functionality.     */
         int             web_port;             /* Specify the web server port                                 */
@@ -56,6 +78,7 @@ typedef struct /* dwipe_options_t */
         char*           web_auth_pass;        /* The password for accessing the web server (HTTP Basic Auth) */
 	char*           notify_success_url;   /* The url to call after successful completion                 */
 	char*           notify_fail_url;      /* The url to call in case of failure                          */
+	char*           notify_health_url;    /* The url to call when a device is flagged as unhealthy       */
 	char*           notify_start_url;     /* The url to call when wiping actually starts                 */
 } dwipe_options_t;
 
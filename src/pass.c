@@ -24,8 +24,159 @@
 #include "prng.h"
 #include "options.h"
 #include "pass.h"
+#include "backend.h"
+#include "stream.h"
+#include "substream.h"
+#include "zone.h"
+#include "health.h"
+#include "profile.h"
+#include "cpu.h"
+#include "tile.h"
 #include "logging.h"
 
+#include <sys/mman.h>
+
+
+
+void* dwipe_buffer_alloc( dwipe_context_t* c, size_t size )
+{
+/**
+ * Allocates a pass buffer and locks it into memory so that it is never swapped.
+ *
+ */
+
+	/* Set after the first locking failure, which is only logged once. */
+	static int warned = 0;
+
+	void* b;
+	int r;
+
+	/* posix_memalign returns the error instead of setting errno, which the callers report. */
+	r = posix_memalign( &b, 4096, size );
+
+	if( r != 0 )
+	{
+		errno = r;
+		return NULL;
+	}
+
+	if( mlock( b, size ) != 0 && ! warned )
+	{
+		warned = 1;
+		dwipe_perror( errno, __FUNCTION__, "mlock" );
+		dwipe_log( DWIPE_LOG_WARNING, "Unable to lock the buffers of '%s' into memory.", c->device_name );
+	}
+
+	return b;
+
+} /* dwipe_buffer_alloc */
+
+
+
+/* Sparse files and zoned devices have ranges that the passes skip. */
+#define DWIPE_PASS_HOLES( c ) ( dwipe_options.sparse || (c)->zoned )
+
+static loff_t dwipe_sparse_next( dwipe_context_t* c, loff_t offset, u64 z, u64* e )
+{
+/**
+ * Finds the next allocated extent of a sparse target with SEEK_DATA and SEEK_HOLE.
+ *
+ * @parameter offset  The current device offset.
+ * @parameter z       The number of bytes remaining in this chunk of the pass.
+ * @modifies  e       The length of the allocated extent that starts after the hole.
+ * @returns           The number of hole bytes to skip.
+ *
+ */
+
+	/* The start of the next allocated extent. */
+	loff_t data;
+
+	/* The end of the next allocated extent. */
+	loff_t hole;
+
+	if( c->zoned )
+	{
+		/* Skip the unwritable tail of each zone. */
+		return dwipe_zone_next( c, offset, z, e );
+	}
+
+	if( ! S_ISREG( c->device_stat.st_mode ) )
+	{
+		/* Block devices do not have holes. */
+		*e = z;
+		return 0;
+	}
+
+	data = lseek( c->device_fd, offset, SEEK_DATA );
+
+	if( data == (loff_t)-1 )
+	{
+		if( errno == ENXIO )
+		{
+			/* There is no more data in the file. */
+			*e = 0;
+			return z;
+		}
+
+		/* The filesystem cannot report holes, so treat everything as data. */
+		data = offset;
+		hole = c->device_size;
+	}
+
+	else
+	{
+		hole = lseek( c->device_fd, data, SEEK_HOLE );
+
+		if( hole == (loff_t)-1 || hole > c->device_size )
+		{
+			hole = c->device_size;
+		}
+	}
+
+	if( data - offset >= z )
+	{
+		/* The hole runs past the end of this chunk. */
+		*e = 0;
+		return z;
+	}
+
+	*e = hole - data;
+	return data - offset;
+
+} /* dwipe_sparse_next */
+
+
+static void dwipe_verify_report( dwipe_context_t* c, const char* b, const char* d, size_t n, loff_t offset )
+{
+/**
+ * Logs the device offset of each mismatching byte run in a compared range.
+ *
+ * @parameter  b       The data that was read from the device.
+ * @parameter  d       The data that was expected.
+ * @parameter  n       The length of the range.
+ * @parameter  offset  The device offset of the range.
+ *
+ */
+
+	size_t i = 0;
+	size_t j;
+
+	while( i < n )
+	{
+		if( b[i] == d[i] ) { i += 1; continue; }
+
+		/* Find the end of this run of bad bytes. */
+		for( j = i + 1 ; j < n && b[j] != d[j] ; j++ );
+
+		dwipe_log( DWIPE_LOG_ERROR, "Verification mismatch at offset %llu, %llu bytes, on '%s'.",
+		  (u64)( offset + i ), (u64)( j - i ), c->device_name );
+
+		i = j;
+	}
+
+} /* dwipe_verify_report */
+
+
 
 int dwipe_random_verify( dwipe_context_t* c )
 {
@@ -37,20 +188,39 @@ int dwipe_random_verify( dwipe_context_t* c )
 	/* The result holder. */
 	int r;
 
+	/* The start time of the last request. */
+	u64 t;
+
 	/* The IO size. */
 	size_t blocksize;
 
-	/* The result buffer for calls to lseek. */
-	loff_t offset;
+	/* The device offset of the current block. */
+	loff_t offset = c->chunk_start;
 
 	/* The input buffer. */
 	char* b;
 
-	/* The pattern buffer that is used to check the input buffer. */
+	/* The pattern tile that is used to check the input buffer. */
 	char* d;
 
-	/* The number of bytes remaining in the pass. */
-	u64 z = c->device_size;
+	/* A pointer into the pattern buffer. */
+	char* q;
+
+	/* The offset and length of the current tile within the block. */
+	size_t k;
+	size_t n;
+
+	/* Set after the first mismatch in the current block. */
+	int bad;
+
+	/* The number of bytes remaining in this chunk of the pass. */
+	u64 z = c->chunk_length;
+
+	/* The number of bytes remaining in the current allocated extent. */
+	u64 e = 0;
+
+	/* The size of a hole that is skipped in sparse mode. */
+	loff_t h;
 
 
 	if( c->prng_seed.s == NULL )
@@ -65,8 +235,14 @@ int dwipe_random_verify( dwipe_context_t* c )
 		return -1;
 	}
 
+	if( ! ( c->backend->caps & DWIPE_BACKEND_CAP_READ ) )
+	{
+		dwipe_log( DWIPE_LOG_NOTICE, "The %s backend cannot read back '%s', so it is not verified.", c->backend->label, c->device_name );
+		return 0;
+	}
+
 	/* Create the input buffer. */
-	b = malloc( c->device_stat.st_blksize * 1024 );
+	b = dwipe_buffer_alloc( c, c->buffer_size );
 
 	/* Check the memory allocation. */
 	if( ! b )
@@ -76,8 +252,9 @@ int dwipe_random_verify( dwipe_context_t* c )
 		return -1;
 	}
 
-	/* Create the pattern buffer */
-	d = malloc( c->device_stat.st_blksize * 1024  );
+	/* Create the pattern tile, which is small enough to stay in the cache, or a */
+	/* whole pattern block when the substreams regenerate each block at once.   */
+	d = dwipe_buffer_alloc( c, dwipe_options.prng_threads > 0 ? c->buffer_size : DWIPE_KNOB_VERIFY_TILE );
 
 	/* Check the memory allocation. */
 	if( ! d )
@@ -87,28 +264,11 @@ int dwipe_random_verify( dwipe_context_t* c )
 		return -1;
 	}
 
-	/* Reset the file pointer. */
-	offset = lseek( c->device_fd, 0, SEEK_SET );
-
-	if( offset == (loff_t)-1 )
-	{
-		dwipe_perror( errno, __FUNCTION__, "lseek" );
-		dwipe_log( DWIPE_LOG_FATAL, "Unable to reset the '%s' file offset.", c->device_name );
-		return -1;
-	}
-
-	if( offset != 0 )
-	{
-		/* This is system insanity. */
-		dwipe_log( DWIPE_LOG_SANITY, "lseek() returned a bogus offset on '%s'.", c->device_name );
-		return -1;
-	}
-
 	/* Tell our parent that we are syncing the device. */
 	c->sync_status = 1;
 
 	/* Sync the device. */
-	r = fdatasync( c->device_fd );
+	r = c->backend->flush( c );
 
 	/* Tell our parent that we have finished syncing the device. */
 	c->sync_status = 0;
@@ -116,34 +276,60 @@ int dwipe_random_verify( dwipe_context_t* c )
 	if( r != 0 )
 	{
 		/* FIXME: Is there a better way to handle this? */
-		dwipe_perror( errno, __FUNCTION__, "fdatasync" );
+		dwipe_perror( errno, __FUNCTION__, "flush" );
 		dwipe_log( DWIPE_LOG_WARNING, "Buffer flush failure on '%s'.", c->device_name );
 	}
 
-	/* Reseed the PRNG. */
-	c->prng->init( &c->prng_state, &c->prng_seed );
+	if( c->chunk_start == 0 && dwipe_options.prng_threads == 0 )
+	{
+		/* Reseed the PRNG, which otherwise continues from the previous chunk. */
+		c->prng->init( &c->prng_state, &c->prng_seed );
+	}
 
 	while( z > 0 )
 	{
-		if( c->device_stat.st_blksize * 1024 < z )
+		if( DWIPE_PASS_HOLES( c ) && e == 0 )
+		{
+			/* Skip to the next allocated extent. */
+			h = dwipe_sparse_next( c, offset, z, &e );
+
+			/* Holes count as done. */
+			offset += h;
+			z -= h;
+			c->round_done += h;
+			c->pass_done += h;
+
+			if( z == 0 ) { break; }
+		}
+
+		if( c->buffer_size <= z )
 		{
-			blocksize = c->device_stat.st_blksize * 1024;
+			blocksize = c->buffer_size;
 		}
 		else
 		{
-			/* This is a seatbelt for buggy drivers and programming errors because */
-			/* the device size should always be an even multiple of its blocksize. */
+			/* The last block of the device can be short. This is a seatbelt for buggy */
+			/* drivers and programming errors because it is always whole sectors.     */
 			blocksize = z;
-			dwipe_log( DWIPE_LOG_WARNING,
-			  "%s: The size of '%s' is not a multiple of its block size %i.",
-			  __FUNCTION__, c->device_name, c->device_stat.st_blksize );
+
+			if( c->sector_size > 0 && z % c->sector_size != 0 )
+			{
+				dwipe_log( DWIPE_LOG_WARNING,
+				  "%s: The size of '%s' is not a multiple of its sector size %i.",
+				  __FUNCTION__, c->device_name, c->sector_size );
+			}
 		}
 
-		/* Fill the output buffer with the random pattern. */
-		c->prng->read( &c->prng_state, d, blocksize );
+		if( DWIPE_PASS_HOLES( c ) && blocksize > e )
+		{
+			/* Stop at the end of the allocated extent. */
+			blocksize = e;
+		}
 
 		/* Read the buffer in from the device. */
-		r = read( c->device_fd, b, blocksize );
+		t = dwipe_health_clock();
+		r = c->backend->read( c, b, blocksize, offset );
+		dwipe_health_latency( c, t, r );
 
 		/* Check the result. */
 		if( r < 0 )
@@ -166,27 +352,77 @@ int dwipe_random_verify( dwipe_context_t* c )
 			/* Increment the error count. */
 			c->verify_errors += 1;
 
-			/* Bump the file pointer to the next block. */
-			offset = lseek( c->device_fd, s, SEEK_CUR );
+		} /* partial read */
+
+		/* A short block is already counted, so its contents are not compared. */
+		bad = ( r != blocksize );
 
-			if( offset == (loff_t)-1 )
+		if( dwipe_options.prng_threads > 0 )
+		{
+			/* Regenerate the block with the same substreams as the writer. */
+			if( dwipe_substream_fill( c, d, blocksize, offset ) < 0 ) { return -1; }
+		}
+
+		else if( c->prng->flags & DWIPE_PRNG_SEEKABLE )
+		{
+			/* A counter-based PRNG starts each block at its own offset, so no block depends on another. */
+			c->prng->seek( &c->prng_state, offset );
+		}
+
+		for( k = 0 ; k < blocksize ; k += n )
+		{
+			n = blocksize - k;
+
+			if( n > DWIPE_KNOB_VERIFY_TILE ) { n = DWIPE_KNOB_VERIFY_TILE; }
+
+			if( dwipe_options.prng_threads > 0 )
 			{
-				dwipe_perror( errno, __FUNCTION__, "lseek" );
-				dwipe_log( DWIPE_LOG_ERROR, "Unable to bump the '%s' file offset after a partial read.", c->device_name );
-				return -1;
+				q = &d[k];
 			}
 
-		} /* partial read */
+			else
+			{
+				/* Regenerate the next tile of the stream. The whole block is */
+				/* always generated so that the stream stays aligned with the   */
+				/* writer, which filled it with a single read of the same size. */
+				dwipe_prng_fill( c->prng, &c->prng_state, d, n );
+				q = d;
+			}
+
+			/* Stop comparing after the first mismatch unless the offsets are wanted. */
+			if( bad && ! dwipe_options.verify_offsets ) { continue; }
+
+			if( r == blocksize && ! dwipe_kernels.equal( &b[k], q, n ) )
+			{
+				if( ! bad ) { c->verify_errors += 1; }
+				bad = 1;
+
+				if( dwipe_options.verify_offsets )
+				{
+					dwipe_verify_report( c, &b[k], q, n, offset + k );
+				}
+			}
 
-		/* Compare buffer contents. */
-		if( memcmp( b, d, blocksize ) != 0 ) { c->verify_errors += 1; }
+		} /* tiles */
+
+		if( DWIPE_PASS_HOLES( c ) )
+		{
+			/* Account for the block in the current extent. */
+			e -= blocksize;
+		}
+
+		/* Charge the time of this block to its part of the device. */
+		dwipe_profile_sample( c, offset, blocksize );
+
+		/* Advance to the next block. */
+		offset += blocksize;
 
 		/* Decrement the bytes remaining in this pass. */
-		z -= r;
+		z -= blocksize;
 
 		/* Increment the total progress counters. */
-		c->round_done += r;
-		c->pass_done += r;
+		c->round_done += blocksize;
+		c->pass_done += blocksize;
 
 	} /* while bytes remaining */
 
@@ -211,17 +447,26 @@ int dwipe_random_pass( DWIPE_METHOD_SIGNATURE )
 	/* The result holder. */
 	int r;
 
+	/* The start time of the last request. */
+	u64 t;
+
 	/* The IO size. */
 	size_t blocksize;
 
-	/* The result buffer for calls to lseek. */
-	loff_t offset;
+	/* The device offset of the current block. */
+	loff_t offset = c->chunk_start;
 
 	/* The output buffer. */
 	char* b;
 
-	/* The number of bytes remaining in the pass. */
-	u64 z = c->device_size;
+	/* The number of bytes remaining in this chunk of the pass. */
+	u64 z = c->chunk_length;
+
+	/* The number of bytes remaining in the current allocated extent. */
+	u64 e = 0;
+
+	/* The size of a hole that is skipped in sparse mode. */
+	loff_t h;
 
 
 	if( c->prng_seed.s == NULL )
@@ -238,7 +483,7 @@ int dwipe_random_pass( DWIPE_METHOD_SIGNATURE )
 
 
 	/* Create the output buffer. */
-	b = malloc( c->device_stat.st_blksize * 1024 );
+	b = dwipe_buffer_alloc( c, c->buffer_size );
 
 	/* Check the memory allocation. */
 	if( ! b )
@@ -248,54 +493,106 @@ int dwipe_random_pass( DWIPE_METHOD_SIGNATURE )
 		return -1;
 	}
 
-	/* Seed the PRNG. */
-	c->prng->init( &c->prng_state, &c->prng_seed );
-
-	/* Reset the file pointer. */
-	offset = lseek( c->device_fd, 0, SEEK_SET );
-
-	if( offset == (loff_t)-1 )
+	if( c->zoned && dwipe_zone_reset( c ) < 0 )
 	{
-		dwipe_perror( errno, __FUNCTION__, "lseek" );
-		dwipe_log( DWIPE_LOG_FATAL, "Unable to reset the '%s' file offset.", c->device_name );
+		/* The zones must be rewound before they can be written again. */
 		return -1;
 	}
 
-	if( offset != 0 )
+	if( c->stream_id >= 0 )
 	{
-		/* This is system insanity. */
-		dwipe_log( DWIPE_LOG_SANITY, "__FUNCTION__: lseek() returned a bogus offset on '%s'.", c->device_name );
-		return -1;
+		/* Take the pass and its seed from the shared stream. */
+		if( dwipe_stream_begin( c ) < 0 ) { return -1; }
 	}
 
+	else if( c->chunk_start == 0 && dwipe_options.prng_threads == 0 )
+	{
+		/* Seed the PRNG, which otherwise continues from the previous chunk. */
+		c->prng->init( &c->prng_state, &c->prng_seed );
+	}
 
 	while( z > 0 )
 	{
-		if( c->device_stat.st_blksize * 1024 < z )
+		if( DWIPE_PASS_HOLES( c ) && e == 0 )
 		{
-			blocksize = c->device_stat.st_blksize * 1024;
+			/* Skip to the next allocated extent. */
+			h = dwipe_sparse_next( c, offset, z, &e );
+
+			/* Holes count as done. */
+			offset += h;
+			z -= h;
+			c->round_done += h;
+			c->pass_done += h;
+			c->bytes_skipped += h;
+
+			if( c->stream_id >= 0 && ( c->prng->flags & DWIPE_PRNG_SEEKABLE ) )
+			{
+				/* The verifier seeks a counter-based PRNG to the device offset, */
+				/* so the shared stream moves over the hole like the device does. */
+				dwipe_stream_skip( c, h );
+			}
+
+			if( z == 0 ) { break; }
+		}
+
+		if( c->buffer_size <= z )
+		{
+			blocksize = c->buffer_size;
 		}
 		else
 		{
-			/* This is a seatbelt for buggy drivers and programming errors because */
-			/* the device size should always be an even multiple of its blocksize. */
+			/* The last block of the device can be short. This is a seatbelt for buggy */
+			/* drivers and programming errors because it is always whole sectors.     */
 			blocksize = z;
-			dwipe_log( DWIPE_LOG_WARNING,
-			  "%s: The size of '%s' is not a multiple of its block size %i.",
-			  __FUNCTION__, c->device_name, c->device_stat.st_blksize );
+
+			if( c->sector_size > 0 && z % c->sector_size != 0 )
+			{
+				dwipe_log( DWIPE_LOG_WARNING,
+				  "%s: The size of '%s' is not a multiple of its sector size %i.",
+				  __FUNCTION__, c->device_name, c->sector_size );
+			}
+		}
+
+		if( DWIPE_PASS_HOLES( c ) && blocksize > e )
+		{
+			/* Stop at the end of the allocated extent. */
+			blocksize = e;
+		}
+
+		if( c->stream_id >= 0 )
+		{
+			/* Copy the random pattern from the shared stream. */
+			if( dwipe_stream_read( c, b, blocksize ) < 0 ) { return -1; }
+		}
+
+		else if( dwipe_options.prng_threads > 0 )
+		{
+			/* Generate the random pattern for this offset in parallel substreams. */
+			if( dwipe_substream_fill( c, b, blocksize, offset ) < 0 ) { return -1; }
 		}
 
-		/* Fill the output buffer with the random pattern. */
-		c->prng->read( &c->prng_state, b, blocksize );
+		else
+		{
+			if( c->prng->flags & DWIPE_PRNG_SEEKABLE )
+			{
+				/* Position a counter-based PRNG at the device offset of the block. */
+				c->prng->seek( &c->prng_state, offset );
+			}
+
+			/* Fill the output buffer with the random pattern. */
+			dwipe_prng_fill( c->prng, &c->prng_state, b, blocksize );
+		}
 
 		/* Write the next block out to the device. */
-		r = write( c->device_fd, b, blocksize );
+		t = dwipe_health_clock();
+		r = c->backend->write( c, b, blocksize, offset );
+		dwipe_health_latency( c, t, r );
 
 		/* Check the result for a fatal error. */
 		if( r < 0 )
 		{
 			dwipe_perror( errno, __FUNCTION__, "write" );
-			dwipe_log( DWIPE_LOG_FATAL, "Unable to read from '%s'.", c->device_name );
+			dwipe_log( DWIPE_LOG_FATAL, "Unable to write to '%s'.", c->device_name );
 			return -1;
 		}
 
@@ -312,27 +609,38 @@ int dwipe_random_pass( DWIPE_METHOD_SIGNATURE )
 
 			dwipe_log( DWIPE_LOG_WARNING, "Partial write on '%s', %i bytes short.", c->device_name, s );
 
-			/* Bump the file pointer to the next block. */
-			offset = lseek( c->device_fd, s, SEEK_CUR );
+		} /* partial write */
 
-			if( offset == (loff_t)-1 )
-			{
-				dwipe_perror( errno, __FUNCTION__, "lseek" );
-				dwipe_log( DWIPE_LOG_ERROR, "Unable to bump the '%s' file offset after a partial write.", c->device_name );
-				return -1;
-			}
+		if( DWIPE_PASS_HOLES( c ) )
+		{
+			/* Account for the block in the current extent. */
+			e -= blocksize;
+		}
 
-		} /* partial write */
+		/* Charge the time of this block to its part of the device. */
+		dwipe_profile_sample( c, offset, blocksize );
+
+		/* Advance to the next block. */
+		offset += blocksize;
 
 		/* Decrement the bytes remaining in this pass. */
-		z -= r;
+		z -= blocksize;
 
 		/* Increment the total progress counters. */
-		c->round_done += r;
-		c->pass_done += r;
+		c->round_done += blocksize;
+		c->pass_done += blocksize;
+
+		/* A sink that keeps nothing has not written anything. */
+		if( c->backend->caps & DWIPE_BACKEND_CAP_DURABLE ) { c->bytes_written += r; }
 
 	} /* remaining bytes */
 
+	if( c->stream_id >= 0 )
+	{
+		/* Let the generator move on without this device. */
+		dwipe_stream_end( c );
+	}
+
 	/* Release the output buffer. */
 	free( b );
 
@@ -340,7 +648,7 @@ int dwipe_random_pass( DWIPE_METHOD_SIGNATURE )
 	c->sync_status = 1;
 
 	/* Sync the device. */
-	r = fdatasync( c->device_fd );
+	r = c->backend->flush( c );
 
 	/* Tell our parent that we have finished syncing the device. */
 	c->sync_status = 0;
@@ -348,7 +656,7 @@ int dwipe_random_pass( DWIPE_METHOD_SIGNATURE )
 	if( r != 0 )
 	{
 		/* FIXME: Is there a better way to handle this? */
-		dwipe_perror( errno, __FUNCTION__, "fdatasync" );
+		dwipe_perror( errno, __FUNCTION__, "flush" );
 		dwipe_log( DWIPE_LOG_WARNING, "Buffer flush failure on '%s'.", c->device_name );
 	}
 
@@ -369,26 +677,35 @@ int dwipe_static_verify( DWIPE_METHOD_SIGNATURE, dwipe_pattern_t* pattern )
 	/* The result holder. */
 	int r;
 
+	/* The start time of the last request. */
+	u64 t;
+
 	/* The IO size. */
 	size_t blocksize;
 
-	/* The result buffer for calls to lseek. */
-	loff_t offset;
+	/* The device offset of the current block. */
+	loff_t offset = c->chunk_start;
 
 	/* The input buffer. */
 	char* b;
 
-	/* The pattern buffer that is used to check the input buffer. */
-	char* d;
+	/* The pattern buffer that is used to check the input buffer, which is the shared tile when the pattern has one. */
+	const char* d;
 
-	/* A pointer into the pattern buffer. */
-	char* q;
+	/* The private pattern buffer when the pattern has no shared tile. */
+	char* m = NULL;
 
 	/* The pattern buffer window offset. */
-	int w = 0;
+	int w;
+
+	/* The number of bytes remaining in this chunk of the pass. */
+	u64 z = c->chunk_length;
+
+	/* The number of bytes remaining in the current allocated extent. */
+	u64 e = 0;
 
-	/* The number of bytes remaining in the pass. */
-	u64 z = c->device_size;
+	/* The size of a hole that is skipped in sparse mode. */
+	loff_t h;
 
 	if( pattern == NULL )
 	{
@@ -404,8 +721,17 @@ int dwipe_static_verify( DWIPE_METHOD_SIGNATURE, dwipe_pattern_t* pattern )
 		return -1;
 	}
 
+	/* Align the pattern with the start of the chunk. */
+	w = c->chunk_start % pattern->length;
+
+	if( ! ( c->backend->caps & DWIPE_BACKEND_CAP_READ ) )
+	{
+		dwipe_log( DWIPE_LOG_NOTICE, "The %s backend cannot read back '%s', so it is not verified.", c->backend->label, c->device_name );
+		return 0;
+	}
+
 	/* Create the input buffer. */
-	b = malloc( c->device_stat.st_blksize * 1024 );
+	b = dwipe_buffer_alloc( c, c->buffer_size );
 
 	/* Check the memory allocation. */
 	if( ! b )
@@ -415,28 +741,30 @@ int dwipe_static_verify( DWIPE_METHOD_SIGNATURE, dwipe_pattern_t* pattern )
 		return -1;
 	}
 
-	/* Create the pattern buffer */
-	d = malloc( c->device_stat.st_blksize * 1024 + pattern->length * 2 );
+	d = dwipe_tile_find( c, pattern );
 
-	/* Check the memory allocation. */
-	if( ! d )
+	if( d == NULL )
 	{
-		dwipe_perror( errno, __FUNCTION__, "malloc" );
-		dwipe_log( DWIPE_LOG_FATAL, "Unable to allocate memory for the pattern buffer." );
-		return -1;
-	}
+		/* Create the pattern buffer */
+		d = m = dwipe_buffer_alloc( c, c->buffer_size + pattern->length * 2 );
+
+		/* Check the memory allocation. */
+		if( ! m )
+		{
+			dwipe_perror( errno, __FUNCTION__, "malloc" );
+			dwipe_log( DWIPE_LOG_FATAL, "Unable to allocate memory for the pattern buffer." );
+			return -1;
+		}
 
-	for( q = d ; q < d + c->device_stat.st_blksize * 1024 + pattern->length ; q += pattern->length )
-	{
 		/* Fill the pattern buffer with the pattern. */
-		memcpy( q, pattern->s, pattern->length );
+		dwipe_kernels.pattern_fill( m, c->buffer_size + pattern->length * 2, pattern->s, pattern->length );
 	}
 
 	/* Tell our parent that we are syncing the device. */
 	c->sync_status = 1;
 
 	/* Sync the device. */
-	r = fdatasync( c->device_fd );
+	r = c->backend->flush( c );
 
 	/* Tell our parent that we have finished syncing the device. */
 	c->sync_status = 0;
@@ -444,48 +772,58 @@ int dwipe_static_verify( DWIPE_METHOD_SIGNATURE, dwipe_pattern_t* pattern )
 	if( r != 0 )
 	{
 		/* FIXME: Is there a better way to handle this? */
-		dwipe_perror( errno, __FUNCTION__, "fdatasync" );
+		dwipe_perror( errno, __FUNCTION__, "flush" );
 		dwipe_log( DWIPE_LOG_WARNING, "Buffer flush failure on '%s'.", c->device_name );
 	}
 
 
-	/* Reset the file pointer. */
-	offset = lseek( c->device_fd, 0, SEEK_SET );
-
-	if( offset == (loff_t)-1 )
+	while( z > 0 )
 	{
-		dwipe_perror( errno, __FUNCTION__, "lseek" );
-		dwipe_log( DWIPE_LOG_FATAL, "Unable to reset the '%s' file offset.", c->device_name );
-		return -1;
-	}
+		if( DWIPE_PASS_HOLES( c ) && e == 0 )
+		{
+			/* Skip to the next allocated extent. */
+			h = dwipe_sparse_next( c, offset, z, &e );
 
-	if( offset != 0 )
-	{
-		/* This is system insanity. */
-		dwipe_log( DWIPE_LOG_SANITY, "dwipe_static_verify: lseek() returned a bogus offset on '%s'.", c->device_name );
-		return -1;
-	}
+			/* Holes count as done. */
+			offset += h;
+			z -= h;
+			c->round_done += h;
+			c->pass_done += h;
 
+			/* Keep the pattern aligned with the device offset. */
+			w = ( h + w ) % pattern->length;
 
-	while( z > 0 )
-	{
-		if( c->device_stat.st_blksize * 1024 < z )
+			if( z == 0 ) { break; }
+		}
+
+		if( c->buffer_size <= z )
 		{
-			blocksize = c->device_stat.st_blksize * 1024;
+			blocksize = c->buffer_size;
 		}
 		else
 		{
-			/* This is a seatbelt for buggy drivers and programming errors because */
-			/* the device size should always be an even multiple of its blocksize. */
+			/* The last block of the device can be short. This is a seatbelt for buggy */
+			/* drivers and programming errors because it is always whole sectors.     */
 			blocksize = z;
-			dwipe_log( DWIPE_LOG_WARNING,
-			  "%s: The size of '%s' is not a multiple of its block size %i.",
-			  __FUNCTION__, c->device_name, c->device_stat.st_blksize );
+
+			if( c->sector_size > 0 && z % c->sector_size != 0 )
+			{
+				dwipe_log( DWIPE_LOG_WARNING,
+				  "%s: The size of '%s' is not a multiple of its sector size %i.",
+				  __FUNCTION__, c->device_name, c->sector_size );
+			}
+		}
+
+		if( DWIPE_PASS_HOLES( c ) && blocksize > e )
+		{
+			/* Stop at the end of the allocated extent. */
+			blocksize = e;
 		}
 
-		/* Fill the output buffer with the random pattern. */
 		/* Read the buffer in from the device. */
-		r = read( c->device_fd, b, blocksize );
+		t = dwipe_health_clock();
+		r = c->backend->read( c, b, blocksize, offset );
+		dwipe_health_latency( c, t, r );
 
 		/* Check the result. */
 		if( r < 0 )
@@ -499,7 +837,15 @@ int dwipe_static_verify( DWIPE_METHOD_SIGNATURE, dwipe_pattern_t* pattern )
 		if( r == blocksize )
 		{
 			/* Check every byte in the buffer. */
-			if( memcmp( b, &d[w], r ) != 0 ) { c->verify_errors += 1; }
+			if( ! dwipe_kernels.equal( b, &d[w], r ) )
+			{
+				c->verify_errors += 1;
+
+				if( dwipe_options.verify_offsets )
+				{
+					dwipe_verify_report( c, b, &d[w], r, offset );
+				}
+			}
 		}
 		else
 		{
@@ -513,38 +859,40 @@ int dwipe_static_verify( DWIPE_METHOD_SIGNATURE, dwipe_pattern_t* pattern )
 			
 			dwipe_log( DWIPE_LOG_WARNING, "Partial read on '%s', %i bytes short.", c->device_name, s );
 
-			/* Bump the file pointer to the next block. */
-			offset = lseek( c->device_fd, s, SEEK_CUR );
-
-			if( offset == (loff_t)-1 )
-			{
-				dwipe_perror( errno, __FUNCTION__, "lseek" );
-				dwipe_log( DWIPE_LOG_ERROR, "Unable to bump the '%s' file offset after a partial read.", c->device_name );
-				return -1;
-			}
-
 		} /* partial read */
 
 		/* Adjust the window. */
-		w = ( c->device_stat.st_blksize * 1024 + w ) % pattern->length;
+		w = ( blocksize + w ) % pattern->length;
 
 		/* Intuition check: 
 		 *   If the pattern length evenly divides the block size
 		 *   then ( w == 0 ) always.
 		 */
 
+		if( DWIPE_PASS_HOLES( c ) )
+		{
+			/* Account for the block in the current extent. */
+			e -= blocksize;
+		}
+
+		/* Charge the time of this block to its part of the device. */
+		dwipe_profile_sample( c, offset, blocksize );
+
+		/* Advance to the next block. */
+		offset += blocksize;
+
 		/* Decrement the bytes remaining in this pass. */
-		z -= r;
+		z -= blocksize;
 
 		/* Increment the total progress counters. */
-		c->round_done += r;
-		c->pass_done += r;
+		c->round_done += blocksize;
+		c->pass_done += blocksize;
 
 	} /* while bytes remaining */
 
 	/* Release the buffers. */
 	free( b );
-	free( d );
+	free( m );
 
 	/* We're done. */
 	return 0;
@@ -563,23 +911,41 @@ int dwipe_static_pass( DWIPE_METHOD_SIGNATURE, dwipe_pattern_t* pattern )
 	/* The result holder. */
 	int r;
 
+	/* The start time of the last request. */
+	u64 t;
+
 	/* The IO size. */
 	size_t blocksize;
 
-	/* The result buffer for calls to lseek. */
-	loff_t offset;
+	/* The device offset of the current block. */
+	loff_t offset = c->chunk_start;
 
-	/* The output buffer. */
-	char* b;
+	/* The output buffer, which is the shared tile when the pattern has one. */
+	const char* b;
+
+	/* The private output buffer when the pattern has no shared tile. */
+	char* m = NULL;
 
-	/* A pointer into the output buffer. */
+	/* A pointer into the pattern. */
 	char* p;
 
+	/* The input buffer for the read-compare-write mode. */
+	char* d = NULL;
+
+	/* Set when the pattern is entirely zeros. */
+	int zero = 1;
+
 	/* The output buffer window offset. */
-	int w = 0;
+	int w;
+
+	/* The number of bytes remaining in this chunk of the pass. */
+	u64 z = c->chunk_length;
 
-	/* The number of bytes remaining in the pass. */
-	u64 z = c->device_size;
+	/* The number of bytes remaining in the current allocated extent. */
+	u64 e = 0;
+
+	/* The size of a hole that is skipped in sparse mode. */
+	loff_t h;
 
 	if( pattern == NULL )
 	{
@@ -595,98 +961,161 @@ int dwipe_static_pass( DWIPE_METHOD_SIGNATURE, dwipe_pattern_t* pattern )
 		return -1;
 	}
 
-	/* Create the output buffer. */
-	b = malloc( c->device_stat.st_blksize * 1024 + pattern->length * 2 );
-
-	/* Check the memory allocation. */
-	if( ! b )
+	if( c->zoned )
 	{
-		dwipe_perror( errno, __FUNCTION__, "malloc" );
-		dwipe_log( DWIPE_LOG_FATAL, "Unable to allocate memory for the pattern buffer." );
-		return -1;
+		/* Write several zones at once. */
+		return dwipe_zone_static_pass( c, pattern );
 	}
 
-	for( p = b ; p < b + c->device_stat.st_blksize * 1024 + pattern->length ; p += pattern->length )
-	{
-		/* Fill the output buffer with the pattern. */
-		memcpy( p, pattern->s, pattern->length ); 
-	}
+	/* Align the pattern with the start of the chunk. */
+	w = c->chunk_start % pattern->length;
 
+	b = dwipe_tile_find( c, pattern );
 
-	/* Reset the file pointer. */
-	offset = lseek( c->device_fd, 0, SEEK_SET );
-
-	if( offset == (loff_t)-1 )
+	if( b == NULL )
 	{
-		dwipe_perror( errno, __FUNCTION__, "lseek" );
-		dwipe_log( DWIPE_LOG_FATAL, "Unable to reset the '%s' file offset.", c->device_name );
-		return -1;
+		/* Create the output buffer. */
+		b = m = dwipe_buffer_alloc( c, c->buffer_size + pattern->length * 2 );
+
+		/* Check the memory allocation. */
+		if( ! m )
+		{
+			dwipe_perror( errno, __FUNCTION__, "malloc" );
+			dwipe_log( DWIPE_LOG_FATAL, "Unable to allocate memory for the pattern buffer." );
+			return -1;
+		}
+
+		/* Fill the output buffer with the pattern. */
+		dwipe_kernels.pattern_fill( m, c->buffer_size + pattern->length * 2, pattern->s, pattern->length );
 	}
 
-	if( offset != 0 )
+	if( dwipe_options.skip_matching && ( c->backend->caps & DWIPE_BACKEND_CAP_READ ) )
 	{
-		/* This is system insanity. */
-		dwipe_log( DWIPE_LOG_SANITY, "__FUNCTION__: lseek() returned a bogus offset on '%s'.", c->device_name );
-		return -1;
+		/* Create the input buffer. */
+		d = dwipe_buffer_alloc( c, c->buffer_size );
+
+		/* Check the memory allocation. */
+		if( ! d )
+		{
+			dwipe_perror( errno, __FUNCTION__, "malloc" );
+			dwipe_log( DWIPE_LOG_FATAL, "Unable to allocate memory for the input buffer." );
+			return -1;
+		}
+
+		/* A zero pattern can be checked without touching the pattern buffer. */
+		for( p = pattern->s ; p < pattern->s + pattern->length ; p++ )
+		{
+			if( *p ) { zero = 0; }
+		}
 	}
 
 
 	while( z > 0 )
 	{
-		if( c->device_stat.st_blksize * 1024 < z )
+		if( DWIPE_PASS_HOLES( c ) && e == 0 )
+		{
+			/* Skip to the next allocated extent. */
+			h = dwipe_sparse_next( c, offset, z, &e );
+
+			/* Holes count as done. */
+			offset += h;
+			z -= h;
+			c->round_done += h;
+			c->pass_done += h;
+			c->bytes_skipped += h;
+
+			/* Keep the pattern aligned with the device offset. */
+			w = ( h + w ) % pattern->length;
+
+			if( z == 0 ) { break; }
+		}
+
+		if( c->buffer_size <= z )
 		{
-			blocksize = c->device_stat.st_blksize * 1024;
+			blocksize = c->buffer_size;
 		}
 		else
 		{
-			/* This is a seatbelt for buggy drivers and programming errors because */
-			/* the device size should always be an even multiple of its blocksize. */
+			/* The last block of the device can be short. This is a seatbelt for buggy */
+			/* drivers and programming errors because it is always whole sectors.     */
 			blocksize = z;
-			dwipe_log( DWIPE_LOG_WARNING,
-			  "%s: The size of '%s' is not a multiple of its block size %i.",
-			  __FUNCTION__, c->device_name, c->device_stat.st_blksize );
-		}
 
-		/* Fill the output buffer with the random pattern. */
-		/* Write the next block out to the device. */
-		r = write( c->device_fd, &b[w], blocksize );
+			if( c->sector_size > 0 && z % c->sector_size != 0 )
+			{
+				dwipe_log( DWIPE_LOG_WARNING,
+				  "%s: The size of '%s' is not a multiple of its sector size %i.",
+				  __FUNCTION__, c->device_name, c->sector_size );
+			}
+		}
 
-		/* Check the result for a fatal error. */
-		if( r < 0 )
+		if( DWIPE_PASS_HOLES( c ) && blocksize > e )
 		{
-			dwipe_perror( errno, __FUNCTION__, "write" );
-			dwipe_log( DWIPE_LOG_FATAL, "Unable to write to '%s'.", c->device_name );
-			return -1;
+			/* Stop at the end of the allocated extent. */
+			blocksize = e;
 		}
 
-		/* Check for a partial write. */
-		if( r != blocksize )
+		/* Assume that the block must be written. */
+		r = -1;
+
+		if( d != NULL )
 		{
-			/* TODO: Handle a partial write. */
+			/* Read the block that is about to be overwritten. */
+			t = dwipe_health_clock();
+			r = c->backend->read( c, d, blocksize, offset );
+			dwipe_health_latency( c, t, r );
 
-			/* The number of bytes that were not written. */
-			int s = blocksize - r;
-			
-			/* Increment the error count. */
-			c->pass_errors += s;
+			if( r == blocksize && ( zero ? dwipe_kernels.is_zero( d, r ) : dwipe_kernels.equal( d, &b[w], r ) ) )
+			{
+				/* The block already holds the pattern, so leave it alone. */
+				c->bytes_skipped += r;
+			}
 
-			dwipe_log( DWIPE_LOG_WARNING, "Partial write on '%s', %i bytes short.", c->device_name, s );
+			else
+			{
+				/* The write below will report a real device failure. */
+				r = -1;
+			}
+
+		} /* read-compare */
 
-			/* Bump the file pointer to the next block. */
-			offset = lseek( c->device_fd, s, SEEK_CUR );
+		if( r < 0 )
+		{
+			/* Write the next block out to the device. */
+			t = dwipe_health_clock();
+			r = c->backend->write( c, &b[w], blocksize, offset );
+			dwipe_health_latency( c, t, r );
 
-			if( offset == (loff_t)-1 )
+			/* Check the result for a fatal error. */
+			if( r < 0 )
 			{
-				dwipe_perror( errno, __FUNCTION__, "lseek" );
-				dwipe_log( DWIPE_LOG_ERROR, "Unable to bump the '%s' file offset after a partial write.", c->device_name );
+				dwipe_perror( errno, __FUNCTION__, "write" );
+				dwipe_log( DWIPE_LOG_FATAL, "Unable to write to '%s'.", c->device_name );
 				return -1;
 			}
 
-		} /* partial write */
+			/* Check for a partial write. */
+			if( r != blocksize )
+			{
+				/* TODO: Handle a partial write. */
+
+				/* The number of bytes that were not written. */
+				int s = blocksize - r;
+			
+				/* Increment the error count. */
+				c->pass_errors += s;
+
+				dwipe_log( DWIPE_LOG_WARNING, "Partial write on '%s', %i bytes short.", c->device_name, s );
+
+			} /* partial write */
+
+			/* A sink that keeps nothing has not written anything. */
+			if( c->backend->caps & DWIPE_BACKEND_CAP_DURABLE ) { c->bytes_written += r; }
+
+		} /* write */
 
 
 		/* Adjust the window. */
-		w = ( c->device_stat.st_blksize * 1024 + w ) % pattern->length;
+		w = ( blocksize + w ) % pattern->length;
 
 		/* Intuition check: 
 		 *
@@ -694,12 +1123,24 @@ int dwipe_static_pass( DWIPE_METHOD_SIGNATURE, dwipe_pattern_t* pattern )
 		 *   then ( w == 0 ) always.
 		 */
 
+		if( DWIPE_PASS_HOLES( c ) )
+		{
+			/* Account for the block in the current extent. */
+			e -= blocksize;
+		}
+
+		/* Charge the time of this block to its part of the device. */
+		dwipe_profile_sample( c, offset, blocksize );
+
+		/* Advance to the next block. */
+		offset += blocksize;
+
 		/* Decrement the bytes remaining in this pass. */
-		z -= r;
+		z -= blocksize;
 
 		/* Increment the total progress counterr. */
-		c->round_done += r;
-		c->pass_done += r;
+		c->round_done += blocksize;
+		c->pass_done += blocksize;
 
 	} /* remaining bytes */
 
@@ -707,7 +1148,7 @@ int dwipe_static_pass( DWIPE_METHOD_SIGNATURE, dwipe_pattern_t* pattern )
 	c->sync_status = 1;
 
 	/* Sync the device. */
-	r = fdatasync( c->device_fd );
+	r = c->backend->flush( c );
 
 	/* Tell our parent that we have finished syncing the device. */
 	c->sync_status = 0;
@@ -715,16 +1156,100 @@ int dwipe_static_pass( DWIPE_METHOD_SIGNATURE, dwipe_pattern_t* pattern )
 	if( r != 0 )
 	{
 		/* FIXME: Is there a better way to handle this? */
-		dwipe_perror( errno, __FUNCTION__, "fdatasync" );
+		dwipe_perror( errno, __FUNCTION__, "flush" );
 		dwipe_log( DWIPE_LOG_WARNING, "Buffer flush failure on '%s'.", c->device_name );
 	}
 
 	/* Release the output buffer. */
-	free( b );
-	
+	free( m );
+
+	/* Release the input buffer. */
+	free( d );
+
 	/* We're done. */
 	return 0;	
 
 } /* dwipe_static_pass */
 
+
+
+int dwipe_zeroout_pass( DWIPE_METHOD_SIGNATURE )
+{
+/**
+ * Zeroes the current chunk with the write-zeroes offload of the block driver.
+ *
+ * @returns  0 on success, 1 if the device refused the offload before anything was
+ *           zeroed, so that the caller writes the zeros, or -1 on a fatal error.
+ *
+ */
+
+	/* The result holder. */
+	int r;
+
+	/* The start time of the last request. */
+	u64 t;
+
+	/* The BLKZEROOUT argument is a start and length pair. */
+	u64 range [2];
+
+	/* The device offset of the current request. */
+	loff_t offset = c->chunk_start;
+
+	/* The number of bytes remaining in this chunk of the pass. */
+	u64 z = c->chunk_length;
+
+	while( z > 0 )
+	{
+		range[0] = offset;
+		range[1] = z < DWIPE_KNOB_ZEROOUT_STEP ? z : DWIPE_KNOB_ZEROOUT_STEP;
+
+		t = dwipe_health_clock();
+		r = ioctl( c->device_fd, BLKZEROOUT, &range );
+		dwipe_health_latency( c, t, 0 );
+
+		if( r != 0 && offset == c->chunk_start )
+		{
+			/* Do not try again on the next chunk. */
+			dwipe_perror( errno, __FUNCTION__, "ioctl" );
+			dwipe_log( DWIPE_LOG_WARNING, "The device '%s' refused the write-zeroes offload, so the zeros are written.", c->device_name );
+			c->plan_flags &= ~DWIPE_PLAN_ZEROOUT;
+			return 1;
+		}
+
+		if( r != 0 )
+		{
+			dwipe_perror( errno, __FUNCTION__, "ioctl" );
+			dwipe_log( DWIPE_LOG_FATAL, "Unable to zero '%s' at offset %llu.", c->device_name, (u64)offset );
+			return -1;
+		}
+
+		/* Advance to the next request. */
+		offset += range[1];
+		z -= range[1];
+
+		/* Increment the total progress counters. */
+		c->round_done += range[1];
+		c->pass_done += range[1];
+		c->bytes_written += range[1];
+	}
+
+	/* Tell our parent that we are syncing the device. */
+	c->sync_status = 1;
+
+	/* The zeros may still be in the write cache of the device. */
+	r = c->backend->flush( c );
+
+	/* Tell our parent that we have finished syncing the device. */
+	c->sync_status = 0;
+
+	if( r != 0 )
+	{
+		dwipe_perror( errno, __FUNCTION__, "flush" );
+		dwipe_log( DWIPE_LOG_WARNING, "Buffer flush failure on '%s'.", c->device_name );
+	}
+
+	return 0;
+
+} /* dwipe_zeroout_pass */
+
 /* eof */
@@ -21,10 +21,13 @@
 #ifndef PASS_H_
 #define PASS_H_
 
+void* dwipe_buffer_alloc( dwipe_context_t* c, size_t size );
+
 int dwipe_random_pass  ( dwipe_context_t* c );
 int dwipe_random_verify( dwipe_context_t* c );
 int dwipe_static_pass  ( dwipe_context_t* c, dwipe_pattern_t* pattern );
 int dwipe_static_verify( dwipe_context_t* c, dwipe_pattern_t* pattern );
+int dwipe_zeroout_pass ( dwipe_context_t* c );
 
 #endif /* PASS_H_ */
 
@@ -0,0 +1,250 @@
+/*
+ *  philox.c: The Philox4x32-10 counter-based generator.
+ *
+ *  Copyright Paolo Iannelli <info@paoloiannelli.com>.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc., 675 Mass
+ *  Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/*
+ * Philox4x32-10 is by Salmon, Moraes, Dror and Shaw, "Parallel Random Numbers: As Easy as
+ * 1, 2, 3" (SC11). Every 16-byte block is a keyed function of its own counter, so the bytes
+ * at any offset of the stream can be made without making the bytes in front of them.
+ *
+ * Block n of the stream is the counter ( n, nonce ), and its four output words are written
+ * in little-endian order.
+ *
+ */
+
+#include <string.h>
+#include "philox.h"
+#include "cpu.h"
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <immintrin.h>
+#define PHILOX_HAVE_AVX2
+#endif
+
+#define PHILOX_M0   0xd2511f53U
+#define PHILOX_M1   0xcd9e8d57U
+#define PHILOX_W0   0x9e3779b9U
+#define PHILOX_W1   0xbb67ae85U
+
+#define PHILOX_LOAD32( p ) ( (uint32_t)(p)[0] | (uint32_t)(p)[1] << 8 | (uint32_t)(p)[2] << 16 | (uint32_t)(p)[3] << 24 )
+
+
+
+void philox_init( philox_state_t* p, const uint8_t* key, const uint8_t* nonce )
+{
+	p->key[0] = PHILOX_LOAD32( key );
+	p->key[1] = PHILOX_LOAD32( key + 4 );
+	p->nonce[0] = PHILOX_LOAD32( nonce );
+	p->nonce[1] = PHILOX_LOAD32( nonce + 4 );
+	p->block = 0;
+	p->left = 0;
+	p->avx2 = 0;
+
+#ifdef PHILOX_HAVE_AVX2
+	p->avx2 = dwipe_cpu_level() >= DWIPE_CPU_AVX2;
+#endif
+
+} /* philox_init */
+
+
+
+static void philox_steps_soft( philox_state_t* p, uint8_t* out, size_t steps )
+{
+	uint32_t c [4];
+	uint32_t k0;
+	uint32_t k1;
+	uint64_t p0;
+	uint64_t p1;
+	size_t blocks = steps * PHILOX_LANES;
+	size_t i;
+	int r;
+
+	for( i = 0 ; i < blocks ; i++ )
+	{
+		c[0] = (uint32_t)p->block;
+		c[1] = (uint32_t)( p->block >> 32 );
+		c[2] = p->nonce[0];
+		c[3] = p->nonce[1];
+
+		k0 = p->key[0];
+		k1 = p->key[1];
+
+		for( r = 0 ; r < 10 ; r++ )
+		{
+			p0 = (uint64_t)PHILOX_M0 * c[0];
+			p1 = (uint64_t)PHILOX_M1 * c[2];
+
+			c[0] = (uint32_t)( p1 >> 32 ) ^ c[1] ^ k0;
+			c[1] = (uint32_t)p1;
+			c[2] = (uint32_t)( p0 >> 32 ) ^ c[3] ^ k1;
+			c[3] = (uint32_t)p0;
+
+			k0 += PHILOX_W0;
+			k1 += PHILOX_W1;
+		}
+
+		for( r = 0 ; r < 4 ; r++ )
+		{
+			out[i * PHILOX_BLOCK_SIZE + r * 4 + 0] = (uint8_t)c[r];
+			out[i * PHILOX_BLOCK_SIZE + r * 4 + 1] = (uint8_t)( c[r] >> 8 );
+			out[i * PHILOX_BLOCK_SIZE + r * 4 + 2] = (uint8_t)( c[r] >> 16 );
+			out[i * PHILOX_BLOCK_SIZE + r * 4 + 3] = (uint8_t)( c[r] >> 24 );
+		}
+
+		p->block += 1;
+	}
+
+} /* philox_steps_soft */
+
+
+
+#ifdef PHILOX_HAVE_AVX2
+
+/* The high and low halves of the eight products of a and m, from the even and odd lanes. */
+#define PHILOX_MULHILO( a, m, hi, lo ) \
+	e = _mm256_mul_epu32( a, m ); \
+	o = _mm256_mul_epu32( _mm256_srli_epi64( a, 32 ), m ); \
+	hi = _mm256_blend_epi32( _mm256_srli_epi64( e, 32 ), o, 0xaa ); \
+	lo = _mm256_blend_epi32( e, _mm256_slli_epi64( o, 32 ), 0xaa );
+
+__attribute__(( target( "avx2" ) ))
+static void philox_steps_avx2( philox_state_t* p, uint8_t* out, size_t steps )
+{
+	__m256i m0 = _mm256_set1_epi32( PHILOX_M0 );
+	__m256i m1 = _mm256_set1_epi32( PHILOX_M1 );
+	__m256i c0, c1, c2, c3, h0, l0, h1, l1, e, o;
+	__m256i t0, t1, t2, t3;
+	uint32_t lo [PHILOX_LANES];
+	uint32_t hi [PHILOX_LANES];
+	uint32_t k0;
+	uint32_t k1;
+	size_t k;
+	int i;
+	int r;
+
+	for( k = 0 ; k < steps ; k++ )
+	{
+		/* The eight counters of this step, in lane order. */
+		for( i = 0 ; i < PHILOX_LANES ; i++ )
+		{
+			lo[i] = (uint32_t)( p->block + i );
+			hi[i] = (uint32_t)( ( p->block + i ) >> 32 );
+		}
+
+		c0 = _mm256_loadu_si256( (const __m256i*)lo );
+		c1 = _mm256_loadu_si256( (const __m256i*)hi );
+		c2 = _mm256_set1_epi32( p->nonce[0] );
+		c3 = _mm256_set1_epi32( p->nonce[1] );
+
+		k0 = p->key[0];
+		k1 = p->key[1];
+
+		for( r = 0 ; r < 10 ; r++ )
+		{
+			PHILOX_MULHILO( c0, m0, h0, l0 );
+			PHILOX_MULHILO( c2, m1, h1, l1 );
+
+			c0 = _mm256_xor_si256( _mm256_xor_si256( h1, c1 ), _mm256_set1_epi32( k0 ) );
+			c1 = l1;
+			c2 = _mm256_xor_si256( _mm256_xor_si256( h0, c3 ), _mm256_set1_epi32( k1 ) );
+			c3 = l0;
+
+			k0 += PHILOX_W0;
+			k1 += PHILOX_W1;
+		}
+
+		/* Transpose the four words of the eight lanes into eight whole blocks. */
+		t0 = _mm256_unpacklo_epi32( c0, c1 );
+		t1 = _mm256_unpackhi_epi32( c0, c1 );
+		t2 = _mm256_unpacklo_epi32( c2, c3 );
+		t3 = _mm256_unpackhi_epi32( c2, c3 );
+
+		c0 = _mm256_unpacklo_epi64( t0, t2 );
+		c1 = _mm256_unpackhi_epi64( t0, t2 );
+		c2 = _mm256_unpacklo_epi64( t1, t3 );
+		c3 = _mm256_unpackhi_epi64( t1, t3 );
+
+		_mm256_storeu_si256( (__m256i*)( out + k * PHILOX_STEP + 0  ), _mm256_permute2x128_si256( c0, c1, 0x20 ) );
+		_mm256_storeu_si256( (__m256i*)( out + k * PHILOX_STEP + 32 ), _mm256_permute2x128_si256( c2, c3, 0x20 ) );
+		_mm256_storeu_si256( (__m256i*)( out + k * PHILOX_STEP + 64 ), _mm256_permute2x128_si256( c0, c1, 0x31 ) );
+		_mm256_storeu_si256( (__m256i*)( out + k * PHILOX_STEP + 96 ), _mm256_permute2x128_si256( c2, c3, 0x31 ) );
+
+		p->block += PHILOX_LANES;
+	}
+
+} /* philox_steps_avx2 */
+
+#endif /* PHILOX_HAVE_AVX2 */
+
+static void philox_steps( philox_state_t* p, uint8_t* out, size_t steps )
+{
+#ifdef PHILOX_HAVE_AVX2
+	if( p->avx2 )
+	{
+		philox_steps_avx2( p, out, steps );
+		return;
+	}
+#endif
+
+	philox_steps_soft( p, out, steps );
+
+} /* philox_steps */
+
+void philox_read( philox_state_t* p, uint8_t* buffer, size_t count )
+{
+	size_t n;
+
+	/* Drain the output that is left over from the last call. */
+	n = count < p->left ? count : p->left;
+	memcpy( buffer, p->stream + sizeof( p->stream ) - p->left, n );
+	p->left -= n;
+	buffer += n;
+	count -= n;
+
+	/* Write whole steps straight into the buffer. */
+	n = count / PHILOX_STEP;
+	philox_steps( p, buffer, n );
+	buffer += n * PHILOX_STEP;
+	count -= n * PHILOX_STEP;
+
+	if( count > 0 )
+	{
+		/* Keep the rest of the last step for the next call. */
+		philox_steps( p, p->stream, 1 );
+		memcpy( buffer, p->stream, count );
+		p->left = PHILOX_STEP - count;
+	}
+
+} /* philox_read */
+
+void philox_seek( philox_state_t* p, uint64_t offset )
+{
+	p->block = offset / PHILOX_BLOCK_SIZE;
+	p->left = 0;
+
+	if( offset % PHILOX_BLOCK_SIZE != 0 )
+	{
+		/* Make the step that holds the offset, and drop the bytes in front of it. */
+		philox_steps( p, p->stream, 1 );
+		p->left = PHILOX_STEP - offset % PHILOX_BLOCK_SIZE;
+	}
+
+} /* philox_seek */
+
+/* eof */
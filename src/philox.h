@@ -0,0 +1,52 @@
+/*
+ *  philox.h: The Philox4x32-10 counter-based generator.
+ *
+ *  Copyright Paolo Iannelli <info@paoloiannelli.com>.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc., 675 Mass
+ *  Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#ifndef PHILOX_H_
+#define PHILOX_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define PHILOX_BLOCK_SIZE   16                               /* Four 32-bit words for each counter.  */
+#define PHILOX_LANES        8                                /* Counters in one AVX2 register.       */
+#define PHILOX_STEP         ( PHILOX_LANES * PHILOX_BLOCK_SIZE )
+
+typedef struct philox_state_t_
+{
+	uint32_t key[2];                   /* The 64-bit key.                                        */
+	uint32_t nonce[2];                 /* The high half of the 128-bit counter.                  */
+	uint64_t block;                    /* The low half of the counter, which numbers the blocks. */
+	uint8_t  stream[PHILOX_STEP];      /* The step that a short read split.                      */
+	size_t   left;                     /* The number of unread bytes at the end of stream.       */
+	int      avx2;                     /* Set when the steps run on AVX2.                        */
+} philox_state_t;
+
+/* Set up the key and the high half of the counter, starting at block zero. */
+void philox_init( philox_state_t* p, const uint8_t* key, const uint8_t* nonce );
+
+/* Write count bytes of output, keeping any unread tail for the next call. */
+void philox_read( philox_state_t* p, uint8_t* buffer, size_t count );
+
+/* Move to a byte offset of the stream without generating anything in front of it. */
+void philox_seek( philox_state_t* p, uint64_t offset );
+
+#endif /* PHILOX_H_ */
+
+/* eof */
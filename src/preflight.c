@@ -0,0 +1,429 @@
+/*
+ *  preflight.c: Estimates of the session time per device, without writing.
+ *
+ *  Copyright Paolo Iannelli <info@paoloiannelli.com>.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc., 675 Mass
+ *  Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include "dwipe.h"
+#include "context.h"
+#include "method.h"
+#include "prng.h"
+#include "options.h"
+#include "device.h"
+#include "metadata.h"
+#include "profile.h"
+#include "preflight.h"
+#include "logging.h"
+
+/* The random and static passes in one round of the visited method. */
+static int dwipe_preflight_randoms;
+static int dwipe_preflight_statics;
+
+
+
+static double dwipe_preflight_clock( void )
+{
+/**
+ * Returns a monotonic time in seconds.
+ *
+ */
+
+	struct timespec t;
+
+	clock_gettime( CLOCK_MONOTONIC, &t );
+
+	return t.tv_sec + t.tv_nsec / 1e9;
+
+} /* dwipe_preflight_clock */
+
+
+
+static void dwipe_preflight_format( char* s, size_t n, double t )
+{
+/**
+ * Prints a number of seconds as hours, minutes and seconds.
+ *
+ */
+
+	u64 x = t + 0.5;
+
+	snprintf( s, n, "%llu:%02llu:%02llu", x / 3600, x / 60 % 60, x % 60 );
+
+} /* dwipe_preflight_format */
+
+
+
+static int dwipe_preflight_count( DWIPE_METHOD_SIGNATURE, dwipe_pattern_t* patterns )
+{
+/**
+ * Counts the random and static passes of a method, for dwipe_method_visit().
+ *
+ */
+
+	int i;
+
+	dwipe_preflight_randoms = 0;
+	dwipe_preflight_statics = 0;
+
+	for( i = 0 ; patterns[i].length ; i++ )
+	{
+		if( patterns[i].length < 0 ) { dwipe_preflight_randoms += 1; }
+		else                         { dwipe_preflight_statics += 1; }
+	}
+
+	return 0;
+
+} /* dwipe_preflight_count */
+
+
+
+static double dwipe_preflight_prng( void )
+{
+/**
+ * Times the selected PRNG on one thread, because a random pass cannot run faster than
+ * its pattern is generated.
+ *
+ * @returns  The rate in bytes per second, or 0 if the PRNG could not be started.
+ *
+ */
+
+	/* The seed does not matter for the rate. */
+	u8 key [DWIPE_KNOB_SEED_LENGTH];
+	dwipe_entropy_t seed = { sizeof( key ), key };
+
+	void* state = NULL;
+	char* b = NULL;
+	double t;
+	u64 done;
+
+	memset( key, 0x5a, sizeof( key ) );
+
+	/* Pad the buffer like the pass routines do. */
+	if( posix_memalign( (void**)&b, 64, DWIPE_KNOB_PREFLIGHT_BLOCK + 64 ) != 0 )
+	{
+		dwipe_perror( errno, __FUNCTION__, "posix_memalign" );
+		return 0;
+	}
+
+	if( dwipe_options.prng->init( &state, &seed ) != 0 )
+	{
+		dwipe_log( DWIPE_LOG_WARNING, "Unable to start the %s PRNG, so random passes are timed by the device alone.", dwipe_options.prng->label );
+		free( b );
+		return 0;
+	}
+
+	t = dwipe_preflight_clock();
+
+	for( done = 0 ; done < DWIPE_KNOB_PREFLIGHT_PRNG ; done += DWIPE_KNOB_PREFLIGHT_BLOCK )
+	{
+		dwipe_prng_fill( dwipe_options.prng, &state, b, DWIPE_KNOB_PREFLIGHT_BLOCK );
+	}
+
+	t = dwipe_preflight_clock() - t;
+
+	free( state );
+	free( b );
+
+	return t > 0 ? DWIPE_KNOB_PREFLIGHT_PRNG / t : 0;
+
+} /* dwipe_preflight_prng */
+
+
+
+static int dwipe_preflight_probe( dwipe_context_t* c, double* slowest, double* fastest )
+{
+/**
+ * Reads a short sequential run at evenly spaced zones of the device, from the first to
+ * the last byte, and seeds the throughput profile with the rates. Each zone stands for
+ * the whole bucket that it falls in, so dwipe_profile_time() integrates over them like
+ * it does during a wipe. The reads bypass the page cache where the device allows it.
+ *
+ * @returns  0, or -1 if the device could not be read.
+ *
+ */
+
+	u64 bucket = dwipe_profile_bucket( c );
+
+	/* The bytes that are read at each zone, aligned for direct i/o. */
+	u64 length = DWIPE_KNOB_PREFLIGHT_READ;
+
+	loff_t start;
+	double rate;
+	double t;
+	ssize_t r;
+	size_t n;
+	u64 done;
+	char* b;
+	int fd;
+	int i;
+	int k;
+
+	if( length > (u64)c->device_size ) { length = c->device_size & ~(u64)4095; }
+
+	if( length == 0 )
+	{
+		dwipe_log( DWIPE_LOG_WARNING, "The device '%s' is too small to be probed.", c->device_name );
+		return -1;
+	}
+
+	/* A regular file on a filesystem without direct i/o is read through the cache. */
+	fd = open( c->device_name, O_RDONLY | O_DIRECT );
+	if( fd < 0 ) { fd = open( c->device_name, O_RDONLY ); }
+
+	if( fd < 0 )
+	{
+		dwipe_perror( errno, __FUNCTION__, "open" );
+		dwipe_log( DWIPE_LOG_WARNING, "Unable to open '%s' for the probe.", c->device_name );
+		return -1;
+	}
+
+	if( posix_memalign( (void**)&b, 4096, DWIPE_KNOB_PREFLIGHT_BLOCK ) != 0 )
+	{
+		dwipe_perror( errno, __FUNCTION__, "posix_memalign" );
+		close( fd );
+		return -1;
+	}
+
+	memset( &c->profile, 0, sizeof( c->profile ) );
+
+	*slowest = 0;
+	*fastest = 0;
+
+	for( k = 0 ; k < DWIPE_KNOB_PREFLIGHT_ZONES ; k++ )
+	{
+		start = ( ( c->device_size - length ) / ( DWIPE_KNOB_PREFLIGHT_ZONES - 1 ) * k ) & ~(loff_t)4095;
+
+		/* Drop cached pages so that a repeated plan reads the media again. */
+		posix_fadvise( fd, start, length, POSIX_FADV_DONTNEED );
+
+		t = dwipe_preflight_clock();
+
+		for( done = 0 ; done < length ; done += r )
+		{
+			n = length - done;
+
+			if( n > DWIPE_KNOB_PREFLIGHT_BLOCK ) { n = DWIPE_KNOB_PREFLIGHT_BLOCK; }
+
+			r = pread( fd, b, n, start + done );
+
+			if( r <= 0 )
+			{
+				dwipe_perror( errno, __FUNCTION__, "pread" );
+				dwipe_log( DWIPE_LOG_WARNING, "Unable to read '%s' at offset %llu.", c->device_name, (u64)( start + done ) );
+				free( b );
+				close( fd );
+				return -1;
+			}
+		}
+
+		t = dwipe_preflight_clock() - t;
+
+		/* A cached read can finish within the clock resolution. */
+		if( t < 1e-6 ) { t = 1e-6; }
+
+		rate = length / t;
+
+		if( *slowest == 0 || rate < *slowest ) { *slowest = rate; }
+		if( rate > *fastest ) { *fastest = rate; }
+
+		i = start / bucket;
+
+		c->profile.bytes[i] += bucket;
+		c->profile.usecs[i] += t * 1e6 * bucket / length + 1;
+
+		dwipe_log( DWIPE_LOG_INFO, "Read %llu MB/s from '%s' at offset %llu.", (u64)( rate / 1000000 ), c->device_name, (u64)start );
+	}
+
+	free( b );
+	close( fd );
+
+	return 0;
+
+} /* dwipe_preflight_probe */
+
+
+
+int dwipe_preflight( dwipe_context_t* c, int count )
+{
+/**
+ * Estimates the session time of each selected device without writing anything, and
+ * the makespan of the batch. The passes, rounds and verification are counted the way
+ * dwipe_runmethod() sizes round_size, with the metadata pre-pass and the offloads
+ * that the plan adds. Writes are assumed to run at the probed read rate, and random
+ * passes no faster than the PRNG. The devices run in parallel, but they share the
+ * CPUs that generate the random patterns.
+ *
+ * @parameter  c      The array of enumerated contexts.
+ * @parameter  count  The number of contexts in the array.
+ * @returns    0, or -1 if no selected device could be estimated.
+ *
+ */
+
+	/* A context that only runs the method far enough to list its patterns. */
+	dwipe_context_t probe;
+
+	/* The PRNG rate of one generator thread, which bounds the CPUs that all devices share. */
+	double rate = dwipe_preflight_prng();
+
+	/* The PRNG rate of one device, times its generator threads. */
+	double prng = rate;
+
+	/* The CPUs that the devices share for pattern generation. */
+	long cpus = sysconf( _SC_NPROCESSORS_ONLN );
+
+	double makespan = 0;
+	double generated = 0;
+	double slowest;
+	double fastest;
+	double sweep;
+	double random;
+	double offload;
+	double prepass;
+	double t;
+
+	char elapsed [32];
+	char size [32];
+	int estimated = 0;
+	int verified;
+	int finals;
+	int i;
+
+	if( cpus < 1 ) { cpus = 1; }
+
+	/* A device cannot run more generator threads at once than there are CPUs. */
+	if( dwipe_options.prng_threads > 0 ) { prng *= dwipe_options.prng_threads < cpus ? dwipe_options.prng_threads : cpus; }
+
+	memset( &probe, 0, sizeof( probe ) );
+	probe.device_name = "pass probe";
+
+	printf( "%-20s %10s %-10s %-24s %6s %-13s %-15s %10s\n", "Device", "Size", "Media", "Method", "Passes", "Read MB/s", "Offloads", "Estimate" );
+
+	for( i = 0 ; i < count ; i++ )
+	{
+		if( c[i].select != DWIPE_SELECT_TRUE ) { continue; }
+
+		/* The auto method picks a method for each device. */
+		dwipe_method_select( &c[i] );
+
+		if( dwipe_method_visit( c[i].method, &probe, dwipe_preflight_count ) < 0 )
+		{
+			dwipe_log( DWIPE_LOG_WARNING, "Unable to count the passes of '%s'.", dwipe_method_label( c[i].method ) );
+			continue;
+		}
+
+		if( dwipe_preflight_probe( &c[i], &slowest, &fastest ) < 0 )
+		{
+			printf( "%-20s %10s %s\n", c[i].device_name, "", "unreadable, not estimated" );
+			continue;
+		}
+
+		/* One sweep of the device at the probed rates. */
+		sweep = dwipe_profile_time( &c[i], 0, c[i].device_size );
+
+		/* A random sweep is also limited by the PRNG. */
+		random = sweep;
+
+		if( prng > 0 && c[i].device_size / prng > random ) { random = c[i].device_size / prng; }
+
+		/* Every pass of every round, and its read back if all passes are verified. */
+		verified = dwipe_options.verify == DWIPE_VERIFY_ALL ? 2 : 1;
+
+		t = dwipe_options.rounds * ( dwipe_preflight_randoms * random + dwipe_preflight_statics * sweep ) * verified;
+		generated += (double)c[i].device_size * dwipe_options.rounds * dwipe_preflight_randoms * verified;
+
+		/* The final pass is a zero fill, except ops2 which is random, and it is read back unless verification is off. */
+		finals = dwipe_options.verify == DWIPE_VERIFY_LAST || dwipe_options.verify == DWIPE_VERIFY_ALL ? 2 : 1;
+
+		/* A flash device runs its offloads without touching every cell, but a disk */
+		/* still has to turn under every sector to zero it.                         */
+		offload = c[i].media == DWIPE_MEDIA_DISK ? sweep : (double)c[i].device_size / DWIPE_KNOB_PREFLIGHT_OFFLOAD;
+
+		if( c[i].method == &dwipe_ops2 )
+		{
+			t += finals * random;
+			generated += (double)c[i].device_size * finals;
+		}
+
+		else if( c[i].plan_flags & DWIPE_PLAN_ZEROOUT )
+		{
+			/* The device blanks itself, and only the read back moves data. */
+			t += offload + ( finals - 1 ) * sweep;
+		}
+
+		else
+		{
+			t += finals * sweep;
+		}
+
+		if( c[i].plan_flags & DWIPE_PLAN_DISCARD )
+		{
+			t += (double)c[i].device_size / DWIPE_KNOB_PREFLIGHT_OFFLOAD;
+		}
+
+		if( dwipe_options.prepass )
+		{
+			/* The probe reads the partition tables and superblocks, but writes nothing. */
+			prepass = dwipe_metadata_time( &c[i] );
+
+			if( prepass > 0 ) { t += prepass; }
+		}
+
+		if( t > makespan ) { makespan = t; }
+
+		dwipe_preflight_format( elapsed, sizeof( elapsed ), t );
+		snprintf( size, sizeof( size ), "%.1f GB", c[i].device_size / 1e9 );
+
+		printf( "%-20s %10s %-10s %-24s %6i %5llu-%-7llu %-15s %10s\n", c[i].device_name, size, dwipe_media_label( c[i].media ), \
+		  dwipe_method_label( c[i].method ), ( dwipe_preflight_randoms + dwipe_preflight_statics ) * dwipe_options.rounds + 1, \
+		  (u64)( slowest / 1000000 ), (u64)( fastest / 1000000 ), \
+		  ( c[i].plan_flags & DWIPE_PLAN_DISCARD ) && ( c[i].plan_flags & DWIPE_PLAN_ZEROOUT ) ? "discard,zeroout" \
+		  : c[i].plan_flags & DWIPE_PLAN_DISCARD ? "discard" : c[i].plan_flags & DWIPE_PLAN_ZEROOUT ? "zeroout" : "none", \
+		  elapsed );
+
+		dwipe_log( DWIPE_LOG_NOTICE, "The plan for '%s' is %s with %i passes in %s.", c[i].device_name, dwipe_method_label( c[i].method ), \
+		  ( dwipe_preflight_randoms + dwipe_preflight_statics ) * dwipe_options.rounds + 1, elapsed );
+
+		estimated += 1;
+	}
+
+	if( estimated == 0 )
+	{
+		printf( "No device could be estimated.\n" );
+		return -1;
+	}
+
+	if( rate > 0 && generated / ( rate * cpus ) > makespan )
+	{
+		/* The CPUs cannot generate the random passes of all devices in time. */
+		makespan = generated / ( rate * cpus );
+		dwipe_preflight_format( elapsed, sizeof( elapsed ), makespan );
+		printf( "Makespan: %s for %i devices, bound by the %s PRNG on %li CPUs.\n", elapsed, estimated, dwipe_options.prng->label, cpus );
+	}
+
+	else
+	{
+		dwipe_preflight_format( elapsed, sizeof( elapsed ), makespan );
+		printf( "Makespan: %s for %i devices.\n", elapsed, estimated );
+	}
+
+	dwipe_log( DWIPE_LOG_NOTICE, "The estimated makespan of %i devices is %s.", estimated, elapsed );
+
+	return 0;
+
+} /* dwipe_preflight */
+
+/* eof */
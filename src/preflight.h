@@ -0,0 +1,34 @@
+/*
+ *  preflight.h: Estimates of the session time per device, without writing.
+ *
+ *  Copyright Paolo Iannelli <info@paoloiannelli.com>.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc., 675 Mass
+ *  Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#ifndef PREFLIGHT_H_
+#define PREFLIGHT_H_
+
+#define DWIPE_KNOB_PREFLIGHT_ZONES        8                   /* The number of LBA zones that are read.     */
+#define DWIPE_KNOB_PREFLIGHT_READ         67108864            /* The bytes read sequentially at each zone.  */
+#define DWIPE_KNOB_PREFLIGHT_BLOCK        1048576             /* The size of each read.                     */
+#define DWIPE_KNOB_PREFLIGHT_PRNG         67108864            /* The bytes generated to time the PRNG.      */
+#define DWIPE_KNOB_PREFLIGHT_OFFLOAD      4000000000ULL       /* The assumed rate of a flash offload, B/s.  */
+
+int dwipe_preflight( dwipe_context_t* c, int count );
+
+#endif /* PREFLIGHT_H_ */
+
+/* eof */
@@ -24,54 +24,232 @@
 
 #include "mt19937ar-cok.h"
 #include "isaac_rand.h"
+#include "sfmt.h"
+#include "aes.h"
+#include "chacha.h"
+#include "xoshiro.h"
+#include "philox.h"
+#include "cpu.h"
+
+/* The twister state, and the block of output that a short read split. */
+typedef struct dwipe_twister_state_t_
+{
+	twister_state_t mt;
+	uint32_t        stream[N];  /* One block of tempered 32-bit output.                  */
+	size_t          left;       /* The number of unread bytes at the end of stream.      */
+} dwipe_twister_state_t;
+
+#define DWIPE_TWISTER_BLOCK ( N * sizeof( uint32_t ) )
+
+/* Apart from the twister, every generator already writes whole blocks straight into */
+/* the buffer when it is read, so its read function is also its bulk fill.           */
 
 dwipe_prng_t dwipe_twister =
 {
 	"Mersenne Twister (mt19937ar-cok)",
 	dwipe_twister_init,
-	dwipe_twister_read
+	dwipe_twister_read,
+	NULL,
+	dwipe_twister_fill,
+	DWIPE_PRNG_PARALLEL,
+	DWIPE_TWISTER_BLOCK
 };
 
 dwipe_prng_t dwipe_isaac =
 {
 	"ISAAC (rand.c 20010626)",
 	dwipe_isaac_init,
-	dwipe_isaac_read
+	dwipe_isaac_read,
+	NULL,
+	dwipe_isaac_read,
+	DWIPE_PRNG_PARALLEL,
+	sizeof( ( (randctx*)0 )->randrsl )
+};
+
+dwipe_prng_t dwipe_sfmt =
+{
+#ifdef __SSE2__
+	"SIMD-oriented Fast Mersenne Twister (SFMT19937, SSE2)",
+#else
+	"SIMD-oriented Fast Mersenne Twister (SFMT19937)",
+#endif
+	dwipe_sfmt_init,
+	dwipe_sfmt_read,
+	NULL,
+	dwipe_sfmt_read,
+	DWIPE_PRNG_PARALLEL,
+	SFMT_N32 * sizeof( uint32_t )
+};
+
+dwipe_prng_t dwipe_aes_ctr =
+{
+	"AES-256 in counter mode (AES-CTR)",
+	dwipe_aes_ctr_init,
+	dwipe_aes_ctr_read,
+	dwipe_aes_ctr_seek,
+	dwipe_aes_ctr_read,
+	DWIPE_PRNG_SEEKABLE | DWIPE_PRNG_PARALLEL,
+	AES_BLOCK_SIZE * AES_PARALLEL
+};
+
+dwipe_prng_t dwipe_chacha20 =
+{
+	"ChaCha20",
+	dwipe_chacha20_init,
+	dwipe_chacha20_read,
+	dwipe_chacha20_seek,
+	dwipe_chacha20_read,
+	DWIPE_PRNG_SEEKABLE | DWIPE_PRNG_PARALLEL,
+	CHACHA_BLOCK_SIZE * 16
 };
 
+dwipe_prng_t dwipe_philox =
+{
+	"Philox4x32-10 (counter-based)",
+	dwipe_philox_init,
+	dwipe_philox_read,
+	dwipe_philox_seek,
+	dwipe_philox_read,
+	DWIPE_PRNG_SEEKABLE | DWIPE_PRNG_PARALLEL,
+	PHILOX_STEP
+};
+
+dwipe_prng_t dwipe_xoshiro =
+{
+	"xoshiro256++ (8 lanes, not cryptographic)",
+	dwipe_xoshiro_init,
+	dwipe_xoshiro_read,
+	NULL,
+	dwipe_xoshiro_read,
+	DWIPE_PRNG_PARALLEL,
+	XOSHIRO_STEP
+};
+
+
+
+dwipe_prng_t* dwipe_prng_default( void )
+{
+	/* AES-CTR is both the strongest and the fastest generator when the CPU has AES-NI. */
+	return aes_hardware() ? &dwipe_aes_ctr : &dwipe_twister;
+}
+
+int dwipe_prng_fill( dwipe_prng_t* prng, void** state, void* buffer, size_t count )
+{
+	if( prng->fill != NULL && count % sizeof( u64 ) == 0 && (uintptr_t)buffer % sizeof( u64 ) == 0 )
+	{
+		return prng->fill( state, buffer, count );
+	}
+
+	return prng->read( state, buffer, count );
+}
+
+const char* dwipe_prng_variant( dwipe_prng_t* prng )
+{
+	/* These follow the same dwipe_cpu_level() tests that the generators make in their init. */
+	if( prng == &dwipe_aes_ctr ) { return aes_hardware() ? "aes-ni" : "generic"; }
+	if( prng == &dwipe_chacha20 ) { return dwipe_cpu_label( dwipe_cpu_level() ); }
+
+	if( prng == &dwipe_philox || prng == &dwipe_xoshiro )
+	{
+		return dwipe_cpu_level() >= DWIPE_CPU_AVX2 ? "avx2" : "generic";
+	}
+
+#ifdef __SSE2__
+	/* SFMT is built for SSE2 at compile time. */
+	if( prng == &dwipe_sfmt ) { return "sse2"; }
+#endif
+
+	return "generic";
+}
+
 
 
 int dwipe_twister_init( DWIPE_PRNG_INIT_SIGNATURE )
 {
+	dwipe_twister_state_t* t = *state;
+
 	if( *state == NULL )
 	{
 		/* This is the first time that we have been called. */
-		*state = malloc( sizeof( twister_state_t ) );
+		*state = malloc( sizeof( dwipe_twister_state_t ) );
+		t = *state;
+
+		if( t == NULL )
+		{
+			dwipe_perror( errno, __FUNCTION__, "malloc" );
+			dwipe_log( DWIPE_LOG_FATAL, "Unable to allocate memory for the twister state." );
+			return -1;
+		}
 	}
-	twister_init( (twister_state_t*)*state, (u32*)( seed->s ), seed->length / sizeof( u32 ) );
+
+	twister_init( &t->mt, (u32*)( seed->s ), seed->length / sizeof( u32 ) );
+	t->left = 0;
+
 	return 0;
 }
 
 int dwipe_twister_read( DWIPE_PRNG_READ_SIGNATURE )
 {
-	u32 ii;
-	u32 words = count / sizeof( u32 );
-	u32 remain = count % sizeof( u32 );
+	dwipe_twister_state_t* t = *state;
+	u8* b = buffer;
+	size_t n;
+
+	/* Drain the output that is left over from the last call. */
+	n = count < t->left ? count : t->left;
+	memcpy( b, (u8*)t->stream + sizeof( t->stream ) - t->left, n );
+	t->left -= n;
+	b += n;
+	count -= n;
 
-	/* Twister returns 4-bytes per call, so cast the buffer into words. */
-	for( ii = 0; ii < words; ++ii )
+	while( count > 0 )
 	{
-		((u32*)buffer)[ii] = twister_genrand_int32( (twister_state_t*)*state );
+		if( count >= sizeof( t->stream ) && (uintptr_t)b % sizeof( uint32_t ) == 0 )
+		{
+			/* Temper a whole block straight into the buffer. */
+			twister_genrand_block( &t->mt, (uint32_t*)b );
+			n = sizeof( t->stream );
+		}
+
+		else
+		{
+			/* Every output word is used, and the rest of the block is kept for the next call. */
+			twister_genrand_block( &t->mt, t->stream );
+			n = count < sizeof( t->stream ) ? count : sizeof( t->stream );
+			memcpy( b, t->stream, n );
+			t->left = sizeof( t->stream ) - n;
+		}
+
+		b += n;
+		count -= n;
 	}
 
-	/* Fill the buffer tail if the count is not evenly divided by the size of u32. */
-	for( ii = 1; ii <= remain; ++ii )
+	return 0;
+}
+
+int dwipe_twister_fill( DWIPE_PRNG_FILL_SIGNATURE )
+{
+	dwipe_twister_state_t* t = *state;
+	u8* b = buffer;
+	size_t n;
+
+	/* Drain the output that is left over from the last call. */
+	n = count < t->left ? count : t->left;
+	dwipe_twister_read( state, b, n );
+	b += n;
+	count -= n;
+
+	/* A short read before can leave the stream off a 64-bit word, which read handles. */
+	if( (uintptr_t)b % sizeof( uint64_t ) != 0 ) { return dwipe_twister_read( state, b, count ); }
+
+	for( ; count >= sizeof( t->stream ) ; count -= sizeof( t->stream ) )
 	{
-		/* Notice how three bytes are discarded by doing this. */
-		((u8*)buffer)[count-ii] = twister_genrand_int32( (twister_state_t*)*state );
+		/* Temper whole blocks straight into the buffer, two words at a time. */
+		twister_genrand_block64( &t->mt, (uint64_t*)b );
+		b += sizeof( t->stream );
 	}
-	 
-	return 0;
+
+	/* The rest of the last block is kept in the stream for the next call. */
+	return dwipe_twister_read( state, b, count );
 }
 
 
@@ -122,11 +300,268 @@ int dwipe_isaac_init( DWIPE_PRNG_INIT_SIGNATURE )
 		randinit( isaac_state, 1 );
 	}
 
+	/* randinit() leaves a fresh result block, and dwipe_isaac_read counts its unread bytes in randcnt. */
+	isaac_state->randcnt = sizeof( isaac_state->randrsl );
+
 	return 0;
 }
 
 int dwipe_isaac_read( DWIPE_PRNG_READ_SIGNATURE )
 {
+	randctx* isaac_state = *state;
+	u8* b = buffer;
+	size_t n;
+
+	while( count > 0 )
+	{
+		if( isaac_state->randcnt == 0 )
+		{
+			/* Generate the next RANDSIZ words of output in one go. */
+			isaac( isaac_state );
+			isaac_state->randcnt = sizeof( isaac_state->randrsl );
+		}
+
+		/* Copy whole result blocks, and keep any unread tail for the next call, */
+		/* so that the stream does not depend on how the caller splits its reads. */
+		n = count < isaac_state->randcnt ? count : isaac_state->randcnt;
+
+		memcpy( b, (u8*)isaac_state->randrsl + sizeof( isaac_state->randrsl ) - isaac_state->randcnt, n );
+
+		isaac_state->randcnt -= n;
+		b += n;
+		count -= n;
+	}
+
+	return 0;
+}
+
+
+
+int dwipe_sfmt_init( DWIPE_PRNG_INIT_SIGNATURE )
+{
+	/* The key is read as 32-bit words, because u32 is wider on 64-bit machines. */
+	uint32_t key [SFMT_N32];
+	int length;
+
+	if( *state == NULL )
+	{
+		/* This is the first time that we have been called. The SSE2 path needs 16-byte alignment. */
+		if( posix_memalign( state, 16, sizeof( sfmt_state_t ) ) != 0 )
+		{
+			*state = NULL;
+			dwipe_perror( errno, __FUNCTION__, "posix_memalign" );
+			dwipe_log( DWIPE_LOG_FATAL, "Unable to allocate memory for the sfmt state." );
+			return -1;
+		}
+	}
+
+	/* Take the minimum of the state size and available entropy. */
+	length = seed->length / sizeof( uint32_t );
+
+	if( length > SFMT_N32 )
+	{
+		length = SFMT_N32;
+	}
+
+	memcpy( key, seed->s, length * sizeof( uint32_t ) );
+	sfmt_init_by_array( (sfmt_state_t*)*state, key, length );
+
+	return 0;
+}
+
+int dwipe_sfmt_read( DWIPE_PRNG_READ_SIGNATURE )
+{
+	sfmt_state_t* sfmt = *state;
+	u8* b = buffer;
+	size_t n;
+
+	while( count > 0 )
+	{
+		if( sfmt->left == 0 )
+		{
+			/* Generate the next SFMT_N32 words of output in one go. */
+			sfmt_gen_rand_all( sfmt );
+			sfmt->left = sizeof( sfmt->state );
+		}
+
+		/* Keep any unread tail of the block for the next call. */
+		n = count < sfmt->left ? count : sfmt->left;
+
+		memcpy( b, (u8*)sfmt->state + sizeof( sfmt->state ) - sfmt->left, n );
+
+		sfmt->left -= n;
+		b += n;
+		count -= n;
+	}
+
+	return 0;
+}
+
+
+
+int dwipe_aes_ctr_init( DWIPE_PRNG_INIT_SIGNATURE )
+{
+	uint8_t key [32] = { 0 };
+	uint8_t iv [AES_BLOCK_SIZE] = { 0 };
+	size_t key_length;
+	size_t n;
+
+	if( *state == NULL )
+	{
+		/* This is the first time that we have been called. The round keys need 16-byte alignment. */
+		if( posix_memalign( state, 16, sizeof( aes_ctr_state_t ) ) != 0 )
+		{
+			*state = NULL;
+			dwipe_perror( errno, __FUNCTION__, "posix_memalign" );
+			dwipe_log( DWIPE_LOG_FATAL, "Unable to allocate memory for the aes state." );
+			return -1;
+		}
+	}
+
+	/* Use AES-256 when the seed has room for its key and a counter block, and AES-128 otherwise. */
+	key_length = seed->length >= sizeof( key ) + sizeof( iv ) ? sizeof( key ) : 16;
+
+	n = seed->length < key_length ? seed->length : key_length;
+	memcpy( key, seed->s, n );
+
+	if( seed->length > key_length )
+	{
+		n = seed->length - key_length < sizeof( iv ) ? seed->length - key_length : sizeof( iv );
+		memcpy( iv, seed->s + key_length, n );
+	}
+
+	aes_ctr_init( (aes_ctr_state_t*)*state, key, key_length, iv );
+
+	if( ! ( (aes_ctr_state_t*)*state )->hardware )
+	{
+		dwipe_log( DWIPE_LOG_WARNING, "This CPU lacks AES-NI, so AES-CTR uses the slow constant-time software cipher." );
+	}
+
+	/* Do not leave the key on the stack. */
+	memset( key, 0, sizeof( key ) );
+
+	return 0;
+}
+
+int dwipe_aes_ctr_read( DWIPE_PRNG_READ_SIGNATURE )
+{
+	aes_ctr_read( (aes_ctr_state_t*)*state, buffer, count );
+	return 0;
+}
+
+int dwipe_aes_ctr_seek( DWIPE_PRNG_SEEK_SIGNATURE )
+{
+	aes_ctr_seek( (aes_ctr_state_t*)*state, offset );
+	return 0;
+}
+
+
+
+int dwipe_chacha20_init( DWIPE_PRNG_INIT_SIGNATURE )
+{
+	uint8_t key [CHACHA_KEY_SIZE + CHACHA_NONCE_SIZE] = { 0 };
+
+	if( *state == NULL )
+	{
+		/* This is the first time that we have been called. */
+		*state = malloc( sizeof( chacha_state_t ) );
+
+		if( *state == NULL )
+		{
+			dwipe_perror( errno, __FUNCTION__, "malloc" );
+			dwipe_log( DWIPE_LOG_FATAL, "Unable to allocate memory for the chacha20 state." );
+			return -1;
+		}
+	}
+
+	/* The key and then the nonce come from the start of the seed. */
+	memcpy( key, seed->s, seed->length < sizeof( key ) ? seed->length : sizeof( key ) );
+
+	chacha_init( (chacha_state_t*)*state, key, key + CHACHA_KEY_SIZE );
+
+	/* Do not leave the key on the stack. */
+	memset( key, 0, sizeof( key ) );
+
+	return 0;
+}
+
+int dwipe_chacha20_read( DWIPE_PRNG_READ_SIGNATURE )
+{
+	chacha_read( (chacha_state_t*)*state, buffer, count );
+	return 0;
+}
+
+int dwipe_chacha20_seek( DWIPE_PRNG_SEEK_SIGNATURE )
+{
+	chacha_seek( (chacha_state_t*)*state, offset );
+	return 0;
+}
+
+
+
+int dwipe_xoshiro_init( DWIPE_PRNG_INIT_SIGNATURE )
+{
+	if( *state == NULL )
+	{
+		/* This is the first time that we have been called. The lane vectors need 32-byte alignment. */
+		if( posix_memalign( state, 32, sizeof( xoshiro_state_t ) ) != 0 )
+		{
+			*state = NULL;
+			dwipe_perror( errno, __FUNCTION__, "posix_memalign" );
+			dwipe_log( DWIPE_LOG_FATAL, "Unable to allocate memory for the xoshiro state." );
+			return -1;
+		}
+	}
+
+	xoshiro_init( (xoshiro_state_t*)*state, seed->s, seed->length );
+	return 0;
+}
+
+int dwipe_xoshiro_read( DWIPE_PRNG_READ_SIGNATURE )
+{
+	xoshiro_read( (xoshiro_state_t*)*state, buffer, count );
+	return 0;
+}
+
+
+
+int dwipe_philox_init( DWIPE_PRNG_INIT_SIGNATURE )
+{
+	uint8_t key [16] = { 0 };
+
+	if( *state == NULL )
+	{
+		/* This is the first time that we have been called. */
+		*state = malloc( sizeof( philox_state_t ) );
+
+		if( *state == NULL )
+		{
+			dwipe_perror( errno, __FUNCTION__, "malloc" );
+			dwipe_log( DWIPE_LOG_FATAL, "Unable to allocate memory for the philox state." );
+			return -1;
+		}
+	}
+
+	/* The key and then the high half of the counter come from the start of the seed. */
+	memcpy( key, seed->s, seed->length < sizeof( key ) ? seed->length : sizeof( key ) );
+
+	philox_init( (philox_state_t*)*state, key, key + 8 );
+
+	/* Do not leave the key on the stack. */
+	memset( key, 0, sizeof( key ) );
+
+	return 0;
+}
+
+int dwipe_philox_read( DWIPE_PRNG_READ_SIGNATURE )
+{
+	philox_read( (philox_state_t*)*state, buffer, count );
+	return 0;
+}
+
+int dwipe_philox_seek( DWIPE_PRNG_SEEK_SIGNATURE )
+{
+	philox_seek( (philox_state_t*)*state, offset );
 	return 0;
 }
 
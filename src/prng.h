@@ -30,10 +30,18 @@ typedef struct /* dwipe_entropy_t */
 
 #define DWIPE_PRNG_INIT_SIGNATURE void** state, dwipe_entropy_t* seed
 #define DWIPE_PRNG_READ_SIGNATURE void** state, void* buffer, size_t count
+#define DWIPE_PRNG_SEEK_SIGNATURE void** state, u64 offset
+#define DWIPE_PRNG_FILL_SIGNATURE void** state, void* buffer, size_t count
+
+/* PRNG capability flags. */
+#define DWIPE_PRNG_SEEKABLE  0x01  /* seek() reaches any byte offset of the stream directly.      */
+#define DWIPE_PRNG_PARALLEL  0x02  /* States share nothing, so substreams can run on threads.     */
 
 /* Function pointers for PRNG actions. */
 typedef int(*dwipe_prng_init_t)( DWIPE_PRNG_INIT_SIGNATURE );
 typedef int(*dwipe_prng_read_t)( DWIPE_PRNG_READ_SIGNATURE );
+typedef int(*dwipe_prng_seek_t)( DWIPE_PRNG_SEEK_SIGNATURE );
+typedef int(*dwipe_prng_fill_t)( DWIPE_PRNG_FILL_SIGNATURE );
 
 /* The generic PRNG definition. */
 typedef struct /* dwipe_prng_t */
@@ -41,16 +49,53 @@ typedef struct /* dwipe_prng_t */
 	const char*       label;  /* The name of the pseudo random number generator. */
 	dwipe_prng_init_t init;   /* Inialize the prng state with the seed.          */
 	dwipe_prng_read_t read;   /* Read data from the prng.                        */
+	dwipe_prng_seek_t seek;   /* Move to a byte offset of the stream, or NULL.   */
+	dwipe_prng_fill_t fill;   /* Write whole words into a word-aligned buffer.   */
+	int               flags;  /* The DWIPE_PRNG_* capability flags.              */
+	size_t            block;  /* The bytes that one step of the generator makes. */
 } dwipe_prng_t;
 
 /* Mersenne Twister prototypes. */
 int dwipe_twister_init( DWIPE_PRNG_INIT_SIGNATURE );
 int dwipe_twister_read( DWIPE_PRNG_READ_SIGNATURE );
+int dwipe_twister_fill( DWIPE_PRNG_FILL_SIGNATURE );
 
 /* ISAAC prototypes. */
 int dwipe_isaac_init( DWIPE_PRNG_INIT_SIGNATURE );
 int dwipe_isaac_read( DWIPE_PRNG_READ_SIGNATURE );
 
+/* SFMT prototypes. */
+int dwipe_sfmt_init( DWIPE_PRNG_INIT_SIGNATURE );
+int dwipe_sfmt_read( DWIPE_PRNG_READ_SIGNATURE );
+
+/* AES-CTR prototypes. */
+int dwipe_aes_ctr_init( DWIPE_PRNG_INIT_SIGNATURE );
+int dwipe_aes_ctr_read( DWIPE_PRNG_READ_SIGNATURE );
+int dwipe_aes_ctr_seek( DWIPE_PRNG_SEEK_SIGNATURE );
+
+/* ChaCha20 prototypes. */
+int dwipe_chacha20_init( DWIPE_PRNG_INIT_SIGNATURE );
+int dwipe_chacha20_read( DWIPE_PRNG_READ_SIGNATURE );
+int dwipe_chacha20_seek( DWIPE_PRNG_SEEK_SIGNATURE );
+
+/* xoshiro256++ prototypes. */
+int dwipe_xoshiro_init( DWIPE_PRNG_INIT_SIGNATURE );
+int dwipe_xoshiro_read( DWIPE_PRNG_READ_SIGNATURE );
+
+/* Philox4x32-10 prototypes. */
+int dwipe_philox_init( DWIPE_PRNG_INIT_SIGNATURE );
+int dwipe_philox_read( DWIPE_PRNG_READ_SIGNATURE );
+int dwipe_philox_seek( DWIPE_PRNG_SEEK_SIGNATURE );
+
+/* Returns the fastest strong PRNG that this CPU supports. */
+dwipe_prng_t* dwipe_prng_default( void );
+
+/* Generates count bytes with the bulk fill when they are whole words, and with read otherwise. */
+int dwipe_prng_fill( dwipe_prng_t* prng, void** state, void* buffer, size_t count );
+
+/* Returns the name of the instruction set variant that the PRNG runs on this CPU. */
+const char* dwipe_prng_variant( dwipe_prng_t* prng );
+
 #endif /* PRNG_H_ */
 
 /* eof */
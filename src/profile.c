@@ -0,0 +1,244 @@
+/*
+ *  profile.c: Throughput profiles and the estimated time to completion.
+ *
+ *  Copyright Paolo Iannelli <info@paoloiannelli.com>.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc., 675 Mass
+ *  Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include "dwipe.h"
+#include "context.h"
+#include "profile.h"
+
+
+
+static u64 dwipe_profile_clock( void )
+{
+/**
+ * Returns a monotonic time in microseconds.
+ *
+ */
+
+	struct timespec t;
+
+	clock_gettime( CLOCK_MONOTONIC, &t );
+
+	return (u64)t.tv_sec * 1000000 + t.tv_nsec / 1000;
+
+} /* dwipe_profile_clock */
+
+
+
+u64 dwipe_profile_bucket( dwipe_context_t* c )
+{
+/**
+ * Returns the length of the LBA range that each profile bucket covers.
+ *
+ */
+
+	u64 b = ( c->device_size + DWIPE_KNOB_PROFILE_BUCKETS - 1 ) / DWIPE_KNOB_PROFILE_BUCKETS;
+
+	return b > 0 ? b : 1;
+
+} /* dwipe_profile_bucket */
+
+
+
+void dwipe_profile_sample( dwipe_context_t* c, loff_t offset, u64 length )
+{
+/**
+ * Charges the time since the last sample to the block at offset, split across the
+ * buckets that it covers. The child calls this after each block, and the parent reads
+ * the buckets from the shared context. All of the time is charged, including the
+ * pattern generation and the flush at the end of each pass, so that the buckets add
+ * up to the wall time of the method.
+ *
+ */
+
+	dwipe_profile_t* p = &c->profile;
+
+	u64 b = dwipe_profile_bucket( c );
+
+	u64 now = dwipe_profile_clock();
+
+	/* The time that the block took. */
+	u64 t = now - p->last;
+
+	/* The end of the part of the block in the current bucket. */
+	loff_t end;
+
+	u64 i;
+
+	/* The first block has no start time, so it only starts the clock. */
+	if( p->last == 0 ) { length = 0; }
+
+	p->last = now;
+
+	for( ; length > 0 ; length -= end - offset, offset = end )
+	{
+		i = offset / b;
+
+		if( i >= DWIPE_KNOB_PROFILE_BUCKETS ) { break; }
+
+		end = ( i + 1 ) * b;
+
+		if( end > offset + length ) { end = offset + length; }
+
+		p->bytes[i] += end - offset;
+		p->usecs[i] += t * ( end - offset ) / length;
+
+		/* The rest of the time belongs to the rest of the block. */
+		t -= t * ( end - offset ) / length;
+	}
+
+} /* dwipe_profile_sample */
+
+
+
+u64 dwipe_profile_throughput( dwipe_context_t* c, int i )
+{
+/**
+ * Returns the measured throughput of bucket i in bytes per second, or 0 until a pass
+ * has covered the whole bucket.
+ *
+ */
+
+	dwipe_profile_t* p = &c->profile;
+
+	if( i < 0 || i >= DWIPE_KNOB_PROFILE_BUCKETS || p->bytes[i] < dwipe_profile_bucket( c ) || p->usecs[i] == 0 )
+	{
+		return 0;
+	}
+
+	return (double)p->bytes[i] * 1000000 / p->usecs[i];
+
+} /* dwipe_profile_throughput */
+
+
+
+static double dwipe_profile_cost( dwipe_context_t* c, int i )
+{
+/**
+ * Returns the seconds per byte in bucket i. A bucket without samples borrows the
+ * nearest measured bucket, preferring the one before it, because a pass has just
+ * come from there.
+ *
+ * @returns  The cost, or 0 if no bucket has been measured.
+ *
+ */
+
+	int d;
+
+	u64 r;
+
+	for( d = 0 ; d < DWIPE_KNOB_PROFILE_BUCKETS ; d++ )
+	{
+		if( ( r = dwipe_profile_throughput( c, i - d ) ) > 0 ) { return 1.0 / r; }
+		if( ( r = dwipe_profile_throughput( c, i + d ) ) > 0 ) { return 1.0 / r; }
+	}
+
+	return 0;
+
+} /* dwipe_profile_cost */
+
+
+
+double dwipe_profile_time( dwipe_context_t* c, loff_t from, loff_t to )
+{
+/**
+ * Integrates the profile over the device range [from, to).
+ *
+ * @returns  The seconds that one sweep of the range takes.
+ *
+ */
+
+	u64 b = dwipe_profile_bucket( c );
+
+	double s = 0;
+
+	loff_t end;
+
+	while( from < to )
+	{
+		end = ( from / b + 1 ) * b;
+
+		if( end > to ) { end = to; }
+
+		s += ( end - from ) * dwipe_profile_cost( c, from / b );
+
+		from = end;
+	}
+
+	return s;
+
+} /* dwipe_profile_time */
+
+
+
+u64 dwipe_profile_eta( dwipe_context_t* c )
+{
+/**
+ * Estimates the seconds until the method completes by integrating the remaining work
+ * of every pass and round over the throughput profile, so that the slow inner tracks
+ * of a disk are charged at their own rate. Falls back to the rolling average until
+ * the profile has a measured bucket.
+ *
+ */
+
+	/* The bytes of i/o that are left across all passes and rounds. */
+	u64 remaining;
+
+	/* The position in the current sweep of the device. */
+	loff_t p;
+
+	double s;
+
+	if( c->round_done >= c->round_size || c->device_size <= 0 ) { return 0; }
+
+	remaining = c->round_size - c->round_done;
+
+	if( dwipe_profile_cost( c, 0 ) == 0 )
+	{
+		return c->throughput > 0 ? remaining / c->throughput : 0;
+	}
+
+	if( c->chunk_length < c->device_size && c->chunk_start < c->device_size )
+	{
+		/* Every remaining pass covers the chunks from the current one to the end. */
+		s = remaining * dwipe_profile_time( c, c->chunk_start, c->device_size ) / ( c->device_size - c->chunk_start );
+	}
+
+	else
+	{
+		/* The passes sweep the whole device in turn, so finish this sweep first. */
+		p = c->round_done % c->device_size;
+
+		if( remaining <= c->device_size - p )
+		{
+			s = dwipe_profile_time( c, p, p + remaining );
+		}
+
+		else
+		{
+			s = dwipe_profile_time( c, p, c->device_size );
+			s += ( remaining - ( c->device_size - p ) ) * dwipe_profile_time( c, 0, c->device_size ) / c->device_size;
+		}
+	}
+
+	return s;
+
+} /* dwipe_profile_eta */
+
+/* eof */
@@ -0,0 +1,32 @@
+/*
+ *  profile.h: Throughput profiles and the estimated time to completion.
+ *
+ *  Copyright Paolo Iannelli <info@paoloiannelli.com>.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc., 675 Mass
+ *  Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+u64  dwipe_profile_bucket( dwipe_context_t* c );
+void dwipe_profile_sample( dwipe_context_t* c, loff_t offset, u64 length );
+u64  dwipe_profile_throughput( dwipe_context_t* c, int i );
+double dwipe_profile_time( dwipe_context_t* c, loff_t from, loff_t to );
+u64  dwipe_profile_eta( dwipe_context_t* c );
+
+#endif /* PROFILE_H_ */
+
+/* eof */
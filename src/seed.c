@@ -0,0 +1,358 @@
+/*
+ *  seed.c: The master seed and the seed derivation tree.
+ *
+ *  Copyright Paolo Iannelli <info@paoloiannelli.com>.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc., 675 Mass
+ *  Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include "dwipe.h"
+#include "context.h"
+#include "method.h"
+#include "prng.h"
+#include "backend.h"
+#include "options.h"
+#include "seed.h"
+#include "chacha.h"
+#include "logging.h"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+/* The master seed, which every device key and pass seed is derived from. */
+static u8 dwipe_seed_master [DWIPE_KNOB_SEED_LENGTH];
+
+/* The seal is taken this far into the keystream, well clear of any seed bytes. */
+#define DWIPE_SEED_SEAL_OFFSET  ( 1ULL << 40 )
+
+const char* dwipe_seed_source = "Linux Kernel (getrandom)";
+
+
+
+static void dwipe_seed_chacha( const u8* key, const u8* nonce, u64 offset, void* out, size_t length )
+{
+/**
+ * Writes ChaCha20 keystream, which is the pseudorandom function of the derivation tree.
+ *
+ */
+
+	chacha_state_t chacha;
+
+	chacha_init( &chacha, key, nonce );
+
+	if( offset > 0 ) { chacha_seek( &chacha, offset ); }
+
+	chacha_read( &chacha, out, length );
+
+	/* Do not leave the key schedule on the stack. */
+	memset( &chacha, 0, sizeof( chacha ) );
+
+} /* dwipe_seed_chacha */
+
+
+static void dwipe_seed_nonce( u8* nonce, int domain, u32 round, u32 pass )
+{
+	/* The pass in bytes 0-3, the round in bytes 4-6 and the domain in byte 7. */
+	nonce[0] = pass;
+	nonce[1] = pass >> 8;
+	nonce[2] = pass >> 16;
+	nonce[3] = pass >> 24;
+	nonce[4] = round;
+	nonce[5] = round >> 8;
+	nonce[6] = round >> 16;
+	nonce[7] = domain;
+
+} /* dwipe_seed_nonce */
+
+
+static int dwipe_seed_entropy( u8* out, size_t length )
+{
+/**
+ * Draws the master seed from the kernel, using the entropy device only on kernels without getrandom().
+ *
+ */
+
+	ssize_t r = -1;
+	int fd;
+
+#ifdef SYS_getrandom
+	r = syscall( SYS_getrandom, out, length, 0 );
+
+	if( r == length ) { return 0; }
+
+	if( r < 0 && errno != ENOSYS )
+	{
+		dwipe_perror( errno, __FUNCTION__, "getrandom" );
+		return -1;
+	}
+#endif
+
+	dwipe_seed_source = "Linux Kernel (urandom)";
+
+	fd = open( DWIPE_KNOB_ENTROPY, O_RDONLY );
+
+	if( fd < 0 )
+	{
+		dwipe_perror( errno, __FUNCTION__, "open" );
+		dwipe_log( DWIPE_LOG_FATAL, "Unable to open entropy source %s.", DWIPE_KNOB_ENTROPY );
+		return -1;
+	}
+
+	r = read( fd, out, length );
+	close( fd );
+
+	if( r != length )
+	{
+		dwipe_perror( errno, __FUNCTION__, "read" );
+		return -1;
+	}
+
+	return 0;
+
+} /* dwipe_seed_entropy */
+
+
+static int dwipe_seed_load( const char* file )
+{
+/**
+ * Loads the master seed from a seed file, or creates the file with a fresh seed.
+ *
+ * The file holds the seed as one line of hex, so that a wipe can be repeated or
+ * re-verified later with the same data.
+ *
+ */
+
+	char hex [DWIPE_KNOB_SEED_LENGTH * 2 + 2];
+	FILE* fp;
+	int fd;
+	int i;
+	unsigned int b;
+
+	fp = fopen( file, "r" );
+
+	if( fp != NULL )
+	{
+		if( fgets( hex, sizeof( hex ), fp ) == NULL ) { hex[0] = 0; }
+		fclose( fp );
+
+		for( i = 0 ; i < DWIPE_KNOB_SEED_LENGTH ; i++ )
+		{
+			if( sscanf( &hex[i * 2], "%2x", &b ) != 1 )
+			{
+				dwipe_log( DWIPE_LOG_FATAL, "The seed file '%s' does not hold %i hex bytes.", file, DWIPE_KNOB_SEED_LENGTH );
+				return -1;
+			}
+
+			dwipe_seed_master[i] = b;
+		}
+
+		dwipe_seed_source = "Seed file";
+		dwipe_log( DWIPE_LOG_NOTICE, "Loaded the master seed from '%s'.", file );
+		return 0;
+	}
+
+	if( errno != ENOENT )
+	{
+		dwipe_perror( errno, __FUNCTION__, "fopen" );
+		dwipe_log( DWIPE_LOG_FATAL, "Unable to read the seed file '%s'.", file );
+		return -1;
+	}
+
+	if( dwipe_seed_entropy( dwipe_seed_master, DWIPE_KNOB_SEED_LENGTH ) < 0 ) { return -1; }
+
+	/* The seed file is as secret as the data it regenerates. */
+	fd = open( file, O_WRONLY | O_CREAT | O_EXCL, 0600 );
+
+	if( fd < 0 )
+	{
+		dwipe_perror( errno, __FUNCTION__, "open" );
+		dwipe_log( DWIPE_LOG_FATAL, "Unable to create the seed file '%s'.", file );
+		return -1;
+	}
+
+	for( i = 0 ; i < DWIPE_KNOB_SEED_LENGTH ; i++ )
+	{
+		sprintf( &hex[i * 2], "%02x", dwipe_seed_master[i] );
+	}
+
+	hex[i * 2] = '\n';
+
+	if( write( fd, hex, i * 2 + 1 ) != i * 2 + 1 || fsync( fd ) != 0 )
+	{
+		dwipe_perror( errno, __FUNCTION__, "write" );
+		dwipe_log( DWIPE_LOG_FATAL, "Unable to write the seed file '%s'.", file );
+		close( fd );
+		return -1;
+	}
+
+	close( fd );
+
+	dwipe_log( DWIPE_LOG_NOTICE, "Saved the master seed to '%s'.", file );
+	return 0;
+
+} /* dwipe_seed_load */
+
+
+
+int dwipe_seed_init( const char* file )
+{
+/**
+ * Draws or loads the master seed in the parent, before any child is forked.
+ *
+ * @parameter  file  The seed file, or NULL to draw a seed that is never stored.
+ *
+ */
+
+	char seal [DWIPE_SEED_SEAL_SIZE];
+
+	if( file != NULL )
+	{
+		if( dwipe_seed_load( file ) < 0 ) { return -1; }
+	}
+
+	else if( dwipe_seed_entropy( dwipe_seed_master, DWIPE_KNOB_SEED_LENGTH ) < 0 )
+	{
+		dwipe_log( DWIPE_LOG_FATAL, "Unable to draw the master seed." );
+		return -1;
+	}
+
+	/* Keep the seed out of swap. */
+	mlock( dwipe_seed_master, sizeof( dwipe_seed_master ) );
+
+	dwipe_seed_seal( dwipe_seed_master, DWIPE_SEED_MASTER, 0, 0, seal );
+	dwipe_log( DWIPE_LOG_NOTICE, "Using a %i-bit master seed from %s, sealed %s.", DWIPE_KNOB_SEED_LENGTH * 8, dwipe_seed_source, seal );
+
+	return 0;
+
+} /* dwipe_seed_init */
+
+
+void dwipe_seed_device( dwipe_context_t* c )
+{
+/**
+ * Derives the key of a device from the master seed and the device name.
+ *
+ */
+
+	/* The 64-bit FNV-1a hash of the name. */
+	u64 h = 0xcbf29ce484222325ULL;
+	u8 nonce [CHACHA_NONCE_SIZE];
+	char seal [DWIPE_SEED_SEAL_SIZE];
+	const char* p;
+	int i;
+
+	for( p = c->device_name ; *p ; p++ )
+	{
+		h = ( h ^ (u8)*p ) * 0x100000001b3ULL;
+	}
+
+	for( i = 0 ; i < CHACHA_NONCE_SIZE - 1 ; i++ )
+	{
+		nonce[i] = h >> ( i * 8 );
+	}
+
+	/* The last byte is the domain, like every other nonce in the tree. */
+	nonce[i] = DWIPE_SEED_DEVICE;
+
+	dwipe_seed_chacha( dwipe_seed_master, nonce, 0, c->seed_key, DWIPE_KNOB_SEED_LENGTH );
+
+	dwipe_seed_seal( c->seed_key, DWIPE_SEED_MASTER, 0, 0, seal );
+	dwipe_log( DWIPE_LOG_INFO, "Derived the key of '%s', sealed %s.", c->device_name, seal );
+
+} /* dwipe_seed_device */
+
+
+void dwipe_seed_derive( const u8* key, int domain, u32 round, u32 pass, void* out, size_t length )
+{
+/**
+ * Derives length bytes for a domain, round and pass from a master or device key.
+ *
+ */
+
+	u8 nonce [CHACHA_NONCE_SIZE];
+
+	dwipe_seed_nonce( nonce, domain, round, pass );
+	dwipe_seed_chacha( key, nonce, 0, out, length );
+
+} /* dwipe_seed_derive */
+
+
+void dwipe_seed_seal( const u8* key, int domain, u32 round, u32 pass, char* seal )
+{
+/**
+ * Writes the hex fingerprint of a derivation. It comes from the same keystream
+ * as the seed, but far past it, so it identifies the seed without revealing it.
+ *
+ */
+
+	u8 nonce [CHACHA_NONCE_SIZE];
+	u8 b [( DWIPE_SEED_SEAL_SIZE - 1 ) / 2];
+	int i;
+
+	dwipe_seed_nonce( nonce, domain, round, pass );
+	dwipe_seed_chacha( key, nonce, DWIPE_SEED_SEAL_OFFSET, b, sizeof( b ) );
+
+	for( i = 0 ; i < sizeof( b ) ; i++ )
+	{
+		sprintf( &seal[i * 2], "%02x", b[i] );
+	}
+
+} /* dwipe_seed_seal */
+
+
+void dwipe_seed_pass( dwipe_context_t* c, int domain, u32 round, u32 pass )
+{
+/**
+ * Derives the PRNG seed of a random pass into the context and logs its seal.
+ *
+ */
+
+	char seal [DWIPE_SEED_SEAL_SIZE];
+
+	/* A shared stream consumer takes the seed of the stream when the pass starts. */
+	if( c->stream_id >= 0 ) { return; }
+
+	dwipe_seed_derive( c->seed_key, domain, round, pass, c->prng_seed.s, c->prng_seed.length );
+	dwipe_seed_seal( c->seed_key, domain, round, pass, seal );
+
+	if( domain == DWIPE_SEED_FINAL )
+	{
+		dwipe_log( DWIPE_LOG_NOTICE, "Seeded the final pass on '%s', sealed %s.", c->device_name, seal );
+	}
+
+	else
+	{
+		dwipe_log( DWIPE_LOG_NOTICE, "Seeded pass %u, round %u on '%s', sealed %s.", pass, round, c->device_name, seal );
+	}
+
+} /* dwipe_seed_pass */
+
+
+void dwipe_seed_stream( u64 pass, dwipe_entropy_t* seed, char* seal )
+{
+/**
+ * Derives the PRNG seed of a shared stream pass, which belongs to no single device.
+ *
+ * @parameter  seal  Receives the fingerprint of the seed, unless it is NULL.
+ *
+ */
+
+	dwipe_seed_derive( dwipe_seed_master, DWIPE_SEED_STREAM, 0, pass, seed->s, seed->length );
+
+	if( seal != NULL ) { dwipe_seed_seal( dwipe_seed_master, DWIPE_SEED_STREAM, 0, pass, seal ); }
+
+} /* dwipe_seed_stream */
+
+/* eof */
@@ -0,0 +1,47 @@
+/*
+ *  seed.h: The master seed and the seed derivation tree.
+ *
+ *  Copyright Paolo Iannelli <info@paoloiannelli.com>.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc., 675 Mass
+ *  Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#ifndef SEED_H_
+#define SEED_H_
+
+/* Derivation domains, which keep the seeds for different uses apart. */
+#define DWIPE_SEED_MASTER  0  /* The fingerprint of the master seed itself.          */
+#define DWIPE_SEED_DEVICE  1  /* The key of a device, from its identity.             */
+#define DWIPE_SEED_METHOD  2  /* The random bytes and pass order of the method.      */
+#define DWIPE_SEED_PASS    3  /* The PRNG seed of a random pass.                     */
+#define DWIPE_SEED_FINAL   4  /* The PRNG seed of the final ops2 pass.               */
+#define DWIPE_SEED_STREAM  5  /* The PRNG seed of a shared stream pass.              */
+
+/* The length of the hex fingerprint, plus the terminator. */
+#define DWIPE_SEED_SEAL_SIZE  17
+
+/* Where the master seed came from, for the user interface and reports. */
+extern const char* dwipe_seed_source;
+
+int  dwipe_seed_init( const char* file );
+void dwipe_seed_device( dwipe_context_t* c );
+void dwipe_seed_derive( const u8* key, int domain, u32 round, u32 pass, void* out, size_t length );
+void dwipe_seed_seal( const u8* key, int domain, u32 round, u32 pass, char* seal );
+void dwipe_seed_pass( dwipe_context_t* c, int domain, u32 round, u32 pass );
+void dwipe_seed_stream( u64 pass, dwipe_entropy_t* seed, char* seal );
+
+#endif /* SEED_H_ */
+
+/* eof */
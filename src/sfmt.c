@@ -0,0 +1,274 @@
+/*
+ *  sfmt.c: The SIMD-oriented Fast Mersenne Twister (SFMT19937) for dwipe.
+ *
+ *  Copyright Paolo Iannelli <info@paoloiannelli.com>.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc., 675 Mass
+ *  Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/*
+ * This follows the SFMT 1.3 reference code by Mutsuo Saito and Makoto Matsumoto of
+ * Hiroshima University, and produces the same output for the same seed.
+ *
+ */
+
+#include <string.h>
+#include "sfmt.h"
+
+static const uint32_t sfmt_parity [4] = { SFMT_PARITY1, SFMT_PARITY2, SFMT_PARITY3, SFMT_PARITY4 };
+
+
+
+#ifdef __SSE2__
+
+static inline __m128i sfmt_recursion( __m128i a, __m128i b, __m128i c, __m128i d, __m128i mask )
+{
+	__m128i v, x, y, z;
+
+	y = _mm_srli_epi32( b, SFMT_SR1 );
+	z = _mm_srli_si128( c, SFMT_SR2 );
+	v = _mm_slli_epi32( d, SFMT_SL1 );
+	z = _mm_xor_si128( z, a );
+	z = _mm_xor_si128( z, v );
+	x = _mm_slli_si128( a, SFMT_SL2 );
+	y = _mm_and_si128( y, mask );
+	z = _mm_xor_si128( z, x );
+	z = _mm_xor_si128( z, y );
+
+	return z;
+
+} /* sfmt_recursion */
+
+void sfmt_gen_rand_all( sfmt_state_t* sfmt )
+{
+	sfmt_w128_t* s = sfmt->state;
+	__m128i mask = _mm_set_epi32( SFMT_MSK4, SFMT_MSK3, SFMT_MSK2, SFMT_MSK1 );
+	__m128i r1 = s[SFMT_N - 2].si;
+	__m128i r2 = s[SFMT_N - 1].si;
+	int i;
+
+	/* Keep the two previous outputs in registers, because each word depends on them. */
+	for( i = 0 ; i < SFMT_N - SFMT_POS1 ; i++ )
+	{
+		s[i].si = sfmt_recursion( s[i].si, s[i + SFMT_POS1].si, r1, r2, mask );
+		r1 = r2;
+		r2 = s[i].si;
+	}
+
+	for( ; i < SFMT_N ; i++ )
+	{
+		s[i].si = sfmt_recursion( s[i].si, s[i + SFMT_POS1 - SFMT_N].si, r1, r2, mask );
+		r1 = r2;
+		r2 = s[i].si;
+	}
+
+} /* sfmt_gen_rand_all */
+
+#else /* __SSE2__ */
+
+static inline void sfmt_rshift128( sfmt_w128_t* out, const sfmt_w128_t* in, int shift )
+{
+	uint64_t th = ( (uint64_t)in->u[3] << 32 ) | in->u[2];
+	uint64_t tl = ( (uint64_t)in->u[1] << 32 ) | in->u[0];
+	uint64_t oh = th >> ( shift * 8 );
+	uint64_t ol = ( tl >> ( shift * 8 ) ) | ( th << ( 64 - shift * 8 ) );
+
+	out->u[0] = (uint32_t)ol;
+	out->u[1] = (uint32_t)( ol >> 32 );
+	out->u[2] = (uint32_t)oh;
+	out->u[3] = (uint32_t)( oh >> 32 );
+
+} /* sfmt_rshift128 */
+
+static inline void sfmt_lshift128( sfmt_w128_t* out, const sfmt_w128_t* in, int shift )
+{
+	uint64_t th = ( (uint64_t)in->u[3] << 32 ) | in->u[2];
+	uint64_t tl = ( (uint64_t)in->u[1] << 32 ) | in->u[0];
+	uint64_t oh = ( th << ( shift * 8 ) ) | ( tl >> ( 64 - shift * 8 ) );
+	uint64_t ol = tl << ( shift * 8 );
+
+	out->u[0] = (uint32_t)ol;
+	out->u[1] = (uint32_t)( ol >> 32 );
+	out->u[2] = (uint32_t)oh;
+	out->u[3] = (uint32_t)( oh >> 32 );
+
+} /* sfmt_lshift128 */
+
+static inline void sfmt_recursion( sfmt_w128_t* r, const sfmt_w128_t* a, const sfmt_w128_t* b, const sfmt_w128_t* c, const sfmt_w128_t* d )
+{
+	sfmt_w128_t x;
+	sfmt_w128_t y;
+
+	sfmt_lshift128( &x, a, SFMT_SL2 );
+	sfmt_rshift128( &y, c, SFMT_SR2 );
+
+	r->u[0] = a->u[0] ^ x.u[0] ^ ( ( b->u[0] >> SFMT_SR1 ) & SFMT_MSK1 ) ^ y.u[0] ^ ( d->u[0] << SFMT_SL1 );
+	r->u[1] = a->u[1] ^ x.u[1] ^ ( ( b->u[1] >> SFMT_SR1 ) & SFMT_MSK2 ) ^ y.u[1] ^ ( d->u[1] << SFMT_SL1 );
+	r->u[2] = a->u[2] ^ x.u[2] ^ ( ( b->u[2] >> SFMT_SR1 ) & SFMT_MSK3 ) ^ y.u[2] ^ ( d->u[2] << SFMT_SL1 );
+	r->u[3] = a->u[3] ^ x.u[3] ^ ( ( b->u[3] >> SFMT_SR1 ) & SFMT_MSK4 ) ^ y.u[3] ^ ( d->u[3] << SFMT_SL1 );
+
+} /* sfmt_recursion */
+
+void sfmt_gen_rand_all( sfmt_state_t* sfmt )
+{
+	sfmt_w128_t* s = sfmt->state;
+	sfmt_w128_t* r1 = &s[SFMT_N - 2];
+	sfmt_w128_t* r2 = &s[SFMT_N - 1];
+	int i;
+
+	for( i = 0 ; i < SFMT_N - SFMT_POS1 ; i++ )
+	{
+		sfmt_recursion( &s[i], &s[i], &s[i + SFMT_POS1], r1, r2 );
+		r1 = r2;
+		r2 = &s[i];
+	}
+
+	for( ; i < SFMT_N ; i++ )
+	{
+		sfmt_recursion( &s[i], &s[i], &s[i + SFMT_POS1 - SFMT_N], r1, r2 );
+		r1 = r2;
+		r2 = &s[i];
+	}
+
+} /* sfmt_gen_rand_all */
+
+#endif /* __SSE2__ */
+
+
+
+static void sfmt_period_certification( sfmt_state_t* sfmt )
+{
+/**
+ * Flips one bit of the state if needed so that the period is 2^19937 - 1.
+ *
+ */
+
+	uint32_t* s = (uint32_t*)sfmt->state;
+	uint32_t inner = 0;
+	uint32_t work;
+	int i;
+	int j;
+
+	for( i = 0 ; i < 4 ; i++ )
+	{
+		inner ^= s[i] & sfmt_parity[i];
+	}
+
+	for( i = 16 ; i > 0 ; i >>= 1 )
+	{
+		inner ^= inner >> i;
+	}
+
+	if( inner & 1 ) { return; }
+
+	for( i = 0 ; i < 4 ; i++ )
+	{
+		for( j = 0, work = 1 ; j < 32 ; j++, work <<= 1 )
+		{
+			if( work & sfmt_parity[i] )
+			{
+				s[i] ^= work;
+				return;
+			}
+		}
+	}
+
+} /* sfmt_period_certification */
+
+
+
+void sfmt_init_gen_rand( sfmt_state_t* sfmt, uint32_t seed )
+{
+	uint32_t* s = (uint32_t*)sfmt->state;
+	int i;
+
+	s[0] = seed;
+
+	for( i = 1 ; i < SFMT_N32 ; i++ )
+	{
+		s[i] = 1812433253UL * ( s[i - 1] ^ ( s[i - 1] >> 30 ) ) + i;
+	}
+
+	sfmt_period_certification( sfmt );
+
+	/* The first read generates the first block. */
+	sfmt->left = 0;
+
+} /* sfmt_init_gen_rand */
+
+
+
+#define SFMT_FUNC1( x ) ( ( (x) ^ ( (x) >> 27 ) ) * (uint32_t)1664525UL    )
+#define SFMT_FUNC2( x ) ( ( (x) ^ ( (x) >> 27 ) ) * (uint32_t)1566083941UL )
+
+void sfmt_init_by_array( sfmt_state_t* sfmt, uint32_t* key, int length )
+{
+	uint32_t* s = (uint32_t*)sfmt->state;
+	uint32_t r;
+	int lag = 11;
+	int mid = ( SFMT_N32 - lag ) / 2;
+	int count;
+	int i;
+	int j;
+
+	memset( sfmt->state, 0x8b, sizeof( sfmt->state ) );
+
+	count = length + 1 > SFMT_N32 ? length + 1 : SFMT_N32;
+
+	r = SFMT_FUNC1( s[0] ^ s[mid] ^ s[SFMT_N32 - 1] );
+	s[mid] += r;
+	r += length;
+	s[mid + lag] += r;
+	s[0] = r;
+
+	count--;
+
+	for( i = 1, j = 0 ; j < count && j < length ; j++ )
+	{
+		r = SFMT_FUNC1( s[i] ^ s[( i + mid ) % SFMT_N32] ^ s[( i + SFMT_N32 - 1 ) % SFMT_N32] );
+		s[( i + mid ) % SFMT_N32] += r;
+		r += key[j] + i;
+		s[( i + mid + lag ) % SFMT_N32] += r;
+		s[i] = r;
+		i = ( i + 1 ) % SFMT_N32;
+	}
+
+	for( ; j < count ; j++ )
+	{
+		r = SFMT_FUNC1( s[i] ^ s[( i + mid ) % SFMT_N32] ^ s[( i + SFMT_N32 - 1 ) % SFMT_N32] );
+		s[( i + mid ) % SFMT_N32] += r;
+		r += i;
+		s[( i + mid + lag ) % SFMT_N32] += r;
+		s[i] = r;
+		i = ( i + 1 ) % SFMT_N32;
+	}
+
+	for( j = 0 ; j < SFMT_N32 ; j++ )
+	{
+		r = SFMT_FUNC2( s[i] + s[( i + mid ) % SFMT_N32] + s[( i + SFMT_N32 - 1 ) % SFMT_N32] );
+		s[( i + mid ) % SFMT_N32] ^= r;
+		r -= i;
+		s[( i + mid + lag ) % SFMT_N32] ^= r;
+		s[i] = r;
+		i = ( i + 1 ) % SFMT_N32;
+	}
+
+	sfmt_period_certification( sfmt );
+
+	sfmt->left = 0;
+
+} /* sfmt_init_by_array */
+
+/* eof */
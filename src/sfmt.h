@@ -0,0 +1,73 @@
+/*
+ *  sfmt.h: The SIMD-oriented Fast Mersenne Twister (SFMT19937) for dwipe.
+ *
+ *  Copyright Paolo Iannelli <info@paoloiannelli.com>.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc., 675 Mass
+ *  Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#ifndef SFMT_H_
+#define SFMT_H_
+
+#include <stdint.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* The SFMT19937 parameter set of Saito and Matsumoto. */
+#define SFMT_MEXP    19937
+#define SFMT_N       ( SFMT_MEXP / 128 + 1 )   /* The state size in 128-bit words. */
+#define SFMT_N32     ( SFMT_N * 4 )             /* The state size in 32-bit words.  */
+#define SFMT_POS1    122
+#define SFMT_SL1     18
+#define SFMT_SL2     1
+#define SFMT_SR1     11
+#define SFMT_SR2     1
+#define SFMT_MSK1    0xdfffffefU
+#define SFMT_MSK2    0xddfecb7fU
+#define SFMT_MSK3    0xbffaffffU
+#define SFMT_MSK4    0xbffffff6U
+#define SFMT_PARITY1 0x00000001U
+#define SFMT_PARITY2 0x00000000U
+#define SFMT_PARITY3 0x00000000U
+#define SFMT_PARITY4 0x13c9e684U
+
+typedef union sfmt_w128_t_
+{
+	uint32_t u[4];
+#ifdef __SSE2__
+	__m128i  si;
+#endif
+} sfmt_w128_t;
+
+typedef struct sfmt_state_t_
+{
+	sfmt_w128_t state[SFMT_N];  /* Must be 16-byte aligned for the SSE2 path.         */
+	size_t      left;           /* The number of unread output bytes at the end of state. */
+} sfmt_state_t;
+
+/* Seed the state with a single word, like init_gen_rand() in the reference code. */
+void sfmt_init_gen_rand( sfmt_state_t* sfmt, uint32_t seed );
+
+/* Seed the state with an array of words, like init_by_array() in the reference code. */
+void sfmt_init_by_array( sfmt_state_t* sfmt, uint32_t* key, int length );
+
+/* Replace the whole state with the next SFMT_N32 words of output. */
+void sfmt_gen_rand_all( sfmt_state_t* sfmt );
+
+#endif /* SFMT_H_ */
+
+/* eof */
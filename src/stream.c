@@ -0,0 +1,425 @@
+/*
+ *  stream.c: A random stream that is generated once and shared by every device.
+ *
+ *  Copyright Paolo Iannelli <info@paoloiannelli.com>.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc., 675 Mass
+ *  Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include "dwipe.h"
+#include "context.h"
+#include "method.h"
+#include "prng.h"
+#include "options.h"
+#include "stream.h"
+#include "seed.h"
+#include "logging.h"
+
+#include <sys/mman.h>
+#include <wait.h>
+
+/* The shared stream, which is inherited by every child process. */
+static dwipe_stream_t* dwipe_stream = NULL;
+
+
+
+int dwipe_stream_create( dwipe_context_t* c, int count )
+{
+/**
+ * Creates the shared ring and assigns a consumer slot to every context.
+ *
+ * @parameter  c           The array of selected contexts.
+ * @parameter  count       The number of contexts in the array.
+ *
+ */
+
+	/* The attributes of the process-shared lock. */
+	pthread_mutexattr_t mattr;
+	pthread_condattr_t  cattr;
+
+	/* The largest device, which sets the length of every random pass. */
+	u64 largest = 0;
+
+	/* The size of the shared mapping. */
+	size_t size;
+
+	char* m;
+	int i;
+
+	for( i = 0 ; i < count ; i++ )
+	{
+		if( c[i].device_size > largest ) { largest = c[i].device_size; }
+	}
+
+	size = sizeof( dwipe_stream_t )
+	     + count * sizeof( u64 )
+	     + (size_t)DWIPE_KNOB_STREAM_SLOTS * DWIPE_KNOB_STREAM_TILE;
+
+	m = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0 );
+
+	if( m == MAP_FAILED )
+	{
+		dwipe_perror( errno, __FUNCTION__, "mmap" );
+		dwipe_log( DWIPE_LOG_FATAL, "Unable to allocate shared memory for the random stream." );
+		return -1;
+	}
+
+	dwipe_stream = (dwipe_stream_t*)m;
+	dwipe_stream->cursor = (u64*)( m + sizeof( dwipe_stream_t ) );
+	dwipe_stream->ring   = (char*)( dwipe_stream->cursor + count );
+
+	pthread_mutexattr_init( &mattr );
+	pthread_mutexattr_setpshared( &mattr, PTHREAD_PROCESS_SHARED );
+	pthread_mutex_init( &dwipe_stream->lock, &mattr );
+
+	pthread_condattr_init( &cattr );
+	pthread_condattr_setpshared( &cattr, PTHREAD_PROCESS_SHARED );
+	pthread_cond_init( &dwipe_stream->cond, &cattr );
+
+	dwipe_stream->pid        = 0;
+	dwipe_stream->count      = count;
+	dwipe_stream->tiles      = ( largest + DWIPE_KNOB_STREAM_TILE - 1 ) / DWIPE_KNOB_STREAM_TILE;
+	dwipe_stream->produced   = 0;
+	dwipe_stream->failed     = 0;
+
+	if( dwipe_stream->tiles == 0 ) { dwipe_stream->tiles = 1; }
+
+	for( i = 0 ; i < count ; i++ )
+	{
+		/* Every consumer starts at the first tile of the first random pass. */
+		dwipe_stream->cursor[i] = 0;
+		c[i].stream_id = i;
+		c[i].stream_pass = 0;
+	}
+
+	dwipe_log( DWIPE_LOG_WARNING, "Sharing one random stream across %i devices. Every device receives the same random data.", count );
+
+	return 0;
+
+} /* dwipe_stream_create */
+
+
+
+int dwipe_stream_generate( void )
+{
+/**
+ * Runs in the generator process and fills the ring until every consumer is done.
+ *
+ * Each random pass is a fresh PRNG stream that is seeded from the master
+ * seed, and it is exactly as many tiles long as the largest device.
+ *
+ */
+
+	/* The PRNG seed and state. */
+	u8 buffer [DWIPE_KNOB_PRNG_STATE_LENGTH];
+	dwipe_entropy_t seed;
+	void* state = NULL;
+	char seal [DWIPE_SEED_SEAL_SIZE];
+
+	/* The tile that is being produced and the oldest tile still in use. */
+	u64 s;
+	u64 low = 0;
+
+	int i;
+
+	seed.length = sizeof( buffer );
+	seed.s = buffer;
+
+	for( s = 0 ; ; s++ )
+	{
+		pthread_mutex_lock( &dwipe_stream->lock );
+
+		while( 1 )
+		{
+			for( low = ~0ULL, i = 0 ; i < dwipe_stream->count ; i++ )
+			{
+				if( dwipe_stream->cursor[i] < low ) { low = dwipe_stream->cursor[i]; }
+			}
+
+			/* Stop when every consumer is done, or wait for the slot to be released. */
+			if( low == ~0ULL || s < low + DWIPE_KNOB_STREAM_SLOTS ) { break; }
+
+			pthread_cond_wait( &dwipe_stream->cond, &dwipe_stream->lock );
+		}
+
+		pthread_mutex_unlock( &dwipe_stream->lock );
+
+		if( low == ~0ULL ) { break; }
+
+		if( s % dwipe_stream->tiles == 0 )
+		{
+			/* This is the first tile of a random pass, so reseed. */
+			dwipe_seed_stream( s / dwipe_stream->tiles, &seed, seal );
+			dwipe_options.prng->init( &state, &seed );
+
+			dwipe_log( DWIPE_LOG_NOTICE, "Seeded shared stream pass %llu, sealed %s.", s / dwipe_stream->tiles, seal );
+		}
+
+		dwipe_prng_fill( dwipe_options.prng, &state, dwipe_stream->ring + ( s % DWIPE_KNOB_STREAM_SLOTS ) * DWIPE_KNOB_STREAM_TILE, DWIPE_KNOB_STREAM_TILE );
+
+		/* Publish the tile. */
+		pthread_mutex_lock( &dwipe_stream->lock );
+		dwipe_stream->produced = s + 1;
+		pthread_cond_broadcast( &dwipe_stream->cond );
+		pthread_mutex_unlock( &dwipe_stream->lock );
+	}
+
+	pthread_mutex_lock( &dwipe_stream->lock );
+
+	if( low != ~0ULL )
+	{
+		/* Wake the consumers so that they fail instead of waiting forever. */
+		dwipe_stream->failed = 1;
+		pthread_cond_broadcast( &dwipe_stream->cond );
+	}
+
+	pthread_mutex_unlock( &dwipe_stream->lock );
+
+	return ( low == ~0ULL ) ? 0 : -1;
+
+} /* dwipe_stream_generate */
+
+
+
+void dwipe_stream_set_pid( pid_t pid )
+{
+/**
+ * Remembers the generator process in the parent.
+ *
+ */
+
+	if( dwipe_stream != NULL ) { dwipe_stream->pid = pid; }
+
+} /* dwipe_stream_set_pid */
+
+
+
+void dwipe_stream_release( int id )
+{
+/**
+ * Releases every tile held by a consumer that has exited.
+ *
+ */
+
+	if( dwipe_stream == NULL ) { return; }
+
+	pthread_mutex_lock( &dwipe_stream->lock );
+	dwipe_stream->cursor[id] = ~0ULL;
+	pthread_cond_broadcast( &dwipe_stream->cond );
+	pthread_mutex_unlock( &dwipe_stream->lock );
+
+} /* dwipe_stream_release */
+
+
+
+void dwipe_stream_poll( void )
+{
+/**
+ * Reaps the generator if it has died, and tells the consumers about it.
+ *
+ */
+
+	int status;
+
+	if( dwipe_stream == NULL || dwipe_stream->pid <= 0 ) { return; }
+
+	if( waitpid( dwipe_stream->pid, &status, WNOHANG ) == dwipe_stream->pid )
+	{
+		dwipe_stream->pid = 0;
+
+		pthread_mutex_lock( &dwipe_stream->lock );
+		dwipe_stream->failed = 1;
+		pthread_cond_broadcast( &dwipe_stream->cond );
+		pthread_mutex_unlock( &dwipe_stream->lock );
+	}
+
+} /* dwipe_stream_poll */
+
+
+
+void dwipe_stream_finish( void )
+{
+/**
+ * Releases every consumer and waits for the generator to exit.
+ *
+ */
+
+	int i;
+
+	if( dwipe_stream == NULL ) { return; }
+
+	for( i = 0 ; i < dwipe_stream->count ; i++ ) { dwipe_stream_release( i ); }
+
+	if( dwipe_stream->pid > 0 )
+	{
+		waitpid( dwipe_stream->pid, NULL, 0 );
+		dwipe_stream->pid = 0;
+	}
+
+} /* dwipe_stream_finish */
+
+
+
+int dwipe_stream_begin( dwipe_context_t* c )
+{
+/**
+ * Moves a consumer to the start of its next random pass and copies the seed of
+ * that pass into the context, so that the verifier can regenerate it locally.
+ *
+ */
+
+	/* The first tile of the pass. */
+	u64 first = c->stream_pass * dwipe_stream->tiles;
+
+	c->stream_offset = first * DWIPE_KNOB_STREAM_TILE;
+
+	pthread_mutex_lock( &dwipe_stream->lock );
+
+	dwipe_stream->cursor[c->stream_id] = first;
+	pthread_cond_broadcast( &dwipe_stream->cond );
+
+	/* The health check does not count the wait as a stall. */
+	c->stream_waiting = 1;
+
+	while( dwipe_stream->produced <= first && ! dwipe_stream->failed )
+	{
+		pthread_cond_wait( &dwipe_stream->cond, &dwipe_stream->lock );
+	}
+
+	c->stream_waiting = 0;
+
+	pthread_mutex_unlock( &dwipe_stream->lock );
+
+	if( dwipe_stream->produced <= first )
+	{
+		dwipe_log( DWIPE_LOG_FATAL, "The shared random stream stopped before '%s' finished.", c->device_name );
+		return -1;
+	}
+
+	/* The consumer derives the same seed for verification. */
+	dwipe_seed_stream( c->stream_pass, &c->prng_seed, NULL );
+
+	dwipe_log( DWIPE_LOG_NOTICE, "Using shared stream seed %i on '%s'.", c->stream_pass, c->device_name );
+
+	c->stream_pass += 1;
+
+	return 0;
+
+} /* dwipe_stream_begin */
+
+
+
+int dwipe_stream_read( dwipe_context_t* c, char* buffer, size_t count )
+{
+/**
+ * Copies the next bytes of the current random pass from the ring.
+ *
+ */
+
+	/* The tile and the offset within it. */
+	u64 tile;
+	size_t k;
+	size_t n;
+
+	while( count > 0 )
+	{
+		tile = c->stream_offset / DWIPE_KNOB_STREAM_TILE;
+		k = c->stream_offset % DWIPE_KNOB_STREAM_TILE;
+		n = DWIPE_KNOB_STREAM_TILE - k;
+
+		if( n > count ) { n = count; }
+
+		pthread_mutex_lock( &dwipe_stream->lock );
+
+		/* The health check does not count the wait as a stall. */
+		c->stream_waiting = 1;
+
+		while( dwipe_stream->produced <= tile && ! dwipe_stream->failed )
+		{
+			pthread_cond_wait( &dwipe_stream->cond, &dwipe_stream->lock );
+		}
+
+		c->stream_waiting = 0;
+
+		pthread_mutex_unlock( &dwipe_stream->lock );
+
+		if( dwipe_stream->produced <= tile )
+		{
+			dwipe_log( DWIPE_LOG_FATAL, "The shared random stream stopped before '%s' finished.", c->device_name );
+			return -1;
+		}
+
+		memcpy( buffer, dwipe_stream->ring + ( tile % DWIPE_KNOB_STREAM_SLOTS ) * DWIPE_KNOB_STREAM_TILE + k, n );
+
+		buffer += n;
+		count -= n;
+		c->stream_offset += n;
+
+		if( c->stream_offset % DWIPE_KNOB_STREAM_TILE == 0 )
+		{
+			/* The tile is used up, so let the generator refill it. */
+			pthread_mutex_lock( &dwipe_stream->lock );
+			dwipe_stream->cursor[c->stream_id] = c->stream_offset / DWIPE_KNOB_STREAM_TILE;
+			pthread_cond_broadcast( &dwipe_stream->cond );
+			pthread_mutex_unlock( &dwipe_stream->lock );
+		}
+	}
+
+	return 0;
+
+} /* dwipe_stream_read */
+
+
+
+void dwipe_stream_skip( dwipe_context_t* c, u64 count )
+{
+/**
+ * Moves past the bytes of the current random pass that fall on a hole, so that a
+ * seekable PRNG finds every block at the stream position of its device offset.
+ *
+ */
+
+	u64 tile = c->stream_offset / DWIPE_KNOB_STREAM_TILE;
+
+	c->stream_offset += count;
+
+	if( c->stream_offset / DWIPE_KNOB_STREAM_TILE != tile )
+	{
+		/* Let the generator refill the tiles that were skipped. */
+		pthread_mutex_lock( &dwipe_stream->lock );
+		dwipe_stream->cursor[c->stream_id] = c->stream_offset / DWIPE_KNOB_STREAM_TILE;
+		pthread_cond_broadcast( &dwipe_stream->cond );
+		pthread_mutex_unlock( &dwipe_stream->lock );
+	}
+
+} /* dwipe_stream_skip */
+
+
+
+void dwipe_stream_end( dwipe_context_t* c )
+{
+/**
+ * Releases the rest of the current random pass, which a smaller device does not use.
+ *
+ */
+
+	pthread_mutex_lock( &dwipe_stream->lock );
+	dwipe_stream->cursor[c->stream_id] = c->stream_pass * dwipe_stream->tiles;
+	pthread_cond_broadcast( &dwipe_stream->cond );
+	pthread_mutex_unlock( &dwipe_stream->lock );
+
+} /* dwipe_stream_end */
+
+/* eof */
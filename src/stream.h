@@ -0,0 +1,56 @@
+/*
+ *  stream.h: A random stream that is generated once and shared by every device.
+ *
+ *  Copyright Paolo Iannelli <info@paoloiannelli.com>.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc., 675 Mass
+ *  Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#ifndef STREAM_H_
+#define STREAM_H_
+
+#include <pthread.h>
+
+#define DWIPE_KNOB_STREAM_TILE            1048576             /* 1 MiB; a multiple of the PRNG word size. */
+#define DWIPE_KNOB_STREAM_SLOTS           64                  /* The ring holds 64 tiles.                 */
+
+typedef struct dwipe_stream_t_
+{
+	pthread_mutex_t lock;         /* Guards the counters below.                                     */
+	pthread_cond_t  cond;         /* Signalled whenever a tile is produced or released.             */
+	pid_t           pid;          /* The generator process.                                         */
+	int             count;        /* The number of consumers.                                       */
+	u64             tiles;        /* The number of tiles in each random pass.                       */
+	u64             produced;     /* The number of tiles that the generator has produced.           */
+	int             failed;       /* Set when the generator has stopped early.                      */
+	u64*            cursor;       /* The oldest tile that each consumer still needs.                */
+	char*           ring;         /* The tiles.                                                     */
+} dwipe_stream_t;
+
+int  dwipe_stream_create( dwipe_context_t* c, int count );
+int  dwipe_stream_generate( void );
+void dwipe_stream_set_pid( pid_t pid );
+void dwipe_stream_release( int id );
+void dwipe_stream_poll( void );
+void dwipe_stream_finish( void );
+
+int  dwipe_stream_begin( dwipe_context_t* c );
+int  dwipe_stream_read( dwipe_context_t* c, char* buffer, size_t count );
+void dwipe_stream_skip( dwipe_context_t* c, u64 count );
+void dwipe_stream_end( dwipe_context_t* c );
+
+#endif /* STREAM_H_ */
+
+/* eof */
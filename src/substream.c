@@ -0,0 +1,411 @@
+/*
+ *  substream.c: Position addressed PRNG substreams that are generated by a pool of threads.
+ *
+ *  Copyright Paolo Iannelli <info@paoloiannelli.com>.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc., 675 Mass
+ *  Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/*
+ * The random stream of a pass is cut into segments, and each segment is generated from
+ * its own seed that is derived from the pass seed and the segment index. So the data at
+ * any offset does not depend on how many threads made it, or in which order, and the
+ * verifier can regenerate a block without replaying the stream in front of it.
+ *
+ * A counter-based PRNG can seek, so it keeps the pass seed and each segment is the pass
+ * stream itself at that offset, which is the same data that a single thread writes.
+ *
+ */
+
+#include "dwipe.h"
+#include "context.h"
+#include "method.h"
+#include "prng.h"
+#include "backend.h"
+#include "options.h"
+#include "substream.h"
+#include "logging.h"
+
+#include <pthread.h>
+
+typedef struct dwipe_substream_job_t_
+{
+	dwipe_context_t* c;
+	char*            buffer;   /* The output buffer.                                      */
+	loff_t           offset;   /* The stream offset of the output buffer.                 */
+	size_t           count;    /* The size of the output buffer.                          */
+	int              pieces;   /* The number of segment pieces in the output buffer.      */
+	int              resume;   /* Set when the first piece continues the first slot.      */
+	int              slot;     /* The generator thread, which takes every stride piece.   */
+	int              stride;   /* The number of generator threads in this fill.           */
+	int              result;   /* Set to -1 when the generator fails.                     */
+} dwipe_substream_job_t;
+
+
+
+static void dwipe_substream_derive( dwipe_context_t* c, u8* seed, u64 segment )
+{
+/**
+ * Mixes the segment index into every word of the pass seed, with a splitmix64 output
+ * that is unique to the segment and the word, so that every PRNG sees a new key.
+ *
+ */
+
+	u64 words = c->prng_seed.length / sizeof( uint64_t );
+	uint64_t w;
+	uint64_t z;
+	u64 i;
+
+	memcpy( seed, c->prng_seed.s, c->prng_seed.length );
+
+	for( i = 0 ; i < words ; i++ )
+	{
+		z = ( segment * words + i + 1 ) * 0x9e3779b97f4a7c15ULL;
+		z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+		z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111ebULL;
+		z = z ^ ( z >> 31 );
+
+		memcpy( &w, seed + i * sizeof( uint64_t ), sizeof( uint64_t ) );
+		w ^= z;
+		memcpy( seed + i * sizeof( uint64_t ), &w, sizeof( uint64_t ) );
+	}
+
+} /* dwipe_substream_derive */
+
+
+
+static void dwipe_substream_run( dwipe_substream_job_t* job )
+{
+/**
+ * Generates every stride piece of the output buffer, starting with the slot piece.
+ *
+ */
+
+	dwipe_context_t* c = job->c;
+	dwipe_substream_t* s = c->substream;
+	dwipe_entropy_t seed;
+
+	/* The first segment boundary in the buffer. */
+	loff_t boundary = ( job->offset / DWIPE_KNOB_SUBSTREAM_SEGMENT + 1 ) * DWIPE_KNOB_SUBSTREAM_SEGMENT;
+
+	loff_t start;
+	loff_t end;
+	size_t n;
+	size_t k;
+	int i;
+
+	seed.length = c->prng_seed.length;
+	seed.s = s->seeds + job->slot * seed.length;
+
+	for( i = job->slot ; i < job->pieces ; i += job->stride )
+	{
+		start = i == 0 ? job->offset : boundary + (loff_t)( i - 1 ) * DWIPE_KNOB_SUBSTREAM_SEGMENT;
+		end = i == 0 ? boundary : start + DWIPE_KNOB_SUBSTREAM_SEGMENT;
+
+		if( end > job->offset + (loff_t)job->count ) { end = job->offset + job->count; }
+
+		if( ( i > 0 || ! job->resume ) && ( c->prng->flags & DWIPE_PRNG_SEEKABLE ) )
+		{
+			if( c->prng->init( &s->states[job->slot], &c->prng_seed ) < 0 )
+			{
+				job->result = -1;
+				break;
+			}
+
+			c->prng->seek( &s->states[job->slot], start );
+		}
+
+		else if( i > 0 || ! job->resume )
+		{
+			dwipe_substream_derive( c, seed.s, start / DWIPE_KNOB_SUBSTREAM_SEGMENT );
+
+			if( c->prng->init( &s->states[job->slot], &seed ) < 0 )
+			{
+				job->result = -1;
+				break;
+			}
+
+			/* Only the first piece can start inside its segment, and this is its only thread. */
+			for( k = start % DWIPE_KNOB_SUBSTREAM_SEGMENT ; k > 0 ; k -= n )
+			{
+				n = k < DWIPE_KNOB_VERIFY_TILE ? k : DWIPE_KNOB_VERIFY_TILE;
+				c->prng->read( &s->states[job->slot], s->skip, n );
+			}
+		}
+
+		dwipe_prng_fill( c->prng, &s->states[job->slot], job->buffer + ( start - job->offset ), end - start );
+	}
+
+} /* dwipe_substream_run */
+
+
+
+static void* dwipe_substream_worker( void* arg )
+{
+/**
+ * Runs the job of one slot for every fill that needs the slot, until the pool stops.
+ *
+ */
+
+	dwipe_substream_job_t* job = arg;
+	dwipe_substream_t* s = job->c->substream;
+
+	/* The last fill that this worker has seen. */
+	u64 seen = 0;
+
+	pthread_mutex_lock( &s->lock );
+
+	for( ;; )
+	{
+		while( ! s->stop && s->round == seen )
+		{
+			pthread_cond_wait( &s->wake, &s->lock );
+		}
+
+		if( s->stop ) { break; }
+
+		seen = s->round;
+
+		/* A fill with fewer pieces than threads leaves the last slots idle. */
+		if( job->slot >= job->stride ) { continue; }
+
+		pthread_mutex_unlock( &s->lock );
+
+		dwipe_substream_run( job );
+
+		pthread_mutex_lock( &s->lock );
+
+		s->busy -= 1;
+
+		if( s->busy == 0 ) { pthread_cond_signal( &s->done ); }
+	}
+
+	pthread_mutex_unlock( &s->lock );
+
+	return NULL;
+
+} /* dwipe_substream_worker */
+
+
+
+static dwipe_substream_t* dwipe_substream_create( dwipe_context_t* c )
+{
+/**
+ * Allocates the generator slots of the context and starts a worker thread for every
+ * slot but the first, which the caller runs itself.
+ *
+ */
+
+	dwipe_substream_t* s = calloc( 1, sizeof( dwipe_substream_t ) );
+	int i;
+
+	if( s != NULL )
+	{
+		/* A generator that is not parallel safe runs its substreams on the caller. */
+		s->count       = ( c->prng->flags & DWIPE_PRNG_PARALLEL ) ? dwipe_options.prng_threads : 1;
+		s->states      = calloc( s->count, sizeof( void* ) );
+		s->seeds       = malloc( s->count * c->prng_seed.length );
+		s->skip        = malloc( DWIPE_KNOB_VERIFY_TILE );
+		s->tail_seed   = malloc( c->prng_seed.length );
+		s->tail_offset = -1;
+		s->threads     = calloc( s->count, sizeof( pthread_t ) );
+		s->jobs        = calloc( s->count, sizeof( dwipe_substream_job_t ) );
+
+		pthread_mutex_init( &s->lock, NULL );
+		pthread_cond_init( &s->wake, NULL );
+		pthread_cond_init( &s->done, NULL );
+	}
+
+	c->substream = s;
+
+	if( s == NULL || ! s->states || ! s->seeds || ! s->skip || ! s->tail_seed || ! s->threads || ! s->jobs )
+	{
+		dwipe_perror( errno, __FUNCTION__, "malloc" );
+		dwipe_log( DWIPE_LOG_FATAL, "Unable to allocate memory for the substreams of '%s'.", c->device_name );
+		dwipe_substream_free( c );
+		return NULL;
+	}
+
+	for( i = 0 ; i < s->count ; i++ )
+	{
+		s->jobs[i].c    = c;
+		s->jobs[i].slot = i;
+	}
+
+	for( i = 1 ; i < s->count ; i++ )
+	{
+		if( pthread_create( &s->threads[i], NULL, dwipe_substream_worker, &s->jobs[i] ) != 0 )
+		{
+			/* Carry on with the threads that did start. */
+			dwipe_perror( errno, __FUNCTION__, "pthread_create" );
+			dwipe_log( DWIPE_LOG_WARNING, "Only %i substream threads could be started for '%s'.", i, c->device_name );
+			s->count = i;
+			break;
+		}
+
+		s->started = i;
+	}
+
+	dwipe_log( DWIPE_LOG_INFO, "Generating the random passes of '%s' with %i threads in %i KiB substreams.", \
+	  c->device_name, s->count, DWIPE_KNOB_SUBSTREAM_SEGMENT / 1024 );
+
+	return s;
+
+} /* dwipe_substream_create */
+
+
+
+int dwipe_substream_fill( dwipe_context_t* c, void* buffer, size_t count, loff_t offset )
+{
+/**
+ * Fills the buffer with the bytes of the random pass stream at the given offset.
+ *
+ * The buffer is cut at the segment boundaries, and the pieces are dealt out to the
+ * worker threads, which wait between fills. The state that made the end of the buffer is kept in the first
+ * slot, so a sequential caller only pays for the seed derivation once per segment.
+ *
+ */
+
+	dwipe_substream_t* s = c->substream;
+	dwipe_substream_job_t* jobs;
+
+	/* The first segment boundary in the buffer. */
+	loff_t boundary = ( offset / DWIPE_KNOB_SUBSTREAM_SEGMENT + 1 ) * DWIPE_KNOB_SUBSTREAM_SEGMENT;
+
+	void* state;
+	int pieces = 1;
+	int resume;
+	int stride;
+	int last;
+	int i;
+
+	if( count == 0 ) { return 0; }
+
+	if( s == NULL )
+	{
+		s = dwipe_substream_create( c );
+		if( s == NULL ) { return -1; }
+	}
+
+	jobs = s->jobs;
+
+	if( offset + (loff_t)count > boundary )
+	{
+		pieces += ( offset + count - boundary + DWIPE_KNOB_SUBSTREAM_SEGMENT - 1 ) / DWIPE_KNOB_SUBSTREAM_SEGMENT;
+	}
+
+	/* A segment start is always derived afresh, so a new pass can never resume an old one. */
+	resume = offset % DWIPE_KNOB_SUBSTREAM_SEGMENT != 0 && offset == s->tail_offset \
+	  && memcmp( s->tail_seed, c->prng_seed.s, c->prng_seed.length ) == 0;
+
+	stride = pieces < s->count ? pieces : s->count;
+
+	pthread_mutex_lock( &s->lock );
+
+	for( i = 0 ; i < s->count ; i++ )
+	{
+		jobs[i].buffer = buffer;
+		jobs[i].offset = offset;
+		jobs[i].count  = count;
+		jobs[i].pieces = pieces;
+		jobs[i].resume = resume;
+		jobs[i].stride = stride;
+		jobs[i].result = 0;
+	}
+
+	/* Wake the workers, and take the first slot on this thread meanwhile. */
+	s->busy = stride - 1;
+	s->round += 1;
+	pthread_cond_broadcast( &s->wake );
+	pthread_mutex_unlock( &s->lock );
+
+	dwipe_substream_run( &jobs[0] );
+
+	pthread_mutex_lock( &s->lock );
+
+	while( s->busy > 0 )
+	{
+		pthread_cond_wait( &s->done, &s->lock );
+	}
+
+	pthread_mutex_unlock( &s->lock );
+
+	for( i = 0 ; i < stride ; i++ )
+	{
+		if( jobs[i].result < 0 )
+		{
+			dwipe_log( DWIPE_LOG_FATAL, "Unable to seed the substreams of '%s'.", c->device_name );
+			s->tail_offset = -1;
+			return -1;
+		}
+	}
+
+	/* Move the state that made the end of the buffer into the first slot. */
+	last = ( pieces - 1 ) % stride;
+
+	state = s->states[0];
+	s->states[0] = s->states[last];
+	s->states[last] = state;
+
+	memcpy( s->tail_seed, c->prng_seed.s, c->prng_seed.length );
+	s->tail_offset = offset + count;
+
+	return 0;
+
+} /* dwipe_substream_fill */
+
+
+
+void dwipe_substream_free( dwipe_context_t* c )
+{
+/**
+ * Stops the worker threads and releases the generator slots of the context.
+ *
+ */
+
+	dwipe_substream_t* s = c->substream;
+	int i;
+
+	if( s == NULL ) { return; }
+
+	pthread_mutex_lock( &s->lock );
+	s->stop = 1;
+	pthread_cond_broadcast( &s->wake );
+	pthread_mutex_unlock( &s->lock );
+
+	for( i = 1 ; i <= s->started ; i++ ) { pthread_join( s->threads[i], NULL ); }
+
+	pthread_mutex_destroy( &s->lock );
+	pthread_cond_destroy( &s->wake );
+	pthread_cond_destroy( &s->done );
+
+	if( s->states != NULL )
+	{
+		for( i = 0 ; i < s->count ; i++ ) { free( s->states[i] ); }
+	}
+
+	free( s->states );
+	free( s->seeds );
+	free( s->skip );
+	free( s->tail_seed );
+	free( s->threads );
+	free( s->jobs );
+	free( s );
+
+	c->substream = NULL;
+
+} /* dwipe_substream_free */
+
+/* eof */
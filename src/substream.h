@@ -0,0 +1,53 @@
+/*
+ *  substream.h: Position addressed PRNG substreams that are generated by a pool of threads.
+ *
+ *  Copyright Paolo Iannelli <info@paoloiannelli.com>.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc., 675 Mass
+ *  Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#ifndef SUBSTREAM_H_
+#define SUBSTREAM_H_
+
+#include <pthread.h>
+
+#define DWIPE_KNOB_SUBSTREAM_SEGMENT      262144              /* 256 KiB of stream for each derived seed. */
+#define DWIPE_KNOB_SUBSTREAM_THREADS      16                  /* The most generator threads per device.   */
+
+typedef struct dwipe_substream_t_
+{
+	int      count;        /* The number of generator threads, including the caller.            */
+	void**   states;       /* The PRNG state of each generator thread.                          */
+	u8*      seeds;        /* The derived seed of each generator thread.                        */
+	char*    skip;         /* Scratch space for the head of a segment that is not wanted.       */
+	u8*      tail_seed;    /* The pass seed of the state that is left in the first slot.        */
+	loff_t   tail_offset;  /* The stream offset where the state in the first slot continues.   */
+	pthread_t* threads;    /* The worker threads, which live as long as the substreams.         */
+	int      started;      /* The number of worker threads that are running.                    */
+	struct dwipe_substream_job_t_* jobs; /* The job of each slot in the current fill.          */
+	pthread_mutex_t lock;  /* Guards the fields below and the jobs.                             */
+	pthread_cond_t  wake;  /* Signalled when a fill is dealt out, or when the pool stops.       */
+	pthread_cond_t  done;  /* Signalled when the last worker has finished its job.              */
+	u64      round;        /* The number of fills that have been dealt out.                     */
+	int      busy;         /* The number of workers that are still on the current fill.         */
+	int      stop;         /* Set when the workers should exit.                                 */
+} dwipe_substream_t;
+
+int  dwipe_substream_fill( dwipe_context_t* c, void* buffer, size_t count, loff_t offset );
+void dwipe_substream_free( dwipe_context_t* c );
+
+#endif /* SUBSTREAM_H_ */
+
+/* eof */
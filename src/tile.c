@@ -0,0 +1,289 @@
+/*
+ *  tile.c: Shared read-only static pattern tiles.
+ *
+ *  Copyright Paolo Iannelli <info@paoloiannelli.com>.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc., 675 Mass
+ *  Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include "dwipe.h"
+#include "context.h"
+#include "method.h"
+#include "prng.h"
+#include "backend.h"
+#include "options.h"
+#include "tile.h"
+#include "cpu.h"
+#include "logging.h"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+/* The read-only mapping that holds every tile, or NULL when nothing is shared. */
+static const char* dwipe_tiles = NULL;
+
+/* The size of each tile, which covers the largest pass buffer and the pattern window. */
+static size_t dwipe_tile_size = 0;
+
+/* The patterns that the tiles hold, in tile order. */
+static int dwipe_tile_count = 0;
+static dwipe_pattern_t dwipe_tile_patterns [DWIPE_KNOB_TILE_COUNT];
+
+
+
+static int dwipe_tile_collect( DWIPE_METHOD_SIGNATURE, dwipe_pattern_t* patterns )
+{
+/**
+ * Records each distinct static pattern of the method, without wiping anything.
+ *
+ */
+
+	int i;
+	int k;
+
+	for( i = 0 ; patterns[i].length != 0 ; i++ )
+	{
+		if( patterns[i].length < 0 ) { continue; }
+
+		for( k = 0 ; k < dwipe_tile_count ; k++ )
+		{
+			if( dwipe_tile_patterns[k].length == patterns[i].length
+			  && memcmp( dwipe_tile_patterns[k].s, patterns[i].s, patterns[i].length ) == 0 ) { break; }
+		}
+
+		if( k < dwipe_tile_count || dwipe_tile_count == DWIPE_KNOB_TILE_COUNT ) { continue; }
+
+		/* The method keeps its patterns on its own stack, so take a copy. */
+		dwipe_tile_patterns[k].s = malloc( patterns[i].length );
+
+		if( dwipe_tile_patterns[k].s == NULL ) { return -1; }
+
+		memcpy( dwipe_tile_patterns[k].s, patterns[i].s, patterns[i].length );
+		dwipe_tile_patterns[k].length = patterns[i].length;
+		dwipe_tile_count += 1;
+	}
+
+	return 0;
+
+} /* dwipe_tile_collect */
+
+
+static char* dwipe_tile_map( size_t size, int* fd )
+{
+/**
+ * Maps writable shared memory for the tiles, from a sealable memfd when the kernel has one.
+ *
+ */
+
+	char* m;
+
+	*fd = -1;
+
+#if defined( SYS_memfd_create ) && defined( MFD_ALLOW_SEALING ) && defined( F_ADD_SEALS )
+	*fd = syscall( SYS_memfd_create, "dwipe-tiles", MFD_CLOEXEC | MFD_ALLOW_SEALING );
+
+	if( *fd >= 0 && ftruncate( *fd, size ) == 0 )
+	{
+		m = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, *fd, 0 );
+
+		if( m != MAP_FAILED ) { return m; }
+	}
+
+	if( *fd >= 0 ) { close( *fd ); }
+	*fd = -1;
+#endif
+
+	m = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0 );
+
+	return m == MAP_FAILED ? NULL : m;
+
+} /* dwipe_tile_map */
+
+
+static const char* dwipe_tile_seal( char* m, size_t size, int fd )
+{
+/**
+ * Makes the filled tiles read-only, so that no worker can change what another one writes.
+ *
+ */
+
+	const char* ro;
+
+	if( fd < 0 )
+	{
+		/* Without a memfd the mapping itself is made read-only. */
+		if( mprotect( m, size, PROT_READ ) != 0 )
+		{
+			dwipe_perror( errno, __FUNCTION__, "mprotect" );
+			munmap( m, size );
+			return NULL;
+		}
+
+		return m;
+	}
+
+#if defined( F_ADD_SEALS )
+	/* Drop the writable mapping, then seal the file so that it can never be written again. */
+	munmap( m, size );
+
+	if( fcntl( fd, F_ADD_SEALS, F_SEAL_WRITE | F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL ) != 0 )
+	{
+		dwipe_perror( errno, __FUNCTION__, "fcntl" );
+	}
+
+	ro = mmap( NULL, size, PROT_READ, MAP_SHARED, fd, 0 );
+	close( fd );
+
+	return ro == MAP_FAILED ? NULL : ro;
+#else
+	return NULL;
+#endif
+
+} /* dwipe_tile_seal */
+
+
+int dwipe_tile_create( dwipe_context_t* c, int count )
+{
+/**
+ * Builds one tile for each distinct static pattern of the methods in shared memory,
+ * before the workers are forked. Patterns that are random for each device, like the
+ * DoD characters, are not known here, and the workers build those themselves.
+ *
+ * @parameter  c      The array of selected contexts, after the memory budget sized them.
+ * @parameter  count  The number of contexts in the array.
+ *
+ */
+
+	/* A context that only runs the method far enough to list its patterns. */
+	dwipe_context_t probe;
+
+	/* The final pass of every method except ops2. */
+	dwipe_pattern_t pattern_zero [] = { { 1, "\x00" }, { 0, NULL } };
+
+	size_t largest = 0;
+	size_t longest = 0;
+	char* m;
+	int fd;
+	int i;
+	int j;
+
+	for( i = 0 ; i < count ; i++ )
+	{
+		if( c[i].buffer_size > largest ) { largest = c[i].buffer_size; }
+	}
+
+	memset( &probe, 0, sizeof( probe ) );
+	probe.device_name = "pattern probe";
+
+	/* The zero tile goes first because it is the most used. */
+	for( i = 0 ; i < count ; i++ )
+	{
+		if( c[i].method != &dwipe_ops2 ) { dwipe_tile_collect( &probe, pattern_zero ); break; }
+	}
+
+	/* The auto method can give each device a different method. */
+	for( i = 0 ; i < count ; i++ )
+	{
+		/* Visit each method once. */
+		for( j = 0 ; j < i ; j++ )
+		{
+			if( c[j].method == c[i].method ) { break; }
+		}
+
+		if( j < i ) { continue; }
+
+		if( dwipe_method_visit( c[i].method, &probe, dwipe_tile_collect ) < 0 )
+		{
+			dwipe_log( DWIPE_LOG_WARNING, "Unable to list the static patterns of '%s'.", dwipe_method_label( c[i].method ) );
+		}
+	}
+
+	for( i = 0 ; i < dwipe_tile_count ; i++ )
+	{
+		if( dwipe_tile_patterns[i].length > longest ) { longest = dwipe_tile_patterns[i].length; }
+	}
+
+	dwipe_tile_size = largest + longest * 2;
+
+	/* Round each tile up to a page so that every tile is page aligned. */
+	dwipe_tile_size = ( dwipe_tile_size + 4095 ) & ~(size_t)4095;
+
+	if( dwipe_tile_count > DWIPE_KNOB_TILE_MEMORY / dwipe_tile_size )
+	{
+		dwipe_log( DWIPE_LOG_NOTICE, "Sharing %i of %i static patterns within %i MiB.", \
+		  (int)( DWIPE_KNOB_TILE_MEMORY / dwipe_tile_size ), dwipe_tile_count, DWIPE_KNOB_TILE_MEMORY / 1048576 );
+		dwipe_tile_count = DWIPE_KNOB_TILE_MEMORY / dwipe_tile_size;
+	}
+
+	if( dwipe_tile_count == 0 || largest == 0 ) { return 0; }
+
+	m = dwipe_tile_map( dwipe_tile_count * dwipe_tile_size, &fd );
+
+	if( m == NULL )
+	{
+		/* The workers fill their own pattern buffers, as before. */
+		dwipe_perror( errno, __FUNCTION__, "mmap" );
+		dwipe_log( DWIPE_LOG_WARNING, "Unable to allocate shared memory for the pattern tiles." );
+		dwipe_tile_count = 0;
+		return 0;
+	}
+
+	for( i = 0 ; i < dwipe_tile_count ; i++ )
+	{
+		dwipe_kernels.pattern_fill( m + i * dwipe_tile_size, dwipe_tile_size, dwipe_tile_patterns[i].s, dwipe_tile_patterns[i].length );
+	}
+
+	dwipe_tiles = dwipe_tile_seal( m, dwipe_tile_count * dwipe_tile_size, fd );
+
+	if( dwipe_tiles == NULL )
+	{
+		dwipe_log( DWIPE_LOG_WARNING, "Unable to make the pattern tiles read-only." );
+		dwipe_tile_count = 0;
+		return 0;
+	}
+
+	dwipe_log( DWIPE_LOG_INFO, "Shared %i static pattern tiles of %llu bytes with every device.", \
+	  dwipe_tile_count, (u64)dwipe_tile_size );
+
+	return 0;
+
+} /* dwipe_tile_create */
+
+
+const char* dwipe_tile_find( dwipe_context_t* c, dwipe_pattern_t* pattern )
+{
+/**
+ * Returns the shared tile of a pattern, or NULL if the caller must fill its own buffer.
+ *
+ */
+
+	int i;
+
+	if( dwipe_tiles == NULL || c->buffer_size + pattern->length * 2 > dwipe_tile_size ) { return NULL; }
+
+	for( i = 0 ; i < dwipe_tile_count ; i++ )
+	{
+		if( dwipe_tile_patterns[i].length == pattern->length
+		  && memcmp( dwipe_tile_patterns[i].s, pattern->s, pattern->length ) == 0 )
+		{
+			return dwipe_tiles + i * dwipe_tile_size;
+		}
+	}
+
+	return NULL;
+
+} /* dwipe_tile_find */
+
+/* eof */
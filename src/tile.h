@@ -0,0 +1,32 @@
+/*
+ *  tile.h: Shared read-only static pattern tiles.
+ *
+ *  Copyright Paolo Iannelli <info@paoloiannelli.com>.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc., 675 Mass
+ *  Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#ifndef TILE_H_
+#define TILE_H_
+
+#define DWIPE_KNOB_TILE_COUNT   64          /* The most distinct static patterns that are shared.  */
+#define DWIPE_KNOB_TILE_MEMORY  268435456   /* 256 MiB; the most memory that all tiles may take.   */
+
+int         dwipe_tile_create( dwipe_context_t* c, int count );
+const char* dwipe_tile_find( dwipe_context_t* c, dwipe_pattern_t* pattern );
+
+#endif /* TILE_H_ */
+
+/* eof */
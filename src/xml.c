@@ -23,7 +23,12 @@
 #include "context.h"
 #include "method.h"
 #include "prng.h"
+#include "backend.h"
 #include "options.h"
+#include "health.h"
+#include "profile.h"
+#include "device.h"
+#include "seed.h"
 #include <libxml/encoding.h>
 #include <libxml/xmlwriter.h>
 #include <libxml/tree.h>
@@ -79,8 +84,9 @@ const char* dwipe_get_info_xml( void )
 
         rc = xmlTextWriterStartDocument( writer, NULL, "UTF-8", NULL );
         rc = xmlTextWriterStartElement( writer, BAD_CAST "info" );
-	rc = xmlTextWriterWriteFormatElement( writer, BAD_CAST "entropy",      "Linux Kernel (urandom)" );
+	rc = xmlTextWriterWriteFormatElement( writer, BAD_CAST "entropy",      "%s", dwipe_seed_source );
 	rc = xmlTextWriterWriteFormatElement( writer, BAD_CAST "prng",         "%s" , dwipe_options.prng->label );
+	rc = xmlTextWriterWriteFormatElement( writer, BAD_CAST "io",           "%s" , dwipe_options.backend->label );
 	rc = xmlTextWriterWriteFormatElement( writer, BAD_CAST "method",       "%s" , dwipe_method_label( dwipe_options.method) );
 	rc = xmlTextWriterWriteFormatElement( writer, BAD_CAST "verify",       "%d" , dwipe_options.verify );
 	rc = xmlTextWriterWriteFormatElement( writer, BAD_CAST "rounds",       "%d" , dwipe_options.rounds );
@@ -101,6 +107,7 @@ const char* dwipe_get_status_xml( dwipe_context_t* context )
 {
         int rc, buffer_size;
         int i = 0;
+        int k;
         xmlTextWriterPtr writer;
         xmlDocPtr doc;
         xmlNodePtr node;
@@ -148,6 +155,15 @@ const char* dwipe_get_status_xml( dwipe_context_t* context )
                         rc = xmlTextWriterWriteFormatElement( writer, BAD_CAST "sync_status", "%d" , context[i].sync_status );
                         rc = xmlTextWriterWriteFormatElement( writer, BAD_CAST "throughput", "%llu" , context[i].throughput );
                         rc = xmlTextWriterWriteFormatElement( writer, BAD_CAST "verify_errors", "%llu" , context[i].verify_errors );
+                        rc = xmlTextWriterWriteFormatElement( writer, BAD_CAST "bytes_written", "%llu" , context[i].bytes_written );
+                        rc = xmlTextWriterWriteFormatElement( writer, BAD_CAST "bytes_skipped", "%llu" , context[i].bytes_skipped );
+                        rc = xmlTextWriterWriteFormatElement( writer, BAD_CAST "health", "%d" , context[i].health );
+                        rc = xmlTextWriterWriteFormatElement( writer, BAD_CAST "health_label", "%s" , dwipe_health_label( context[i].health ) );
+                        rc = xmlTextWriterWriteFormatElement( writer, BAD_CAST "latency_max", "%llu" , context[i].latency_max );
+                        rc = xmlTextWriterWriteFormatElement( writer, BAD_CAST "latency_spikes", "%llu" , context[i].latency_spikes );
+                        rc = xmlTextWriterWriteFormatElement( writer, BAD_CAST "method", "%s" , dwipe_method_label( context[i].method != NULL ? context[i].method : dwipe_options.method ) );
+                        rc = xmlTextWriterWriteFormatElement( writer, BAD_CAST "plan", "%s" , context[i].plan != NULL ? context[i].plan : "" );
+                        rc = xmlTextWriterWriteFormatElement( writer, BAD_CAST "media", "%s" , dwipe_media_label( context[i].media ) );
 
                         rc = xmlTextWriterStartElement( writer, BAD_CAST "device" );
                         rc = xmlTextWriterWriteFormatElement( writer, BAD_CAST "bus" , "%d" , context[i].device_bus );
@@ -179,6 +195,15 @@ const char* dwipe_get_status_xml( dwipe_context_t* context )
                         rc = xmlTextWriterWriteFormatElement( writer, BAD_CAST "working", "%d" , context[i].round_working );
                         rc = xmlTextWriterEndElement( writer );
 
+                        /* The throughput of each LBA range, or 0 where it is not measured yet. */
+                        rc = xmlTextWriterStartElement( writer, BAD_CAST "profile" );
+                        rc = xmlTextWriterWriteFormatElement( writer, BAD_CAST "bucket", "%llu" , dwipe_profile_bucket( &context[i] ) );
+                        for( k = 0 ; k < DWIPE_KNOB_PROFILE_BUCKETS ; k++ )
+                        {
+                                rc = xmlTextWriterWriteFormatElement( writer, BAD_CAST "throughput", "%llu" , dwipe_profile_throughput( &context[i], k ) );
+                        }
+                        rc = xmlTextWriterEndElement( writer );
+
                         rc = xmlTextWriterEndElement( writer );
                 }
         }
@@ -0,0 +1,177 @@
+/*
+ *  xoshiro.c: A multi-lane xoshiro256++ generator for dwipe.
+ *
+ *  Copyright Paolo Iannelli <info@paoloiannelli.com>.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc., 675 Mass
+ *  Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/*
+ * xoshiro256++ and splitmix64 are by David Blackman and Sebastiano Vigna. They are fast and
+ * statistically sound, but they are not cryptographically strong, so this generator is meant
+ * for the passes where only the cost of the randomness matters.
+ *
+ * The lanes step in lockstep, and one step writes the next word of every lane in lane order.
+ *
+ */
+
+#include <string.h>
+#include "xoshiro.h"
+#include "cpu.h"
+
+#define XOSHIRO_ROTL( v, n ) ( ( (v) << (n) ) | ( (v) >> ( 64 - (n) ) ) )
+
+
+
+static uint64_t xoshiro_splitmix64( uint64_t* x )
+{
+	uint64_t z = ( *x += 0x9e3779b97f4a7c15ULL );
+
+	z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+	z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111ebULL;
+
+	return z ^ ( z >> 31 );
+
+} /* xoshiro_splitmix64 */
+
+
+
+void xoshiro_init( xoshiro_state_t* x, const uint8_t* key, size_t length )
+{
+	uint64_t k;
+	size_t words = length / 8;
+	int lane;
+	int i;
+
+	for( lane = 0 ; lane < XOSHIRO_LANES ; lane++ )
+	{
+		/* Give every lane its own splitmix64 start, even when the key repeats. */
+		k = 0;
+
+		if( words > 0 )
+		{
+			memcpy( &k, key + 8 * ( lane % words ), 8 );
+		}
+
+		k += (uint64_t)lane * 0xd1b54a32d192ed03ULL;
+
+		for( i = 0 ; i < 4 ; i++ )
+		{
+			x->s[i][lane / 4][lane % 4] = xoshiro_splitmix64( &k );
+		}
+	}
+
+	x->left = 0;
+	x->avx2 = 0;
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+	x->avx2 = dwipe_cpu_level() >= DWIPE_CPU_AVX2;
+#endif
+
+} /* xoshiro_init */
+
+
+
+static inline __attribute__(( always_inline )) void xoshiro_steps_core( xoshiro_state_t* x, uint8_t* out, size_t steps )
+{
+	xoshiro_v4_t s0, s1, s2, s3, r, t;
+	int v;
+	size_t k;
+
+	for( v = 0 ; v < XOSHIRO_LANES / 4 ; v++ )
+	{
+		s0 = x->s[0][v];
+		s1 = x->s[1][v];
+		s2 = x->s[2][v];
+		s3 = x->s[3][v];
+
+		for( k = 0 ; k < steps ; k++ )
+		{
+			r = XOSHIRO_ROTL( s0 + s3, 23 ) + s0;
+
+			t = s1 << 17;
+			s2 ^= s0;
+			s3 ^= s1;
+			s1 ^= s2;
+			s0 ^= s3;
+			s2 ^= t;
+			s3 = XOSHIRO_ROTL( s3, 45 );
+
+			/* Lanes 4v to 4v+3 of step k. */
+			memcpy( out + k * XOSHIRO_STEP + v * sizeof( r ), &r, sizeof( r ) );
+		}
+
+		x->s[0][v] = s0;
+		x->s[1][v] = s1;
+		x->s[2][v] = s2;
+		x->s[3][v] = s3;
+	}
+
+} /* xoshiro_steps_core */
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+
+/* The same core, compiled for 256-bit registers so that a vector of four lanes fits one. */
+__attribute__(( target( "avx2" ) ))
+static void xoshiro_steps_avx2( xoshiro_state_t* x, uint8_t* out, size_t steps )
+{
+	xoshiro_steps_core( x, out, steps );
+
+} /* xoshiro_steps_avx2 */
+
+#endif
+
+static void xoshiro_steps( xoshiro_state_t* x, uint8_t* out, size_t steps )
+{
+#if defined( __x86_64__ ) || defined( __i386__ )
+	if( x->avx2 )
+	{
+		xoshiro_steps_avx2( x, out, steps );
+		return;
+	}
+#endif
+
+	xoshiro_steps_core( x, out, steps );
+
+} /* xoshiro_steps */
+
+void xoshiro_read( xoshiro_state_t* x, uint8_t* buffer, size_t count )
+{
+	size_t n;
+
+	/* Drain the output that is left over from the last call. */
+	n = count < x->left ? count : x->left;
+	memcpy( buffer, x->stream + sizeof( x->stream ) - x->left, n );
+	x->left -= n;
+	buffer += n;
+	count -= n;
+
+	/* Write whole steps straight into the buffer. */
+	n = count / XOSHIRO_STEP;
+	xoshiro_steps( x, buffer, n );
+	buffer += n * XOSHIRO_STEP;
+	count -= n * XOSHIRO_STEP;
+
+	if( count > 0 )
+	{
+		/* Keep the rest of the last step for the next call. */
+		xoshiro_steps( x, x->stream, 1 );
+		memcpy( buffer, x->stream, count );
+		x->left = XOSHIRO_STEP - count;
+	}
+
+} /* xoshiro_read */
+
+/* eof */
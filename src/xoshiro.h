@@ -0,0 +1,49 @@
+/*
+ *  xoshiro.h: A multi-lane xoshiro256++ generator for dwipe.
+ *
+ *  Copyright Paolo Iannelli <info@paoloiannelli.com>.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc., 675 Mass
+ *  Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#ifndef XOSHIRO_H_
+#define XOSHIRO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define XOSHIRO_LANES   8                         /* Independent generators that step together. */
+#define XOSHIRO_STEP    ( XOSHIRO_LANES * 8 )      /* Output bytes of one step of all lanes.     */
+
+/* Four lanes of 64-bit words, which the compiler maps onto whatever vector registers it has. */
+typedef uint64_t xoshiro_v4_t __attribute__(( vector_size( 32 ) ));
+
+typedef struct xoshiro_state_t_
+{
+	xoshiro_v4_t s[4][XOSHIRO_LANES / 4];  /* State word i of every lane.                 */
+	uint8_t      stream[XOSHIRO_STEP];      /* The step that a short read split.           */
+	size_t       left;                      /* The number of unread bytes at the end of stream. */
+	int          avx2;                      /* Set when the steps run on AVX2.                  */
+} xoshiro_state_t;
+
+/* Seed every lane with splitmix64, starting from the 64-bit words of the key. */
+void xoshiro_init( xoshiro_state_t* x, const uint8_t* key, size_t length );
+
+/* Write count bytes of output, keeping any unread tail for the next call. */
+void xoshiro_read( xoshiro_state_t* x, uint8_t* buffer, size_t count );
+
+#endif /* XOSHIRO_H_ */
+
+/* eof */
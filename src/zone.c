@@ -0,0 +1,590 @@
+/*
+ *  zone.c: Support for zoned block devices (host-managed SMR and ZNS).
+ *
+ *  Copyright Paolo Iannelli <info@paoloiannelli.com>.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc., 675 Mass
+ *  Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include "dwipe.h"
+#include "context.h"
+#include "method.h"
+#include "prng.h"
+#include "options.h"
+#include "backend.h"
+#include "pass.h"
+#include "zone.h"
+#include "health.h"
+#include "cpu.h"
+#include "tile.h"
+#include "logging.h"
+
+#include <linux/blkzoned.h>
+#include <sys/sysmacros.h>
+#include <pthread.h>
+
+dwipe_backend_t dwipe_backend_zone =
+{
+	"Zoned (O_DIRECT at the write pointer)",
+	DWIPE_BACKEND_CAP_READ | DWIPE_BACKEND_CAP_DISCARD | DWIPE_BACKEND_CAP_DURABLE,
+	dwipe_zone_open,
+	dwipe_zone_close,
+	dwipe_zone_write,
+	dwipe_posix_read,
+	dwipe_zone_flush,
+	dwipe_zone_discard
+};
+
+/* The zone report of the device that this child process is wiping. */
+static struct blk_zone* dwipe_zones = NULL;
+static u32 dwipe_zones_count = 0;
+
+/* The O_DIRECT bounce buffer of each writer thread. */
+static __thread char* dwipe_zone_bounce = NULL;
+static __thread size_t dwipe_zone_bounce_size = 0;
+
+
+
+int dwipe_zone_probe( dwipe_context_t* c )
+{
+/**
+ * Detects a zoned block device through sysfs and reads its zone geometry.
+ *
+ * @returns  1 if the device is zoned, otherwise 0.
+ *
+ */
+
+	/* The sysfs path and its contents. */
+	char path [FILENAME_MAX];
+	char model [32] = "";
+
+	/* The zone geometry from the driver. */
+	u32 sectors = 0;
+	u32 count = 0;
+
+	FILE* fp;
+
+	c->zoned = 0;
+	c->zone_size = 0;
+	c->zone_count = 0;
+
+	if( ! S_ISBLK( c->device_stat.st_mode ) ) { return 0; }
+
+	snprintf( path, sizeof( path ), DWIPE_KNOB_ZONE_SYSFS, major( c->device_stat.st_rdev ), minor( c->device_stat.st_rdev ) );
+
+	fp = fopen( path, "r" );
+
+	/* Partitions and old kernels do not have the attribute. */
+	if( fp == NULL ) { return 0; }
+
+	if( fscanf( fp, "%31s", model ) != 1 ) { model[0] = 0; }
+
+	fclose( fp );
+
+	if( strcmp( model, "host-managed" ) != 0 && strcmp( model, "host-aware" ) != 0 ) { return 0; }
+
+	if( ioctl( c->device_fd, BLKGETZONESZ, &sectors ) != 0 || ioctl( c->device_fd, BLKGETNRZONES, &count ) != 0 || sectors == 0 )
+	{
+		dwipe_perror( errno, __FUNCTION__, "ioctl" );
+		dwipe_log( DWIPE_LOG_WARNING, "Unable to get the zone geometry of '%s', so it is wiped as a regular device.", c->device_name );
+		return 0;
+	}
+
+	c->zoned = 1;
+	c->zone_size = (u64)sectors * 512;
+	c->zone_count = count;
+
+	dwipe_log( DWIPE_LOG_NOTICE, "Device '%s' is zoned (%s) with %u zones of %llu bytes.", \
+	  c->device_name, model, c->zone_count, c->zone_size );
+
+	return 1;
+
+} /* dwipe_zone_probe */
+
+
+
+static int dwipe_zone_report( dwipe_context_t* c )
+{
+/**
+ * Loads the zone report of the device into dwipe_zones.
+ *
+ */
+
+	/* The report request and its zone array. */
+	struct blk_zone_report* report;
+
+	/* The next sector to report from. */
+	u64 sector = 0;
+
+	u32 i;
+
+	if( dwipe_zones == NULL )
+	{
+		dwipe_zones = malloc( c->zone_count * sizeof( struct blk_zone ) );
+	}
+
+	report = malloc( sizeof( struct blk_zone_report ) + c->zone_count * sizeof( struct blk_zone ) );
+
+	if( ! dwipe_zones || ! report )
+	{
+		dwipe_perror( errno, __FUNCTION__, "malloc" );
+		dwipe_log( DWIPE_LOG_FATAL, "Unable to allocate memory for the zone report." );
+		return -1;
+	}
+
+	dwipe_zones_count = 0;
+
+	while( dwipe_zones_count < c->zone_count )
+	{
+		memset( report, 0, sizeof( struct blk_zone_report ) );
+		report->sector = sector;
+		report->nr_zones = c->zone_count - dwipe_zones_count;
+
+		if( ioctl( c->device_fd, BLKREPORTZONE, report ) != 0 )
+		{
+			dwipe_perror( errno, __FUNCTION__, "ioctl" );
+			dwipe_log( DWIPE_LOG_FATAL, "Unable to report the zones of '%s'.", c->device_name );
+			free( report );
+			return -1;
+		}
+
+		/* The driver may return fewer zones than were asked for. */
+		if( report->nr_zones == 0 ) { break; }
+
+		for( i = 0 ; i < report->nr_zones ; i++ )
+		{
+			dwipe_zones[dwipe_zones_count] = report->zones[i];
+
+			if( ! ( report->flags & BLK_ZONE_REP_CAPACITY ) )
+			{
+				/* Before ZNS, the whole zone was writable. */
+				dwipe_zones[dwipe_zones_count].capacity = report->zones[i].len;
+			}
+
+			dwipe_zones_count += 1;
+		}
+
+		sector = report->zones[i - 1].start + report->zones[i - 1].len;
+	}
+
+	free( report );
+	return 0;
+
+} /* dwipe_zone_report */
+
+
+
+static int dwipe_zone_dirty( u32 i )
+{
+	/* Only sequential zones that have been written need a reset. */
+	return dwipe_zones[i].type != BLK_ZONE_TYPE_CONVENTIONAL
+	    && dwipe_zones[i].cond != BLK_ZONE_COND_EMPTY
+	    && dwipe_zones[i].cond != BLK_ZONE_COND_OFFLINE
+	    && dwipe_zones[i].cond != BLK_ZONE_COND_READONLY;
+}
+
+int dwipe_zone_reset( dwipe_context_t* c )
+{
+/**
+ * Rewinds the write pointer of every sequential zone that has been written,
+ * so that the next pass can write each zone from its start. The zones are only
+ * reported, and not reset, when the backend does not keep what it writes.
+ *
+ */
+
+	/* A run of adjacent zones that are reset together. */
+	struct blk_zone_range range;
+
+	u32 i;
+	int r;
+
+	if( dwipe_zone_report( c ) < 0 ) { return -1; }
+
+	/* A benchmark sink writes nothing, so it must not drop the zones either. */
+	if( ! ( c->backend->caps & DWIPE_BACKEND_CAP_DURABLE ) ) { return 0; }
+
+	for( i = 0 ; i < dwipe_zones_count ; i++ )
+	{
+		if( ! dwipe_zone_dirty( i ) ) { continue; }
+
+		range.sector = dwipe_zones[i].start;
+		range.nr_sectors = dwipe_zones[i].len;
+
+		/* Merge the adjacent zones into one request. */
+		while( i + 1 < dwipe_zones_count && dwipe_zone_dirty( i + 1 ) && dwipe_zones[i + 1].start == range.sector + range.nr_sectors )
+		{
+			i += 1;
+			range.nr_sectors += dwipe_zones[i].len;
+		}
+
+		/* Tell our parent that the device is busy without moving the progress. */
+		c->offload_status = 1;
+
+		r = ioctl( c->device_fd, BLKRESETZONE, &range );
+
+		c->offload_status = 0;
+
+		if( r != 0 )
+		{
+			dwipe_perror( errno, __FUNCTION__, "ioctl" );
+			dwipe_log( DWIPE_LOG_FATAL, "Unable to reset the zones of '%s'.", c->device_name );
+			return -1;
+		}
+	}
+
+	return 0;
+
+} /* dwipe_zone_reset */
+
+
+
+loff_t dwipe_zone_next( dwipe_context_t* c, loff_t offset, u64 z, u64* e )
+{
+/**
+ * Finds the next writable range, which skips the gap between the capacity
+ * and the size of each ZNS zone and any zone that cannot be written.
+ *
+ * @parameter offset  The current device offset.
+ * @parameter z       The number of bytes remaining in this chunk of the pass.
+ * @modifies  e       The length of the writable range that starts after the gap.
+ * @returns           The number of gap bytes to skip.
+ *
+ */
+
+	/* The writable end of the zone and the end of the zone. */
+	loff_t usable;
+	loff_t end;
+
+	u64 k = offset / c->zone_size;
+
+	if( dwipe_zones == NULL && dwipe_zone_report( c ) < 0 ) { *e = z; return 0; }
+
+	if( k >= dwipe_zones_count ) { *e = z; return 0; }
+
+	end = ( dwipe_zones[k].start + dwipe_zones[k].len ) * 512;
+	usable = ( dwipe_zones[k].start + dwipe_zones[k].capacity ) * 512;
+
+	if( dwipe_zones[k].cond == BLK_ZONE_COND_OFFLINE || dwipe_zones[k].cond == BLK_ZONE_COND_READONLY )
+	{
+		/* The whole zone is skipped. */
+		usable = offset;
+	}
+
+	if( offset < usable )
+	{
+		*e = usable - offset;
+		return 0;
+	}
+
+	*e = 0;
+	return ( end - offset < z ) ? end - offset : z;
+
+} /* dwipe_zone_next */
+
+
+
+int dwipe_zone_conventional( dwipe_context_t* c, loff_t offset, u64 length )
+{
+/**
+ * Checks whether a range lies entirely in conventional zones, which can be
+ * written anywhere without moving a write pointer.
+ *
+ */
+
+	u64 k;
+
+	if( dwipe_zones == NULL && dwipe_zone_report( c ) < 0 ) { return 0; }
+
+	for( k = offset / c->zone_size ; k < dwipe_zones_count && k * c->zone_size < offset + length ; k++ )
+	{
+		if( dwipe_zones[k].type != BLK_ZONE_TYPE_CONVENTIONAL ) { return 0; }
+	}
+
+	return 1;
+
+} /* dwipe_zone_conventional */
+
+
+
+typedef struct dwipe_zone_job_t_
+{
+	dwipe_context_t* c;        /* The device.                                 */
+	dwipe_pattern_t* pattern;  /* The static pattern.                         */
+	u32              next;     /* The next zone that a worker will take.      */
+	int              result;   /* Set to -1 when a worker fails.              */
+} dwipe_zone_job_t;
+
+static void* dwipe_zone_worker( void* arg )
+{
+/**
+ * Takes zones from the job one at a time and writes each from its start.
+ *
+ */
+
+	dwipe_zone_job_t* job = arg;
+	dwipe_context_t* c = job->c;
+	dwipe_pattern_t* pattern = job->pattern;
+
+	/* The IO size. */
+	size_t blocksize = c->buffer_size;
+
+	/* The pattern buffer, which is the shared tile when the pattern has one. */
+	const char* b;
+
+	/* The private pattern buffer when the pattern has no shared tile. */
+	char* m = NULL;
+
+	/* The zone and the offsets within it. */
+	u32 k;
+	loff_t offset;
+	loff_t usable;
+	loff_t end;
+	size_t n;
+	int r;
+	u64 t;
+
+	b = dwipe_tile_find( c, pattern );
+
+	if( b == NULL )
+	{
+		b = m = dwipe_buffer_alloc( c, blocksize + pattern->length * 2 );
+
+		if( ! m )
+		{
+			dwipe_perror( errno, __FUNCTION__, "malloc" );
+			job->result = -1;
+			return NULL;
+		}
+
+		dwipe_kernels.pattern_fill( m, blocksize + pattern->length * 2, pattern->s, pattern->length );
+	}
+
+	while( job->result == 0 && ( k = __sync_fetch_and_add( &job->next, 1 ) ) < dwipe_zones_count )
+	{
+		offset = dwipe_zones[k].start * 512;
+		end = ( dwipe_zones[k].start + dwipe_zones[k].len ) * 512;
+		usable = ( dwipe_zones[k].start + dwipe_zones[k].capacity ) * 512;
+
+		if( dwipe_zones[k].cond == BLK_ZONE_COND_OFFLINE || dwipe_zones[k].cond == BLK_ZONE_COND_READONLY )
+		{
+			dwipe_log( DWIPE_LOG_WARNING, "Skipping an unwritable zone at offset %llu on '%s'.", (u64)offset, c->device_name );
+			usable = offset;
+		}
+
+		for( ; offset < usable ; offset += n )
+		{
+			n = usable - offset;
+
+			if( n > blocksize ) { n = blocksize; }
+
+			/* Keep the pattern aligned with the device offset. */
+			t = dwipe_health_clock();
+			r = c->backend->write( c, &b[offset % pattern->length], n, offset );
+			dwipe_health_latency( c, t, r );
+
+			if( r < 0 )
+			{
+				dwipe_perror( errno, __FUNCTION__, "write" );
+				dwipe_log( DWIPE_LOG_FATAL, "Unable to write to '%s'.", c->device_name );
+				job->result = -1;
+				break;
+			}
+
+			if( r != n )
+			{
+				/* A short write leaves the write pointer behind, so the rest of the zone is lost. */
+				__sync_fetch_and_add( &c->pass_errors, n - r );
+				dwipe_log( DWIPE_LOG_WARNING, "Partial write on '%s', %i bytes short.", c->device_name, (int)( n - r ) );
+			}
+
+			__sync_fetch_and_add( &c->bytes_written, r );
+			__sync_fetch_and_add( &c->round_done, n );
+			__sync_fetch_and_add( &c->pass_done, n );
+		}
+
+		/* The gap after the zone capacity counts as done. */
+		__sync_fetch_and_add( &c->bytes_skipped, end - usable );
+		__sync_fetch_and_add( &c->round_done, end - usable );
+		__sync_fetch_and_add( &c->pass_done, end - usable );
+	}
+
+	free( m );
+	free( dwipe_zone_bounce );
+
+	return NULL;
+
+} /* dwipe_zone_worker */
+
+
+
+int dwipe_zone_static_pass( dwipe_context_t* c, dwipe_pattern_t* pattern )
+{
+/**
+ * Writes a static pattern to a zoned device with several zones in flight.
+ *
+ * A static pattern only depends on the device offset, so each zone can be
+ * written by a different thread as long as each zone is written in order.
+ *
+ */
+
+	/* The worker threads. */
+	pthread_t threads [DWIPE_KNOB_ZONE_THREADS];
+
+	/* The shared job. */
+	dwipe_zone_job_t job;
+
+	int count;
+	int r;
+	int i;
+
+	if( dwipe_options.skip_matching )
+	{
+		/* Skipping a block would leave the write pointer behind it. */
+		dwipe_log( DWIPE_LOG_NOTICE, "Writing every block of zoned device '%s'.", c->device_name );
+	}
+
+	/* Rewind every zone. */
+	if( dwipe_zone_reset( c ) < 0 ) { return -1; }
+
+	job.c = c;
+	job.pattern = pattern;
+	job.next = 0;
+	job.result = 0;
+
+	for( count = 0 ; count < DWIPE_KNOB_ZONE_THREADS && count < c->buffer_count ; count++ )
+	{
+		if( pthread_create( &threads[count], NULL, dwipe_zone_worker, &job ) != 0 )
+		{
+			dwipe_perror( errno, __FUNCTION__, "pthread_create" );
+			break;
+		}
+	}
+
+	if( count == 0 )
+	{
+		dwipe_log( DWIPE_LOG_FATAL, "Unable to start the zone writers for '%s'.", c->device_name );
+		return -1;
+	}
+
+	for( i = 0 ; i < count ; i++ ) { pthread_join( threads[i], NULL ); }
+
+	if( job.result < 0 ) { return -1; }
+
+	/* Tell our parent that we are syncing the device. */
+	c->sync_status = 1;
+
+	/* Sync the device. */
+	r = c->backend->flush( c );
+
+	/* Tell our parent that we have finished syncing the device. */
+	c->sync_status = 0;
+
+	if( r != 0 )
+	{
+		dwipe_perror( errno, __FUNCTION__, "flush" );
+		dwipe_log( DWIPE_LOG_WARNING, "Buffer flush failure on '%s'.", c->device_name );
+	}
+
+	return 0;
+
+} /* dwipe_zone_static_pass */
+
+
+
+int dwipe_zone_open( DWIPE_BACKEND_OPEN_SIGNATURE )
+{
+	/* Writes to sequential zones must not be reordered by the page cache. */
+	int* fd = malloc( sizeof( int ) );
+
+	if( fd == NULL ) { return -1; }
+
+	*fd = open( c->device_name, O_WRONLY | O_DIRECT );
+
+	if( *fd < 0 )
+	{
+		dwipe_perror( errno, __FUNCTION__, "open" );
+		dwipe_log( DWIPE_LOG_FATAL, "Unable to open '%s' for direct i/o.", c->device_name );
+		free( fd );
+		return -1;
+	}
+
+	c->backend_state = fd;
+	return 0;
+}
+
+int dwipe_zone_close( DWIPE_BACKEND_CLOSE_SIGNATURE )
+{
+	int r = 0;
+
+	if( c->backend_state != NULL )
+	{
+		r = close( *(int*)c->backend_state );
+		free( c->backend_state );
+		c->backend_state = NULL;
+	}
+
+	free( dwipe_zone_bounce );
+	dwipe_zone_bounce = NULL;
+	dwipe_zone_bounce_size = 0;
+
+	return r;
+}
+
+ssize_t dwipe_zone_write( DWIPE_BACKEND_WRITE_SIGNATURE )
+{
+	/* Direct i/o needs an aligned buffer, but patterns are written from any window offset. */
+	if( dwipe_zone_bounce_size < count )
+	{
+		free( dwipe_zone_bounce );
+		dwipe_zone_bounce_size = 0;
+
+		if( posix_memalign( (void**)&dwipe_zone_bounce, 4096, count ) != 0 )
+		{
+			dwipe_zone_bounce = NULL;
+			errno = ENOMEM;
+			return -1;
+		}
+
+		dwipe_zone_bounce_size = count;
+	}
+
+	memcpy( dwipe_zone_bounce, buffer, count );
+
+	return pwrite( *(int*)c->backend_state, dwipe_zone_bounce, count, offset );
+}
+
+int dwipe_zone_flush( DWIPE_BACKEND_FLUSH_SIGNATURE )
+{
+	return fdatasync( *(int*)c->backend_state );
+}
+
+int dwipe_zone_discard( DWIPE_BACKEND_DISCARD_SIGNATURE )
+{
+	/* A zone reset is the discard of a zoned device, and it only works on whole zones. */
+	struct blk_zone_range range;
+
+	if( offset % c->zone_size != 0 || length % c->zone_size != 0 )
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	range.sector = offset / 512;
+	range.nr_sectors = length / 512;
+
+	return ioctl( c->device_fd, BLKRESETZONE, &range );
+}
+
+/* eof */
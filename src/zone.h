@@ -0,0 +1,45 @@
+/*
+ *  zone.h: Support for zoned block devices (host-managed SMR and ZNS).
+ *
+ *  Copyright Paolo Iannelli <info@paoloiannelli.com>.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc., 675 Mass
+ *  Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#ifndef ZONE_H_
+#define ZONE_H_
+
+#define DWIPE_KNOB_ZONE_SYSFS             "/sys/dev/block/%i:%i/queue/zoned"
+#define DWIPE_KNOB_ZONE_THREADS           4                   /* Zones that a static pass writes at once. */
+
+int    dwipe_zone_probe( dwipe_context_t* c );
+int    dwipe_zone_reset( dwipe_context_t* c );
+loff_t dwipe_zone_next( dwipe_context_t* c, loff_t offset, u64 z, u64* e );
+int    dwipe_zone_conventional( dwipe_context_t* c, loff_t offset, u64 length );
+int    dwipe_zone_static_pass( dwipe_context_t* c, dwipe_pattern_t* pattern );
+
+/* The backend that writes zoned devices at their write pointers. */
+extern dwipe_backend_t dwipe_backend_zone;
+
+/* Zoned backend prototypes. */
+int     dwipe_zone_open( DWIPE_BACKEND_OPEN_SIGNATURE );
+int     dwipe_zone_close( DWIPE_BACKEND_CLOSE_SIGNATURE );
+ssize_t dwipe_zone_write( DWIPE_BACKEND_WRITE_SIGNATURE );
+int     dwipe_zone_flush( DWIPE_BACKEND_FLUSH_SIGNATURE );
+int     dwipe_zone_discard( DWIPE_BACKEND_DISCARD_SIGNATURE );
+
+#endif /* ZONE_H_ */
+
+/* eof */